@@ -0,0 +1,144 @@
+#pragma once
+#include <condition_variable>
+#include <cppgit2/blame.hpp>
+#include <cppgit2/cancellation_token.hpp>
+#include <cppgit2/clone.hpp>
+#include <cppgit2/diff.hpp>
+#include <cppgit2/git_exception.hpp>
+#include <cppgit2/libgit2_api.hpp>
+#include <cppgit2/status.hpp>
+#include <cppgit2/tree.hpp>
+#include <deque>
+#include <functional>
+#include <future>
+#include <git2.h>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace cppgit2 {
+
+class repository;
+
+// Run repository operations on worker threads, with std::future results
+//
+// Operations are queued per repository (by path) and run by a fixed set of
+// worker threads, at most repository_limit() at a time for the same
+// repository, so one busy repository cannot take all the workers.
+//
+// libgit2 repositories must not be used by two threads at once, so the
+// operations never touch the caller's repository object: they run on
+// handles the executor opens on the same path and reuses. A blame or a diff
+// keeps the handle it was made with until it is destroyed, so it can be
+// used from any thread (one at a time); the handle is then given back to the
+// executor, if it still exists. At most thread_count() handles are kept
+// idle, those of the repositories used least recently being closed first.
+// Results are returned as shared pointers, and errors as the exception
+// stored in the future.
+//
+// Arguments, and the strings set in options, are copied when the operation
+// is queued. Callbacks, payloads and objects set in options (e.g., clone
+// credentials) must outlive the operation.
+class async_executor : public libgit2_api {
+public:
+  // Start `thread_count` worker threads, 0 for one per hardware thread
+  // Runs at most `repository_limit` operations on the same repository at
+  // once.
+  explicit async_executor(size_t thread_count = 0, size_t repository_limit = 1);
+
+  // Wait for the queued operations to complete, and stop the workers
+  ~async_executor();
+
+  async_executor(const async_executor &) = delete;
+  async_executor &operator=(const async_executor &) = delete;
+
+  // Number of worker threads
+  size_t thread_count() const;
+
+  // Maximum number of operations running at once on `repo`
+  size_t repository_limit(const repository &repo) const;
+  void set_repository_limit(const repository &repo, size_t limit);
+
+  // Default maximum, for repositories without their own limit
+  size_t repository_limit() const;
+  void set_repository_limit(size_t limit);
+
+  // See repository::blame_file
+  std::future<std::shared_ptr<blame>>
+  blame_file(const repository &repo, const std::string &path,
+             blame::options options = blame::options());
+
+  // See repository::create_diff_tree_to_tree
+  // Default-constructed trees stand for the empty tree.
+  std::future<std::shared_ptr<diff>> create_diff_tree_to_tree(
+      const repository &repo, const tree &old_tree, const tree &new_tree,
+      const diff::options &options = diff::options(nullptr));
+
+  // See repository::for_each_status
+  // The visitor runs on a worker thread. Cancelling `token` stops the
+  // visits, and completes the future without an error.
+  std::future<void> for_each_status(
+      const repository &repo,
+      std::function<void(const std::string &, status::status_type)> visitor,
+      const cancellation_token &token = cancellation_token());
+
+  // See repository::clone
+  // Limited like the other operations on `local_path`.
+  std::future<std::shared_ptr<repository>>
+  clone(const std::string &url, const std::string &local_path,
+        const clone::options &options = clone::options());
+
+private:
+  // Operation on a handle of a repository; may keep the handle
+  typedef std::function<void(std::unique_ptr<repository> &handle)> task;
+
+  struct repository_state {
+    repository_state() : limit(0), running(0), last_used(0) {}
+
+    size_t limit; // 0 for the default
+    size_t running;
+    std::deque<std::pair<task, bool>> queue; // with whether to open a handle
+    std::vector<std::unique_ptr<repository>> idle;
+    size_t last_used; // value of uses_ when a handle was last made idle
+  };
+
+  typedef std::map<std::string, repository_state>::iterator state_iterator;
+
+  // Handles kept by results are given back through this, and closed instead
+  // once the executor is destroyed
+  struct handle_returns;
+
+  void submit(const std::string &path, task operation, bool open_handle);
+  void work();
+
+  // Result owning `value` and keeping `handle` (on `path`) until destroyed
+  template <typename T>
+  std::shared_ptr<T> keep_handle(T *value, const std::string &path,
+                                 std::unique_ptr<repository> &handle);
+
+  // Make `handle` idle, with the lock held
+  // Returns the handle to close, once the lock is released, if too many are
+  // idle.
+  std::unique_ptr<repository> make_idle(const std::string &path,
+                                        std::unique_ptr<repository> handle);
+
+  // Forget a repository with nothing queued, running, idle or configured
+  void prune(state_iterator state);
+
+  mutable std::mutex mutex_;
+  std::condition_variable wake_;
+  std::map<std::string, repository_state> repositories_;
+  std::string last_served_; // repositories are served in turn
+  size_t default_limit_;
+  size_t queued_;
+  size_t idle_count_; // in all repositories
+  size_t uses_;
+  bool stop_;
+  std::shared_ptr<handle_returns> returns_;
+  std::vector<std::thread> threads_;
+};
+
+} // namespace cppgit2
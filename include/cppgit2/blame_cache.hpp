@@ -0,0 +1,112 @@
+#pragma once
+#include <cppgit2/blame.hpp>
+#include <cppgit2/git_exception.hpp>
+#include <cppgit2/libgit2_api.hpp>
+#include <cppgit2/oid.hpp>
+#include <git2.h>
+#include <list>
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace cppgit2 {
+
+class repository;
+
+// Blame results cached by (path, commit)
+//
+// Every line of a blamed file is kept with its origin: the commit that last
+// changed it and where it was in that commit. A file blamed at a commit
+// whose ancestor is in the cache is not blamed from scratch: the cached
+// result is carried forward along the first-parent chain, and only the
+// lines changed by the commits in between (as found by diffing the blobs
+// of the file) are attributed to them. Commits whose blob is unchanged cost
+// a tree lookup.
+//
+// Files are blamed from scratch, with repository::blame_file, when no
+// ancestor within max_distance() commits is cached, or when the chain goes
+// through a merge (unless blame::options::flag::first_parent is set), a
+// commit without the file, or a binary change.
+//
+// The cache is bounded; the least recently used results are dropped first.
+// Objects are read through a repository handle of its own, opened by the
+// constructor, so the repository given to it can be used or freed meanwhile.
+// Not thread-safe: use one cache per thread.
+class blame_cache : public libgit2_api {
+public:
+  // Origin of a line
+  struct line_origin {
+    oid commit_id;      // commit that last changed the line
+    std::string path;   // path of the file in that commit
+    size_t line_number; // 1-based, in `path` at `commit_id`
+    bool boundary;      // tracked to the oldest commit considered
+  };
+
+  // Origins of the lines of a file, shared with the cache
+  typedef std::shared_ptr<const std::vector<line_origin>> result;
+
+  // Cache blames of files in `repo`
+  // Flags and oldest commit are taken from `options`. The newest commit is
+  // given to every call, and the whole file is always blamed, so min/max
+  // lines are ignored. Keeps up to `capacity` results.
+  explicit blame_cache(const repository &repo,
+                       blame::options options = blame::options(),
+                       size_t capacity = 1000);
+
+  ~blame_cache();
+
+  // Blame `path` as of `commit_id`
+  result blame_file(const std::string &path, const oid &commit_id);
+
+  // Maximum number of commits walked back looking for a cached ancestor
+  // 100 by default; 0 only reuses results for the same commit.
+  size_t max_distance() const;
+  void set_max_distance(size_t distance);
+
+  // Maximum number of cached results
+  size_t capacity() const;
+  void set_capacity(size_t capacity);
+
+  // Number of cached results
+  size_t size() const;
+
+  // Drop all the cached results
+  void clear();
+
+  // Number of calls answered from the cache, carried forward from an
+  // ancestor, and blamed from scratch
+  size_t hits() const;
+  size_t incremental() const;
+  size_t full() const;
+
+private:
+  typedef std::pair<std::string, oid> key;
+
+  // Cached result of `path` at `commit_id`, or null; marks it as recently
+  // used
+  result find(const std::string &path, const oid &commit_id);
+  void insert(const std::string &path, const oid &commit_id, result origins);
+
+  // `origins` of `path` in `parent` carried forward to `child`
+  // Returns null if it cannot be done incrementally
+  result carry_forward(const std::string &path, const oid &parent,
+                       const oid &child, const result &origins) const;
+
+  result blame_from_scratch(const std::string &path, const oid &commit_id);
+
+  std::unique_ptr<repository> repo_;
+  git_blame_options options_;
+  size_t capacity_;
+  size_t max_distance_;
+  size_t hits_;
+  size_t incremental_;
+  size_t full_;
+
+  // Most recently used first
+  std::list<std::pair<key, result>> entries_;
+  std::map<key, std::list<std::pair<key, result>>::iterator> index_;
+};
+
+} // namespace cppgit2
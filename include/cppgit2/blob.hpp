@@ -3,6 +3,11 @@
 #include <cppgit2/git_exception.hpp>
 #include <cppgit2/libgit2_api.hpp>
 #include <cppgit2/oid.hpp>
+#include <functional>
+#include <string>
+#if __cplusplus >= 201703L
+#include <string_view>
+#endif
 
 namespace cppgit2 {
 
@@ -48,4 +53,63 @@ private:
   git_blob *c_ptr_;
 };
 
+// Non-owning, read-only view of a blob's contents
+//
+// Neither duplicates the blob nor copies its contents; the view points
+// into the buffer owned by libgit2 and must not outlive the blob it was
+// created from.
+class blob_view {
+public:
+  // View of a libgit2 blob (no git_blob_dup)
+  blob_view(const git_blob *c_ptr);
+
+  // View of a blob
+  blob_view(const blob &b);
+
+  // SHA1 hash for this blob
+  oid id() const;
+
+  // Determine if the blob content is binary or not
+  bool is_binary() const;
+
+  // Contents of this blob (not null-terminated)
+  const char *data() const { return data_; }
+
+  // Contents of this blob as bytes
+  const unsigned char *bytes() const {
+    return reinterpret_cast<const unsigned char *>(data_);
+  }
+
+  // Size in bytes of the contents of this blob
+  size_t size() const { return size_; }
+
+  bool empty() const { return size_ == 0; }
+
+  // Iterate over the contents
+  const char *begin() const { return data_; }
+  const char *end() const { return data_ + size_; }
+
+  // Copy of the contents
+  std::string to_string() const { return std::string(data_, size_); }
+
+#if __cplusplus >= 201703L
+  // Contents of this blob as a string_view
+  std::string_view str() const { return std::string_view(data_, size_); }
+#endif
+
+  // Run operation for each line of the contents
+  // `line` points into the blob and `length` excludes the newline
+  // The visitor returns true to continue and false to stop
+  void for_each_line(
+      std::function<bool(const char *line, size_t length)> visitor) const;
+
+  // Access libgit2 C ptr
+  const git_blob *c_ptr() const { return c_ptr_; }
+
+private:
+  const git_blob *c_ptr_;
+  const char *data_;
+  size_t size_;
+};
+
 } // namespace cppgit2
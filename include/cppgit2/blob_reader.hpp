@@ -0,0 +1,112 @@
+#pragma once
+#include <cppgit2/git_exception.hpp>
+#include <cppgit2/libgit2_api.hpp>
+#include <cppgit2/oid.hpp>
+#include <functional>
+#include <git2.h>
+#include <istream>
+#include <memory>
+#include <ostream>
+#include <streambuf>
+#include <vector>
+
+namespace cppgit2 {
+
+class repository;
+
+// Chunked reader for the contents of a blob
+//
+// Memory stays bounded by the buffer size no matter how large the blob is:
+// loose objects are read through an ODB read stream (git_odb_open_rstream),
+// and blobs stored whole in a pack of the repository are inflated from the
+// pack file a chunk at a time, at the offset found in the pack index.
+//
+// Packed blobs stored as deltas, and objects only found elsewhere (e.g.,
+// alternates, other backends), fall back to a single git_odb_read; the
+// chunks are then handed out from libgit2's buffer without further copies.
+// git does not delta-compress files above core.bigFileThreshold (512 MiB
+// by default), so the largest blobs are normally streamed.
+class blob_reader : public libgit2_api {
+public:
+  // Open the blob `id` for reading, `buffer_size` bytes at a time
+  // Throws git_exception if the object is missing or not a blob
+  blob_reader(const repository &repo, const oid &id,
+              size_t buffer_size = 64 * 1024);
+
+  ~blob_reader();
+
+  blob_reader(const blob_reader &) = delete;
+  blob_reader &operator=(const blob_reader &) = delete;
+
+  // Size in bytes of the blob
+  size_t size() const;
+
+  // Number of bytes read so far
+  size_t position() const;
+
+  // Check if the whole blob has been read
+  bool eof() const;
+
+  // Check if the blob is read a chunk at a time
+  // False if the blob had to be read in one go
+  bool is_streaming() const;
+
+  // Next chunk of at most `buffer_size` bytes
+  // `data` stays valid until the next call; returns false at the end
+  bool next(const char *&data, size_t &length);
+
+  // Copy up to `length` bytes into `buffer`
+  // Returns the number of bytes copied, 0 at the end
+  size_t read(char *buffer, size_t length);
+
+  // Run operation for each remaining chunk
+  // The visitor returns true to continue and false to stop
+  void for_each_chunk(
+      std::function<bool(const char *data, size_t length)> visitor);
+
+  // Write the remaining contents to `out`
+  void copy_to(std::ostream &out);
+
+private:
+  struct pack_entry;
+
+  void close();
+
+  // Open `id` in the repository's packs, if stored there whole
+  bool open_packed(const repository &repo, const oid &id, size_t buffer_size);
+
+  // Inflate up to `length` bytes of the packed blob into `buffer`
+  size_t read_packed(char *buffer, size_t length);
+
+  git_odb *odb_;
+  git_odb_stream *stream_;
+  std::unique_ptr<pack_entry> pack_;
+  git_odb_object *object_;
+  size_t size_;
+  size_t position_;
+  std::vector<char> buffer_;
+};
+
+// std::istream over the contents of a blob, backed by blob_reader
+class blob_istream : public std::istream {
+public:
+  blob_istream(const repository &repo, const oid &id,
+               size_t buffer_size = 64 * 1024);
+
+private:
+  class buffer : public std::streambuf {
+  public:
+    explicit buffer(blob_reader &reader) : reader_(reader) {}
+
+  protected:
+    int_type underflow() override;
+
+  private:
+    blob_reader &reader_;
+  };
+
+  blob_reader reader_;
+  buffer buffer_;
+};
+
+} // namespace cppgit2
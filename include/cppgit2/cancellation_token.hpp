@@ -0,0 +1,32 @@
+#pragma once
+#include <atomic>
+#include <memory>
+
+namespace cppgit2 {
+
+// Request to stop an iteration early
+//
+// Iterations that accept a token (e.g., repository::for_each_tag) check it
+// before every call to the visitor, and return without an error once it is
+// cancelled. Copies share the same state, so the token can be cancelled by
+// the visitor itself, e.g., once a match is found, or by another thread.
+// Work that libgit2 does before the first visitor call (e.g., the scan of
+// for_each_status) is not interrupted.
+class cancellation_token {
+public:
+  cancellation_token()
+      : cancelled_(std::make_shared<std::atomic<bool>>(false)) {}
+
+  // Stop the iterations using this token
+  void cancel() const { *cancelled_ = true; }
+
+  bool is_cancelled() const { return *cancelled_; }
+
+  // Make the token usable again
+  void reset() const { *cancelled_ = false; }
+
+private:
+  std::shared_ptr<std::atomic<bool>> cancelled_;
+};
+
+} // namespace cppgit2
@@ -3,9 +3,12 @@
 #include <cppgit2/git_exception.hpp>
 #include <cppgit2/index.hpp>
 #include <cppgit2/libgit2_api.hpp>
+#include <cppgit2/sparse_checkout.hpp>
 #include <cppgit2/strarray.hpp>
 #include <cppgit2/tree.hpp>
+#include <functional>
 #include <git2.h>
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -174,7 +177,39 @@ public:
       return strarray(&c_ptr_->paths).to_vector();
     }
     void set_paths(const std::vector<std::string> &paths) {
-      c_ptr_->paths = *(strarray(paths).c_ptr());
+      // The strings are kept alive with the options
+      paths_ = std::make_shared<strarray>(paths);
+      c_ptr_->paths = *(paths_->c_ptr());
+    }
+
+    // Sparse checkout
+    // Restricts the checkout to the files of `target` inside `cone`. Only
+    // the cone and its parent directories are visited. Index entries
+    // outside the cone are not updated either: read the target tree into
+    // the index and call sparse_checkout::apply to set their skip-worktree
+    // bits.
+    void set_sparse_checkout(const sparse_checkout &cone, const tree &target) {
+      set_paths(cone.paths(target));
+      c_ptr_->checkout_strategy |= GIT_CHECKOUT_DISABLE_PATHSPEC_MATCH;
+    }
+
+    // Progress
+    // Called with the path of each checked out file (empty on the last
+    // call), the number of files done so far and the total number of files
+    void set_progress_callback(
+        std::function<void(const std::string &, size_t, size_t)> callback) {
+      // The callback is kept alive with the options
+      progress_callback_ = std::make_shared<
+          std::function<void(const std::string &, size_t, size_t)>>(
+          std::move(callback));
+      c_ptr_->progress_cb = [](const char *path, size_t completed,
+                               size_t total, void *payload) {
+        auto callback = static_cast<
+            std::function<void(const std::string &, size_t, size_t)> *>(
+            payload);
+        (*callback)(path ? path : "", completed, total);
+      };
+      c_ptr_->progress_payload = progress_callback_.get();
     }
 
     // Baseline
@@ -251,6 +286,9 @@ public:
   private:
     git_checkout_options *c_ptr_;
     git_checkout_options default_options_;
+    std::shared_ptr<strarray> paths_;
+    std::shared_ptr<std::function<void(const std::string &, size_t, size_t)>>
+        progress_callback_;
   };
 };
 ENABLE_BITMASK_OPERATORS(checkout::notification_flag);
@@ -8,6 +8,7 @@
 #include <cppgit2/time.hpp>
 #include <cppgit2/tree.hpp>
 #include <git2.h>
+#include <memory>
 #include <string>
 
 namespace cppgit2 {
@@ -100,4 +101,49 @@ private:
   ownership owner_;
 };
 
+// Lazily loaded commit, handed out by repository::for_each_commit_view
+//
+// Holds only the repository and the commit id. The commit is looked up
+// and parsed on first access to anything but `id()`, so visitors that
+// stop early, or only need some commits, skip the object database for
+// the rest.
+class commit_view {
+public:
+  commit_view(git_repository *repo, const oid &id);
+  ~commit_view();
+
+  commit_view(const commit_view &) = delete;
+  commit_view &operator=(const commit_view &) = delete;
+
+  // SHA-1 hash of this commit
+  // Never loads the commit
+  const oid &id() const;
+
+  // Returns true if the commit has been looked up
+  bool is_loaded() const;
+
+  // SHA-1 hash of the parent commit
+  // n is the position of the parent (from 0 to `parentcount`)
+  oid parent_id(unsigned int n) const;
+
+  // Number of parents of this commit
+  unsigned int parent_count() const;
+
+  // Commit time (i.e., committer time) of a commit
+  epoch_time_seconds time() const;
+
+  // SHA-1 has of the tree pointed to by this commit
+  oid tree_id() const;
+
+  // Full commit, looked up on first use
+  const commit &get() const;
+
+private:
+  const git_commit *load() const;
+
+  git_repository *repo_;
+  oid id_;
+  mutable std::unique_ptr<commit> commit_;
+};
+
 } // namespace cppgit2
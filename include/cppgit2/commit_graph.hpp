@@ -0,0 +1,134 @@
+#pragma once
+#include <cppgit2/git_exception.hpp>
+#include <cppgit2/libgit2_api.hpp>
+#include <cppgit2/oid.hpp>
+#include <cppgit2/revision.hpp>
+#include <cppgit2/time.hpp>
+#include <cstdint>
+#include <functional>
+#include <git2.h>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace cppgit2 {
+
+class repository;
+
+// In-memory commit graph with generation numbers
+//
+// Loaded from git's commit-graph files (objects/info/commit-graph or the
+// split chain in objects/info/commit-graphs/), or built by walking the
+// repository when there is none. Parents, commit times, tree ids and
+// generation numbers are kept in flat arrays, so topological walks, merge
+// bases and ahead/behind counts never decompress commit objects.
+//
+// Commits that are missing from the commit-graph file (e.g., created after
+// it was written) are looked up once and added to the graph on first use.
+//
+// The graph keeps a pointer to the repository and must not outlive it.
+// Queries update internal scratch state and are not thread-safe.
+class commit_graph : public libgit2_api {
+public:
+  // Load the commit-graph of a repository
+  // Builds the graph in memory if the repository has no commit-graph file
+  explicit commit_graph(const repository &repo);
+
+  // Build the commit graph in memory, ignoring any commit-graph file
+  //
+  // Walks every commit reachable from the references and HEAD. This reads
+  // each commit once; later queries are answered from memory.
+  static commit_graph build(const repository &repo);
+
+  // Number of commits in the graph
+  size_t size() const;
+
+  // Number of commits that were read from commit-graph files
+  size_t size_on_disk() const;
+
+  // Check if a commit is in the graph (without adding it)
+  bool contains(const oid &id) const;
+
+  // Generation number (topological level) of a commit
+  // 1 for root commits, 1 + the maximum of the parents' generations otherwise
+  uint32_t generation(const oid &id);
+
+  // Parents of a commit, in order
+  std::vector<oid> parent_ids(const oid &id);
+
+  // Commit time (i.e., committer time) of a commit
+  epoch_time_seconds time(const oid &id);
+
+  // SHA-1 hash of the tree pointed to by a commit
+  oid tree_id(const oid &id);
+
+  // Check if `ancestor` is reachable from `descendant`
+  // Stops descending at commits with a lower generation than `ancestor`
+  bool is_ancestor(const oid &ancestor, const oid &descendant);
+
+  // Find a merge base between two commits
+  // Throws git_exception if the commits have no common ancestor
+  oid find_merge_base(const oid &first_commit, const oid &second_commit);
+
+  // Find all merge bases between two commits
+  std::vector<oid> find_merge_bases(const oid &first_commit,
+                                    const oid &second_commit);
+
+  // Count the number of unique commits between two commit objects
+  // Returns {ahead, behind}, i.e., the number of commits reachable only from
+  // `local` and the number of commits reachable only from `upstream`
+  std::pair<size_t, size_t> ahead_behind(const oid &local,
+                                         const oid &upstream);
+
+  // Run operation for each commit reachable from `roots`
+  //
+  // Sorting follows revision::sort. Topological orderings first collect the
+  // reachable commits (from memory), time orderings are incremental.
+  // The visitor returns true to continue and false to stop the walk.
+  void for_each_commit(
+      const std::vector<oid> &roots, std::function<bool(const oid &)> visitor,
+      revision::sort sort_ordering = revision::sort::topological);
+
+private:
+  explicit commit_graph(git_repository *repo);
+
+  // Read commit-graph file(s) from the objects directory
+  // Returns false if there are none
+  bool read_files(const std::string &objects_dir);
+  void read_file(const std::string &path, bool is_chain_layer);
+
+  // Position of a commit, adding it (and its missing ancestors) if needed
+  uint32_t position(const oid &id);
+
+  // Append a commit whose parents are already in the graph
+  uint32_t append(const oid &id, const oid &tree,
+                  const std::vector<uint32_t> &parents,
+                  epoch_time_seconds time);
+
+  // Recompute all generation numbers (e.g., for files written without them)
+  void compute_generations();
+
+  const uint32_t *parents_begin(uint32_t position) const;
+  const uint32_t *parents_end(uint32_t position) const;
+
+  std::vector<uint32_t> merge_base_positions(uint32_t one, uint32_t two);
+
+  git_repository *repo_;
+  size_t size_on_disk_;
+
+  // Per-commit data, indexed by position
+  std::vector<oid> ids_;
+  std::vector<oid> trees_;
+  std::vector<uint32_t> generations_;
+  std::vector<epoch_time_seconds> times_;
+  std::vector<uint32_t> parent_offsets_; // size() + 1 offsets into parents_
+  std::vector<uint32_t> parents_;
+
+  std::unordered_map<oid, uint32_t> positions_;
+
+  // Scratch flags for queries, cleared after every query
+  std::vector<uint8_t> flags_;
+};
+
+} // namespace cppgit2
@@ -1,4 +1,5 @@
 #pragma once
+#include <cppgit2/cancellation_token.hpp>
 #include <cppgit2/data_buffer.hpp>
 #include <cppgit2/git_exception.hpp>
 #include <cppgit2/libgit2_api.hpp>
@@ -176,6 +177,13 @@ public:
   void for_each(const std::string &regexp,
                 std::function<void(const entry &)> visitor);
 
+  // Same as above, stopping once `token` is cancelled
+  void for_each(std::function<void(const entry &)> visitor,
+                const cancellation_token &token);
+  void for_each(const std::string &regexp,
+                std::function<void(const entry &)> visitor,
+                const cancellation_token &token);
+
   // Access libgit2 C ptr
   const git_config *c_ptr() const;
 
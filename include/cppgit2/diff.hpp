@@ -1,6 +1,7 @@
 #pragma once
 #include <cppgit2/bitmask_operators.hpp>
 #include <cppgit2/blob.hpp>
+#include <cppgit2/cancellation_token.hpp>
 #include <cppgit2/data_buffer.hpp>
 #include <cppgit2/diff.hpp>
 #include <cppgit2/libgit2_api.hpp>
@@ -10,8 +11,12 @@
 #include <functional>
 #include <git2.h>
 #include <string>
+#include <type_traits>
 #include <utility>
 #include <vector>
+#if __cplusplus >= 201703L
+#include <string_view>
+#endif
 
 namespace cppgit2 {
 
@@ -632,6 +637,122 @@ public:
     git_diff_hunk c_struct_;
   };
 
+  // Read-only view of one side of a delta
+  // Refers to the data of the diff, nothing is copied.
+  class file_view {
+  public:
+    explicit file_view(const git_diff_file *c_ptr) : c_ptr_(c_ptr) {}
+
+    oid id() const { return oid(&c_ptr_->id); }
+
+    // Path of the file, owned by the diff
+    const char *path() const { return c_ptr_->path ? c_ptr_->path : ""; }
+
+    uint64_t size() const { return c_ptr_->size; }
+
+    uint32_t flags() const { return c_ptr_->flags; }
+
+    uint16_t mode() const { return c_ptr_->mode; }
+
+    // Access libgit2 C ptr
+    const git_diff_file *c_ptr() const { return c_ptr_; }
+
+  private:
+    const git_diff_file *c_ptr_;
+  };
+
+  // Read-only view of a delta, only valid during the callback
+  // Unlike diff::delta, nothing is copied.
+  class delta_view {
+  public:
+    explicit delta_view(const git_diff_delta *c_ptr) : c_ptr_(c_ptr) {}
+
+    delta::type status() const {
+      return static_cast<delta::type>(c_ptr_->status);
+    }
+
+    uint32_t flags() const { return c_ptr_->flags; }
+
+    uint16_t similarity() const { return c_ptr_->similarity; }
+
+    uint16_t nfiles() const { return c_ptr_->nfiles; }
+
+    file_view old_file() const { return file_view(&c_ptr_->old_file); }
+
+    file_view new_file() const { return file_view(&c_ptr_->new_file); }
+
+    // Access libgit2 C ptr
+    const git_diff_delta *c_ptr() const { return c_ptr_; }
+
+  private:
+    const git_diff_delta *c_ptr_;
+  };
+
+  // Read-only view of a hunk, only valid during the callback
+  class hunk_view {
+  public:
+    explicit hunk_view(const git_diff_hunk *c_ptr) : c_ptr_(c_ptr) {}
+
+    int old_start() const { return c_ptr_->old_start; }
+
+    int old_lines() const { return c_ptr_->old_lines; }
+
+    int new_start() const { return c_ptr_->new_start; }
+
+    int new_lines() const { return c_ptr_->new_lines; }
+
+    size_t header_length() const { return c_ptr_->header_len; }
+
+    // Header text, NUL-byte terminated
+    const char *header() const { return c_ptr_->header; }
+
+    // Access libgit2 C ptr
+    const git_diff_hunk *c_ptr() const { return c_ptr_; }
+
+  private:
+    const git_diff_hunk *c_ptr_;
+  };
+
+  // Read-only view of a line, only valid during the callback
+  class line_view {
+  public:
+    explicit line_view(const git_diff_line *c_ptr) : c_ptr_(c_ptr) {}
+
+    // A git_diff_line_t value
+    char origin() const { return c_ptr_->origin; }
+
+    // Line number in old file or -1 for added line
+    int old_lineno() const { return c_ptr_->old_lineno; }
+
+    // Line number in new file or -1 for deleted line
+    int new_lineno() const { return c_ptr_->new_lineno; }
+
+    // Number of newline characters in content
+    int num_lines() const { return c_ptr_->num_lines; }
+
+    // Number of bytes of data
+    size_t content_length() const { return c_ptr_->content_len; }
+
+    // Offset in the original file to the content
+    git_off_t content_offset() const { return c_ptr_->content_offset; }
+
+    // Pointer to diff text, not NUL-byte terminated
+    const char *content() const { return c_ptr_->content; }
+
+#if __cplusplus >= 201703L
+    // Diff text as a string_view
+    std::string_view text() const {
+      return std::string_view(c_ptr_->content, c_ptr_->content_len);
+    }
+#endif
+
+    // Access libgit2 C ptr
+    const git_diff_line *c_ptr() const { return c_ptr_; }
+
+  private:
+    const git_diff_line *c_ptr_;
+  };
+
   // Loop over all deltas in a diff issuing callbacks.
   //
   // @param file_callback: Callback function to make per file in the diff.
@@ -659,6 +780,54 @@ public:
                                    const diff::line &)>
                     line_callback = {});
 
+  // Same as above, stopping once `token` is cancelled
+  // Every callback is taken here; pass {} for those not needed.
+  void for_each(std::function<void(const diff::delta &, float)> file_callback,
+                std::function<void(const diff::delta &, const diff::binary &)>
+                    binary_callback,
+                std::function<void(const diff::delta &, const diff::hunk &)>
+                    hunk_callback,
+                std::function<void(const diff::delta &, const diff::hunk &,
+                                   const diff::line &)>
+                    line_callback,
+                const cancellation_token &token);
+
+  // Loop over all deltas in a diff, without copies
+  //
+  // Same as for_each, for callables of any type, called with views:
+  //
+  //   file_callback(const diff::delta_view &, float progress)
+  //   binary_callback(const diff::delta_view &, const diff::binary &)
+  //   hunk_callback(const diff::delta_view &, const diff::hunk_view &)
+  //   line_callback(const diff::delta_view &, const diff::hunk_view &,
+  //                 const diff::line_view &)
+  //
+  // Pass nullptr to skip a callback; as with for_each, the text diff is
+  // only computed if there is a hunk or a line callback. The callables
+  // are neither copied nor wrapped in std::function, and no wrapper
+  // object is built per call, which matters for line-level visits of
+  // large patches.
+  template <typename FileCallback, typename BinaryCallback = std::nullptr_t,
+            typename HunkCallback = std::nullptr_t,
+            typename LineCallback = std::nullptr_t>
+  void visit(FileCallback &&file_callback,
+             BinaryCallback &&binary_callback = nullptr,
+             HunkCallback &&hunk_callback = nullptr,
+             LineCallback &&line_callback = nullptr) const {
+    typedef visitor_callbacks<FileCallback, BinaryCallback, HunkCallback,
+                              LineCallback>
+        callbacks;
+    callbacks payload{file_callback, binary_callback, hunk_callback,
+                      line_callback};
+    if (git_diff_foreach(
+            c_ptr_,
+            callbacks::file(is_null_callback<FileCallback>()),
+            callbacks::binary(is_null_callback<BinaryCallback>()),
+            callbacks::hunk(is_null_callback<HunkCallback>()),
+            callbacks::line(is_null_callback<LineCallback>()), &payload))
+      throw git_exception();
+  }
+
   // Iterate over a diff generating formatted text output.
   void print(diff::format format,
              std::function<void(const diff::delta &, const diff::hunk &,
@@ -880,6 +1049,60 @@ public:
   oid patchid(const patchid_options &options = patchid_options());
 
 private:
+  template <typename Callback>
+  using is_null_callback = std::is_same<typename std::decay<Callback>::type,
+                                        std::nullptr_t>;
+
+  // Trampolines of visit; the C callbacks of null callables are null
+  template <typename FileCallback, typename BinaryCallback,
+            typename HunkCallback, typename LineCallback>
+  struct visitor_callbacks {
+    FileCallback &file_callback;
+    BinaryCallback &binary_callback;
+    HunkCallback &hunk_callback;
+    LineCallback &line_callback;
+
+    static git_diff_file_cb file(std::true_type) { return nullptr; }
+    static git_diff_file_cb file(std::false_type) {
+      return [](const git_diff_delta *delta_c, float progress,
+                void *payload) -> int {
+        static_cast<visitor_callbacks *>(payload)->file_callback(
+            delta_view(delta_c), progress);
+        return 0;
+      };
+    }
+
+    static git_diff_binary_cb binary(std::true_type) { return nullptr; }
+    static git_diff_binary_cb binary(std::false_type) {
+      return [](const git_diff_delta *delta_c, const git_diff_binary *binary_c,
+                void *payload) -> int {
+        static_cast<visitor_callbacks *>(payload)->binary_callback(
+            delta_view(delta_c), diff::binary(binary_c));
+        return 0;
+      };
+    }
+
+    static git_diff_hunk_cb hunk(std::true_type) { return nullptr; }
+    static git_diff_hunk_cb hunk(std::false_type) {
+      return [](const git_diff_delta *delta_c, const git_diff_hunk *hunk_c,
+                void *payload) -> int {
+        static_cast<visitor_callbacks *>(payload)->hunk_callback(
+            delta_view(delta_c), hunk_view(hunk_c));
+        return 0;
+      };
+    }
+
+    static git_diff_line_cb line(std::true_type) { return nullptr; }
+    static git_diff_line_cb line(std::false_type) {
+      return [](const git_diff_delta *delta_c, const git_diff_hunk *hunk_c,
+                const git_diff_line *line_c, void *payload) -> int {
+        static_cast<visitor_callbacks *>(payload)->line_callback(
+            delta_view(delta_c), hunk_view(hunk_c), line_view(line_c));
+        return 0;
+      };
+    }
+  };
+
   friend class patch;
   friend class pathspec;
   friend class repository;
@@ -12,14 +12,16 @@ public:
     message_ = error ? error->message : "unknown error";
   }
   git_exception(const char *message) : message_(message) {}
-  git_exception(const std::string &message) : message_(message.c_str()) {}
+  git_exception(const std::string &message) : message_(message) {}
   virtual ~git_exception() throw() {}
-  virtual const char *what() const throw() { return message_; }
+  virtual const char *what() const throw() { return message_.c_str(); }
 
   static void clear() { git_error_clear(); }
 
 protected:
-  const char *message_;
+  // Copied, since libgit2 reuses its error buffer and the exception may be
+  // rethrown elsewhere (e.g., from a std::future)
+  std::string message_;
 };
 
 } // namespace cppgit2
@@ -1,17 +1,22 @@
 #pragma once
 #include <cppgit2/bitmask_operators.hpp>
+#include <cppgit2/cancellation_token.hpp>
 #include <cppgit2/file_mode.hpp>
 #include <cppgit2/libgit2_api.hpp>
 #include <cppgit2/oid.hpp>
 #include <cppgit2/ownership.hpp>
 #include <cppgit2/strarray.hpp>
 #include <cppgit2/tree.hpp>
+#include <cstddef>
 #include <functional>
 #include <git2.h>
+#include <iterator>
 #include <string>
 
 namespace cppgit2 {
 
+class sparse_checkout;
+
 class index : public libgit2_api {
 public:
   // Default construct in-memory index object
@@ -41,11 +46,12 @@ public:
   class entry : public libgit2_api {
   public:
     // Default construct a file entry
-    entry() { c_ptr_ = &default_; }
+    entry() : default_() { c_ptr_ = &default_; }
 
     // Construct from libgit2 C ptr
     // If owned by user, will be free'd in destructor
-    entry(git_index_entry *c_ptr) : c_ptr_(c_ptr) {
+    // A null pointer gives an empty (zeroed) entry
+    entry(git_index_entry *c_ptr) : c_ptr_(c_ptr), default_() {
       if (!c_ptr)
         c_ptr_ = &default_;
     }
@@ -144,6 +150,115 @@ public:
     git_index_entry default_;
   };
 
+  // Read-only view of an index entry
+  // Refers to the entry stored in the index, nothing is copied. Only valid
+  // until the index is modified.
+  class entry_view {
+  public:
+    explicit entry_view(const git_index_entry *c_ptr) : c_ptr_(c_ptr) {}
+
+    index::time ctime() const {
+      return index::time{c_ptr_->ctime.seconds, c_ptr_->ctime.nanoseconds};
+    }
+
+    index::time mtime() const {
+      return index::time{c_ptr_->mtime.seconds, c_ptr_->mtime.nanoseconds};
+    }
+
+    uint32_t dev() const { return c_ptr_->dev; }
+
+    uint32_t ino() const { return c_ptr_->ino; }
+
+    uint32_t mode() const { return c_ptr_->mode; }
+
+    uint32_t uid() const { return c_ptr_->uid; }
+
+    uint32_t gid() const { return c_ptr_->gid; }
+
+    uint32_t file_size() const { return c_ptr_->file_size; }
+
+    oid id() const { return oid(&c_ptr_->id); }
+
+    entry::flag flags() const {
+      return static_cast<entry::flag>(c_ptr_->flags);
+    }
+
+    entry::extended_flag extended_flags() const {
+      return static_cast<entry::extended_flag>(c_ptr_->flags_extended);
+    }
+
+    // Path of the entry, owned by the index
+    const char *path() const { return c_ptr_->path ? c_ptr_->path : ""; }
+
+    // Stage number of the entry
+    int entry_stage() const { return git_index_entry_stage(c_ptr_); }
+
+    // Return whether the entry is a conflict (has a high stage entry)
+    bool is_conflict() const { return git_index_entry_is_conflict(c_ptr_); }
+
+    // Access libgit2 C ptr
+    const git_index_entry *c_ptr() const { return c_ptr_; }
+
+  private:
+    const git_index_entry *c_ptr_;
+  };
+
+  // Iterator over the entries of an index, yielding entry views
+  // An input iterator: views are returned by value, not by reference.
+  class entry_iterator {
+  public:
+    typedef std::input_iterator_tag iterator_category;
+    typedef entry_view value_type;
+    typedef std::ptrdiff_t difference_type;
+    typedef const entry_view *pointer;
+    typedef entry_view reference;
+
+    entry_iterator(git_index *index, size_t position)
+        : index_(index), position_(position) {}
+
+    entry_view operator*() const {
+      return entry_view(git_index_get_byindex(index_, position_));
+    }
+
+    entry_iterator &operator++() {
+      ++position_;
+      return *this;
+    }
+
+    entry_iterator operator++(int) {
+      entry_iterator result(*this);
+      ++position_;
+      return result;
+    }
+
+    bool operator==(const entry_iterator &rhs) const {
+      return index_ == rhs.index_ && position_ == rhs.position_;
+    }
+
+    bool operator!=(const entry_iterator &rhs) const { return !(*this == rhs); }
+
+  private:
+    git_index *index_;
+    size_t position_;
+  };
+
+  // Range over the entries of an index, for use in range-based for loops:
+  //
+  //   for (const auto &entry : index.entries())
+  //     std::cout << entry.path() << "\n";
+  class entry_range {
+  public:
+    entry_range(git_index *index, size_t size) : index_(index), size_(size) {}
+
+    entry_iterator begin() const { return entry_iterator(index_, 0); }
+    entry_iterator end() const { return entry_iterator(index_, size_); }
+    size_t size() const { return size_; }
+
+  private:
+    git_index *index_;
+    size_t size_;
+  };
+
   // Capabilities of system that affect index actions.
   enum class capability {
     ignore_case = 1,
@@ -221,6 +336,31 @@ public:
   // Run operation for each entry in index
   void for_each(std::function<void(const entry &)> visitor);
 
+  // Same as above, stopping once `token` is cancelled
+  void for_each(std::function<void(const entry &)> visitor,
+                const cancellation_token &token);
+
+  // Entries of the index, sorted by path and stage
+  // The range is invalidated when the index is modified
+  entry_range entries() const;
+
+  // Run operation for each entry in index, using `thread_count` threads
+  //
+  // The sorted entries are split into one contiguous chunk per thread. The
+  // visitor is called concurrently and must be thread-safe; the index must
+  // not be modified until this returns. 0 uses one thread per hardware
+  // thread.
+  void parallel_for_each(std::function<void(const entry_view &)> visitor,
+                         size_t thread_count = 0) const;
+
+  // Run operation for each entry inside a sparse-checkout cone
+  //
+  // Directories outside the cone are skipped as a whole with a binary
+  // search, so the cost is proportional to the entries of the cone (and the
+  // number of excluded directories next to it), not to the whole index.
+  void for_each(const sparse_checkout &cone,
+                std::function<void(const entry_view &)> visitor) const;
+
   // Run operator for each conflict in index
   void for_each_conflict(
       std::function<void(const entry &, const entry &, const entry &)> visitor);
@@ -1,6 +1,5 @@
 #pragma once
 #include <cppgit2/git_exception.hpp>
-#include <cppgit2/libgit2_api.hpp>
 #include <git2.h>
 #include <iostream>
 #include <tuple>
@@ -9,9 +8,12 @@ namespace cppgit2 {
 
 class libgit2_api {
 public:
-  libgit2_api() { git_libgit2_init(); }
-
-  ~libgit2_api() { git_libgit2_shutdown(); }
+  // Makes sure libgit2 is initialized before the wrapper is used
+  //
+  // libgit2 is initialized once per process (see `initialize`), so
+  // constructing a wrapper no longer costs a git_libgit2_init /
+  // git_libgit2_shutdown pair.
+  libgit2_api() { initialize(); }
 
   std::tuple<int, int, int> version() const {
     int major, minor, revision;
@@ -19,6 +21,31 @@ public:
       throw git_exception();
     return std::tuple<int, int, int>{major, minor, revision};
   }
+
+  // Initialize libgit2 for the lifetime of the process
+  //
+  // The first call runs git_libgit2_init; every later call only checks
+  // a (thread-safe) static guard. The matching git_libgit2_shutdown runs
+  // when the process exits.
+  static void initialize();
+
+  // Scoped libgit2 lifetime
+  //
+  // Holds an extra reference on libgit2's global state for as long as
+  // the scope is alive, e.g., to bracket a batch job in `main`:
+  //
+  //   int main() {
+  //     libgit2_api::scope libgit2;
+  //     ...
+  //   }
+  class scope {
+  public:
+    scope() { git_libgit2_init(); }
+    ~scope() { git_libgit2_shutdown(); }
+
+    scope(const scope &) = delete;
+    scope &operator=(const scope &) = delete;
+  };
 };
 
-} // namespace cppgit2
\ No newline at end of file
+} // namespace cppgit2
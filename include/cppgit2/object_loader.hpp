@@ -0,0 +1,55 @@
+#pragma once
+#include <cppgit2/git_exception.hpp>
+#include <cppgit2/libgit2_api.hpp>
+#include <cppgit2/object.hpp>
+#include <cppgit2/oid.hpp>
+#include <cppgit2/pack_index.hpp>
+#include <functional>
+#include <git2.h>
+#include <string>
+#include <vector>
+
+namespace cppgit2 {
+
+class repository;
+
+// Batched object lookups
+//
+// Objects are deduplicated and looked up in storage order: grouped by pack
+// and sorted by offset within each pack, so that libgit2 reads every pack
+// front to back instead of seeking for each id. Objects that are not in a
+// known pack (loose objects, or packs written after the loader was created)
+// are looked up last.
+//
+// The pack indexes are mapped once, when the loader is created. Keep a
+// loader around to look up many batches from the same repository.
+class object_loader : public libgit2_api {
+public:
+  explicit object_loader(const repository &repo);
+
+  // Map the pack indexes again, e.g., after a fetch or repack
+  void refresh();
+
+  // Lookup objects
+  // The result is in the order of `ids`, duplicates included
+  // Throws git_exception if an object is missing or not of type `type`
+  std::vector<object>
+  lookup(const std::vector<oid> &ids,
+         object::object_type type = object::object_type::any) const;
+
+  // Run operation for each distinct object in `ids`, in storage order
+  // The visitor returns true to continue and false to stop
+  void for_each(const std::vector<oid> &ids,
+                std::function<bool(const object &)> visitor,
+                object::object_type type = object::object_type::any) const;
+
+private:
+  // `ids` (sorted, distinct) positions, in storage order
+  std::vector<size_t> storage_order(const std::vector<oid> &ids) const;
+
+  git_repository *repo_;
+  std::string pack_dir_;
+  std::vector<pack_index> packs_;
+};
+
+} // namespace cppgit2
@@ -1,4 +1,5 @@
 #pragma once
+#include <cppgit2/cancellation_token.hpp>
 #include <cppgit2/file_mode.hpp>
 #include <cppgit2/git_exception.hpp>
 #include <cppgit2/libgit2_api.hpp>
@@ -130,6 +131,10 @@ public:
   // make accessing the objects in that order inefficient.
   void for_each(std::function<void(const oid &)> visitor);
 
+  // Same as above, stopping once `token` is cancelled
+  void for_each(std::function<void(const oid &)> visitor,
+                const cancellation_token &token);
+
   // Determine the object-ID (sha1 hash) of a data buffer
   // The resulting SHA-1 OID will be the identifier for the data buffer as if
   // the data buffer it were to written to the ODB.
@@ -289,9 +294,12 @@ public:
 
     // Read from an odb stream
     // Most backends don't implement streaming reads
-    void read(char *buffer, size_t length) {
-      if (git_odb_stream_read(c_ptr_, buffer, length))
+    // Returns the number of bytes read, 0 at the end of the stream
+    size_t read(char *buffer, size_t length) {
+      const auto ret = git_odb_stream_read(c_ptr_, buffer, length);
+      if (ret < 0)
         throw git_exception();
+      return static_cast<size_t>(ret);
     }
 
     // Write to an odb stream
@@ -1,16 +1,48 @@
 #pragma once
 #include <cppgit2/git_exception.hpp>
 #include <cppgit2/libgit2_api.hpp>
+#include <cstdint>
+#include <cstring>
+#include <functional>
 #include <git2.h>
 #include <string>
+#include <vector>
+
+#if defined(__SSE2__) && (defined(__GNUC__) || defined(__clang__))
+#define CPPGIT2_OID_SSE2
+#include <emmintrin.h>
+#endif
 
 namespace cppgit2 {
 
-class oid : public libgit2_api {
+// Plain value type: unlike most wrappers, oid does not derive from
+// libgit2_api, so constructing and copying it has no global init cost.
+// Only the parsing constructors, which may report errors through
+// libgit2, make sure libgit2 is initialized.
+//
+// oid is a trivially copyable, 20-byte POD. It can be used as a key in
+// hashed containers (see std::hash<cppgit2::oid> below) and in sorted
+// vectors; equality and ordering are inlined and use SSE2 when available.
+class oid {
 public:
   // Default constructor
-  // Initializes libgit2
-  oid();
+  // Leaves the id uninitialized, like git_oid; use oid{} for all zeros
+  oid() = default;
+
+  // Construct from a 40-character hex literal
+  // Usable in constant expressions, e.g.,
+  //
+  //   constexpr oid empty_tree("4b825dc642cb6eb9a060e54bf8d69288fbee4904");
+  //
+  // Throws git_exception (at runtime) on invalid hex characters
+  explicit constexpr oid(const char (&hex)[GIT_OID_HEXSZ + 1])
+      : c_struct_{{hex_byte(hex, 0),  hex_byte(hex, 1),  hex_byte(hex, 2),
+                   hex_byte(hex, 3),  hex_byte(hex, 4),  hex_byte(hex, 5),
+                   hex_byte(hex, 6),  hex_byte(hex, 7),  hex_byte(hex, 8),
+                   hex_byte(hex, 9),  hex_byte(hex, 10), hex_byte(hex, 11),
+                   hex_byte(hex, 12), hex_byte(hex, 13), hex_byte(hex, 14),
+                   hex_byte(hex, 15), hex_byte(hex, 16), hex_byte(hex, 17),
+                   hex_byte(hex, 18), hex_byte(hex, 19)}} {}
 
   // Construct from string
   oid(const std::string &hex_string);
@@ -29,7 +61,9 @@ public:
   // < 0 if oid sorts before rhs
   // 0 if oid matches rhs
   // > 0 if oid sorts after rhs
-  int compare(const oid &rhs) const;
+  int compare(const oid &rhs) const {
+    return compare_raw(c_struct_.id, rhs.c_struct_.id);
+  }
 
   // Compare the first `length` hexadecimal characters
   // (packets of 4 bits) of two oid structures
@@ -45,7 +79,16 @@ public:
   bool is_zero() const;
 
   // Compare two oid structures for equality
-  bool operator==(const oid &rhs) const;
+  bool operator==(const oid &rhs) const {
+    return equal_raw(c_struct_.id, rhs.c_struct_.id);
+  }
+  bool operator!=(const oid &rhs) const { return !(*this == rhs); }
+
+  // Ordering (same as `compare`)
+  bool operator<(const oid &rhs) const { return compare(rhs) < 0; }
+  bool operator<=(const oid &rhs) const { return compare(rhs) <= 0; }
+  bool operator>(const oid &rhs) const { return compare(rhs) > 0; }
+  bool operator>=(const oid &rhs) const { return compare(rhs) >= 0; }
 
   // Check if an oid equals a hex formatted object id
   bool operator==(const std::string &rhs) const;
@@ -53,6 +96,15 @@ public:
   // Format oid into hex format string
   std::string to_hex_string(size_t n = GIT_OID_HEXSZ) const;
 
+  // Format many oids at once
+  // Every oid is formatted into its own 40-character string
+  static std::vector<std::string> to_hex_string(const std::vector<oid> &ids);
+
+  // Format many oids into one string, each id followed by `separator`
+  // The result is allocated once, e.g., for `git rev-list` style output
+  static std::string to_hex_string(const std::vector<oid> &ids,
+                                   char separator);
+
   // Format an oid into a loose-object path string
   //
   // Return string is "aa/...", where "aa" is the first two
@@ -102,7 +154,77 @@ public:
 
 private:
   friend class repository;
+
+  // Value of a single hex digit
+  static constexpr unsigned char hex_digit(char c) {
+    return (c >= '0' && c <= '9')
+               ? static_cast<unsigned char>(c - '0')
+               : (c >= 'a' && c <= 'f')
+                     ? static_cast<unsigned char>(c - 'a' + 10)
+                     : (c >= 'A' && c <= 'F')
+                           ? static_cast<unsigned char>(c - 'A' + 10)
+                           : throw git_exception("unable to parse OID - "
+                                                 "contains invalid characters");
+  }
+
+  // Byte `i` of a hex formatted object id
+  static constexpr unsigned char hex_byte(const char *hex, size_t i) {
+    return static_cast<unsigned char>((hex_digit(hex[2 * i]) << 4) |
+                                      hex_digit(hex[2 * i + 1]));
+  }
+
+  // memcmp-compatible comparison of two raw ids
+  static int compare_raw(const unsigned char *a, const unsigned char *b) {
+#ifdef CPPGIT2_OID_SSE2
+    const __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i *>(a));
+    const __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i *>(b));
+    const unsigned int mask =
+        ~static_cast<unsigned int>(_mm_movemask_epi8(_mm_cmpeq_epi8(va, vb))) &
+        0xFFFFu;
+    if (mask) {
+      const int i = __builtin_ctz(mask);
+      return static_cast<int>(a[i]) - static_cast<int>(b[i]);
+    }
+    return std::memcmp(a + 16, b + 16, GIT_OID_RAWSZ - 16);
+#else
+    return std::memcmp(a, b, GIT_OID_RAWSZ);
+#endif
+  }
+
+  // Equality of two raw ids
+  static bool equal_raw(const unsigned char *a, const unsigned char *b) {
+    uint32_t ta, tb;
+    std::memcpy(&ta, a + 16, sizeof(ta));
+    std::memcpy(&tb, b + 16, sizeof(tb));
+#ifdef CPPGIT2_OID_SSE2
+    const __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i *>(a));
+    const __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i *>(b));
+    return _mm_movemask_epi8(_mm_cmpeq_epi8(va, vb)) == 0xFFFF && ta == tb;
+#else
+    uint64_t a0, a1, b0, b1;
+    std::memcpy(&a0, a, sizeof(a0));
+    std::memcpy(&a1, a + 8, sizeof(a1));
+    std::memcpy(&b0, b, sizeof(b0));
+    std::memcpy(&b1, b + 8, sizeof(b1));
+    return ((a0 ^ b0) | (a1 ^ b1) | static_cast<uint64_t>(ta ^ tb)) == 0;
+#endif
+  }
+
   git_oid c_struct_;
 };
 
 } // namespace cppgit2
+
+namespace std {
+
+// Object ids are SHA-1 digests, i.e., already uniformly distributed,
+// so the leading bytes make a good hash
+template <> struct hash<cppgit2::oid> {
+  size_t operator()(const cppgit2::oid &id) const {
+    size_t result;
+    std::memcpy(&result, id.c_ptr()->id, sizeof(result));
+    return result;
+  }
+};
+
+} // namespace std
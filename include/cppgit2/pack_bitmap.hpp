@@ -0,0 +1,147 @@
+#pragma once
+#include <cppgit2/git_exception.hpp>
+#include <cppgit2/libgit2_api.hpp>
+#include <cppgit2/oid.hpp>
+#include <cppgit2/pack_index.hpp>
+#include <cstdint>
+#include <functional>
+#include <git2.h>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace cppgit2 {
+
+class repository;
+
+// Reader for git's pack reachability bitmaps (pack-*.bitmap)
+//
+// `git repack -adb` (or `repack.writeBitmaps`) stores, for a selection of
+// commits, an EWAH-compressed bitmap of every object in the pack that is
+// reachable from the commit. Bit `n` stands for the n-th object of the pack
+// in pack order. With these, "objects reachable from X but not Y" becomes a
+// couple of bitmap operations instead of two full graph walks.
+class pack_bitmap : public libgit2_api {
+public:
+  // Uncompressed set of pack objects, one bit per object in pack order
+  class bitset {
+  public:
+    // Empty bitset
+    bitset();
+
+    // Bitset of `size` bits, all cleared
+    explicit bitset(size_t size);
+
+    // Number of bits
+    size_t size() const;
+
+    // Check if bit `position` is set
+    bool test(size_t position) const;
+
+    // Set bit `position`, growing the bitset if needed
+    void set(size_t position);
+
+    // Number of set bits
+    size_t count() const;
+
+    // Set operations
+    // Operands of different sizes are treated as zero-extended
+    bitset &operator|=(const bitset &rhs);
+    bitset &operator&=(const bitset &rhs);
+    bitset &operator^=(const bitset &rhs);
+
+    // Clear every bit that is set in `rhs`
+    bitset &and_not(const bitset &rhs);
+
+    // Run operation for each set bit, in increasing order
+    void for_each(std::function<void(size_t position)> visitor) const;
+
+    // Access the 64-bit words
+    const std::vector<uint64_t> &words() const;
+
+  private:
+    friend class pack_bitmap;
+    size_t size_;
+    std::vector<uint64_t> words_;
+  };
+
+  // Open the pack bitmap of a repository (objects/pack/pack-*.bitmap)
+  // Throws git_exception if the repository has no bitmap
+  explicit pack_bitmap(const repository &repo);
+
+  // Open a specific .bitmap file
+  // The pack index (.idx) must be next to it
+  pack_bitmap(const repository &repo, const std::string &bitmap_path);
+
+  // Number of objects in the pack, i.e., the size of each bitmap
+  size_t object_count() const;
+
+  // Number of commits with a stored bitmap
+  size_t commit_count() const;
+
+  // Check if a commit has a stored bitmap
+  bool has_bitmap(const oid &commit_id) const;
+
+  // Stored bitmap of a commit
+  // Throws git_exception if the commit has no stored bitmap
+  bitset bitmap(const oid &commit_id) const;
+
+  // Objects reachable from `commits`
+  //
+  // Commits without a stored bitmap are walked (commits and trees) until
+  // commits with a bitmap are reached. Objects that are not in the pack,
+  // e.g., loose objects, have no bit and are left out.
+  bitset reachable(const std::vector<oid> &commits) const;
+
+  // Objects reachable from `include` but not from `exclude`
+  bitset reachable(const std::vector<oid> &include,
+                   const std::vector<oid> &exclude) const;
+
+  // Type bitmaps: every commit, tree, blob or tag in the pack
+  const bitset &commits() const;
+  const bitset &trees() const;
+  const bitset &blobs() const;
+  const bitset &tags() const;
+
+  // Check if an object is in the pack
+  bool contains(const oid &id) const;
+
+  // Bit position (pack order) of an object
+  // Throws git_exception if the object is not in the pack
+  size_t position(const oid &id) const;
+
+  // Object at bit position `position`
+  oid object_id(size_t position) const;
+
+  // Run operation for each object in `objects`
+  // The visitor returns true to continue and false to stop
+  void for_each_object(const bitset &objects,
+                       std::function<bool(const oid &)> visitor) const;
+
+private:
+  void open(const std::string &bitmap_path);
+  bool find(const oid &id, size_t &position) const;
+
+  // Mark the objects reachable from a commit that has no stored bitmap
+  void walk(const oid &commit_id, bitset &result,
+            std::vector<oid> &pending) const;
+
+  git_repository *repo_;
+
+  // Pack index and the mapping between index (sorted) and pack order
+  pack_index index_;
+  std::vector<uint32_t> pack_to_index_;
+  std::vector<uint32_t> index_to_pack_;
+
+  // Bitmap file
+  struct entry {
+    size_t offset;     // Offset of the EWAH bitmap in data_
+    size_t xor_offset; // Bitmap is XOR-ed with the one `xor_offset` back
+  };
+  std::vector<unsigned char> data_;
+  std::vector<entry> entries_;
+  std::unordered_map<oid, size_t> commit_entries_;
+  bitset commits_, trees_, blobs_, tags_;
+};
+
+} // namespace cppgit2
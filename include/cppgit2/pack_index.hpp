@@ -0,0 +1,60 @@
+#pragma once
+#include <cppgit2/git_exception.hpp>
+#include <cppgit2/libgit2_api.hpp>
+#include <cppgit2/oid.hpp>
+#include <cstdint>
+#include <git2.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace cppgit2 {
+
+class repository;
+
+// Reader for version 2 pack index files (objects/pack/pack-*.idx)
+//
+// Maps the objects of a pack, sorted by id, to their offsets in the pack
+// file. The index is memory-mapped, so opening one is cheap and only the
+// pages that lookups touch are read. Copies share the mapping.
+class pack_index : public libgit2_api {
+public:
+  // Map a .idx file
+  // Throws git_exception if the file is missing, not a version 2 index, or
+  // truncated
+  explicit pack_index(const std::string &path);
+
+  // Paths of the pack indexes in a repository's objects/pack directory,
+  // sorted by name
+  static std::vector<std::string> paths(const repository &repo);
+
+  // Paths of the pack indexes in a pack directory, sorted by name
+  static std::vector<std::string> paths(const std::string &pack_dir);
+
+  // Path of the .idx file
+  const std::string &path() const;
+
+  // Number of objects in the pack
+  size_t size() const;
+
+  // Id of the n-th object, in index (i.e., sorted) order
+  oid id(size_t n) const;
+
+  // Offset of the n-th object in the pack file
+  uint64_t offset(size_t n) const;
+
+  // Find the index order position of an object
+  // Returns false if the object is not in the pack
+  bool find(const oid &id, size_t &n) const;
+
+  // SHA-1 checksum of the pack file
+  oid pack_checksum() const;
+
+private:
+  std::string path_;
+  std::shared_ptr<const unsigned char> data_; // mapped file
+  size_t data_size_;
+  size_t size_;
+};
+
+} // namespace cppgit2
@@ -0,0 +1,113 @@
+#pragma once
+#include <chrono>
+#include <cppgit2/blame.hpp>
+#include <cppgit2/git_exception.hpp>
+#include <cppgit2/libgit2_api.hpp>
+#include <cppgit2/oid.hpp>
+#include <deque>
+#include <git2.h>
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace cppgit2 {
+
+class repository;
+
+// Blame many files with one history walk
+//
+// repository::blame_file walks the history once per file. Here, every
+// commit is visited once for all the files: its tree is diffed once with
+// each parent (renames are only looked for when a blamed file is new in the
+// commit), and that diff tells which files are unchanged and pass their
+// lines to the parent as is. The files changed by the commit have their
+// blobs diffed with the parent's blobs by a pool of worker threads.
+//
+// Lines are attributed like repository::blame_file does: lines that a
+// merge shares with one of its parents are passed to that parent, the
+// first parents first, and renames are followed. Commits are visited
+// newest first, by commit time, and the walk ends as soon as every line
+// (of the range given by blame::options, if any) is attributed.
+//
+// For interactive use, the walk can be bounded in time or in commits; see
+// limits. What it found by then is returned, with the lines it could not
+// attribute marked as unresolved.
+//
+// The constructor opens one repository handle per thread; the handles, and
+// the objects libgit2 caches in them, are kept from one blame to the next.
+class parallel_blame : public libgit2_api {
+public:
+  // Blame of a set of files
+  // Owns the hunks, which are only valid as long as the result is.
+  class result {
+  public:
+    // Blamed paths, sorted
+    std::vector<std::string> paths() const;
+
+    // Hunks of `path`, in line order
+    // Throws git_exception if `path` was not blamed
+    const std::vector<blame::hunk> &hunks(const std::string &path) const;
+
+    // Check if every line was attributed within the limits
+    bool is_complete() const;
+
+    // Lines of `path` left unresolved by the limits, as 1-based
+    // {first line, number of lines} ranges
+    // Their hunks are attributed to the commit they were suspected on when
+    // the walk stopped: the lines were last changed by that commit or by
+    // one of its ancestors. Throws git_exception if `path` was not blamed.
+    const std::vector<std::pair<size_t, size_t>> &
+    unresolved_lines(const std::string &path) const;
+
+  private:
+    friend class parallel_blame;
+    typedef std::unique_ptr<git_signature, void (*)(git_signature *)>
+        owned_signature;
+
+    std::map<std::string, std::vector<blame::hunk>> files_;
+    std::map<std::string, std::vector<std::pair<size_t, size_t>>>
+        unresolved_;
+    std::deque<git_blame_hunk> hunks_;
+    std::set<std::string> orig_paths_;
+    std::vector<owned_signature> signatures_;
+  };
+
+  // Bounds on the work of a blame
+  // Checked before every commit is visited, so a commit with large changes
+  // can run over the time limit. Zero means no limit.
+  struct limits {
+    limits()
+        : time_limit(std::chrono::steady_clock::duration::zero()),
+          max_commits(0) {}
+
+    std::chrono::steady_clock::duration time_limit;
+    size_t max_commits;
+  };
+
+  // Prepare blames in `repo` using `thread_count` threads
+  // 0 uses one thread per hardware thread
+  explicit parallel_blame(const repository &repo, size_t thread_count = 0);
+
+  ~parallel_blame();
+
+  // Number of worker threads
+  size_t thread_count() const;
+
+  // Blame every file of `paths`
+  // `options` apply to every file: newest and oldest commit, first parent
+  // only, mailmap, and the range of lines to blame.
+  // Stops early, with unresolved lines, once `bounds` are reached.
+  // Throws git_exception if a path is not a file in the newest commit.
+  result blame_files(const std::vector<std::string> &paths,
+                     blame::options options = blame::options(),
+                     limits bounds = limits());
+
+private:
+  std::string path_;
+  std::vector<std::unique_ptr<repository>> handles_;
+};
+
+} // namespace cppgit2
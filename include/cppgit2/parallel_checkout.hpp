@@ -0,0 +1,72 @@
+#pragma once
+#include <cppgit2/checkout.hpp>
+#include <cppgit2/git_exception.hpp>
+#include <cppgit2/libgit2_api.hpp>
+#include <cppgit2/object.hpp>
+#include <git2.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace cppgit2 {
+
+class repository;
+
+// Multi-threaded checkout
+//
+// Works like repository::checkout_tree, for the common case of files that
+// do not exist in the working directory yet (fresh checkouts, new files
+// of a branch switch): the files to write are computed with a diff from
+// the baseline (HEAD by default) to the target, and worker threads inflate
+// the blobs, apply the filters (e.g., CRLF) and write them. Directories are
+// created first, in path order, so parents always exist before their
+// contents. The index entries of the written files are then added in one
+// go.
+//
+// Everything that needs libgit2's safety checks (files that already exist,
+// removals, conflicts) is handed over to git_checkout_tree, restricted to
+// those paths. If it refuses the checkout, the files written by the workers
+// are removed again. Changed .gitattributes files that cannot be written
+// that way are handed over first, before the filters of the other files are
+// applied. Strategies other than safe/force, recreate_missing,
+// dont_update_index, dont_write_index and disable_pathspec_match are
+// passed to git_checkout_tree as a whole, as are checkouts with a notify
+// callback, and everything on Windows.
+//
+// The progress callback of the options is called for each written file.
+// Each worker reads blobs through its own repository handle, opened by the
+// constructor.
+class parallel_checkout : public libgit2_api {
+public:
+  // Prepare checkouts in `repo` using `thread_count` threads
+  // 0 uses one thread per hardware thread
+  explicit parallel_checkout(const repository &repo, size_t thread_count = 0);
+
+  ~parallel_checkout();
+
+  // Number of worker threads
+  size_t thread_count() const;
+
+  // Maximum size of the blobs, and of their filtered contents, held in
+  // memory at once across all threads
+  // A single blob larger than this is still checked out, on its own.
+  // 64MB by default.
+  size_t memory_limit() const;
+  void set_memory_limit(size_t bytes);
+
+  // Update the working directory and the index to match `treeish`
+  // See repository::checkout_tree
+  void checkout_tree(const object &treeish,
+                     const checkout::options &options = checkout::options());
+
+  // Update the working directory and the index to match the tree of HEAD
+  // See repository::checkout_head
+  void checkout_head(const checkout::options &options = checkout::options());
+
+private:
+  std::string path_;
+  std::vector<std::unique_ptr<repository>> handles_;
+  size_t memory_limit_;
+};
+
+} // namespace cppgit2
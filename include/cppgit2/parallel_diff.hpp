@@ -0,0 +1,60 @@
+#pragma once
+#include <cppgit2/diff.hpp>
+#include <cppgit2/git_exception.hpp>
+#include <cppgit2/libgit2_api.hpp>
+#include <cppgit2/tree.hpp>
+#include <functional>
+#include <git2.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace cppgit2 {
+
+class repository;
+
+// Multi-threaded tree-to-tree diff
+//
+// Reports the same files as repository::create_diff_tree_to_tree with the
+// default options: added, deleted and modified files (including symlinks
+// and submodules), with changes of type reported as a deletion followed by
+// an addition. Renames are not detected, and no git_diff is built: deltas
+// are handed to the visitor as they are found.
+//
+// Subtrees are compared by worker threads, taking directories from a
+// shared queue. Subtrees with the same id on both sides are skipped
+// without being read, so the cost depends on the size of the change, not
+// on the size of the trees.
+//
+// Trees are read through one repository handle per thread, opened by the
+// constructor.
+class parallel_diff : public libgit2_api {
+public:
+  // Prepare diffs in `repo` using `thread_count` threads
+  // 0 uses one thread per hardware thread
+  explicit parallel_diff(const repository &repo, size_t thread_count = 0);
+
+  ~parallel_diff();
+
+  // Number of worker threads
+  size_t thread_count() const;
+
+  // Run a callback for each file that differs between `old_tree` and
+  // `new_tree`
+  //
+  // A default-constructed tree stands for the empty tree. With `sorted`,
+  // deltas are collected and reported in path order once the diff is
+  // complete. Otherwise they are reported as soon as they are found, in
+  // no particular order. Calls to the visitor are serialized; the visitor
+  // returns true to continue and false to stop. The paths of a delta are
+  // only valid during the call.
+  void for_each(const tree &old_tree, const tree &new_tree,
+                std::function<bool(const diff::delta &)> visitor,
+                bool sorted = false);
+
+private:
+  std::string path_;
+  std::vector<std::unique_ptr<repository>> handles_;
+};
+
+} // namespace cppgit2
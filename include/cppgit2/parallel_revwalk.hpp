@@ -0,0 +1,72 @@
+#pragma once
+#include <cppgit2/git_exception.hpp>
+#include <cppgit2/libgit2_api.hpp>
+#include <cppgit2/oid.hpp>
+#include <functional>
+#include <git2.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace cppgit2 {
+
+class repository;
+
+// Multi-threaded reachability walk from many roots
+//
+// Every worker thread opens its own handle to the repository (libgit2
+// repositories must not be shared between threads). The workers take the
+// commits to look up from a shared queue, newest queued first, and a
+// sharded visited set makes sure every commit is looked up exactly once.
+//
+// Use this instead of revwalk when the order of the commits does not
+// matter, or only needs to be by commit time, e.g., to compute everything
+// reachable from `refs/*`.
+class parallel_revwalk : public libgit2_api {
+public:
+  // Prepare a walk over `repo` using `thread_count` worker threads
+  // 0 uses one thread per hardware thread
+  explicit parallel_revwalk(const repository &repo, size_t thread_count = 0);
+
+  ~parallel_revwalk();
+
+  // Add a new root for the traversal
+  void push(const oid &id);
+
+  // Push matching references
+  // References that do not peel to a commit are ignored
+  void push_glob(const std::string &glob);
+
+  // Push the repository's HEAD
+  void push_head();
+
+  // Clear all the pushed commits
+  void reset();
+
+  // Number of worker threads
+  size_t thread_count() const;
+
+  // Run operation for each commit reachable from the roots, in no
+  // particular order
+  //
+  // Calls to the visitor are serialized, so it does not need to be
+  // thread-safe. The visitor returns true to continue and false to stop.
+  void for_each(std::function<bool(const oid &)> visitor);
+
+  // Run operation for each commit reachable from the roots, newest first
+  //
+  // The workers record commit times while walking; their results are
+  // merged by time once the walk is complete.
+  void for_each_by_time(std::function<bool(const oid &)> visitor);
+
+private:
+  // Walk in parallel, calling `visit` (from worker threads) for every commit
+  void walk(std::function<bool(size_t worker, const oid &id,
+                               git_time_t time)> visit);
+
+  std::string path_;
+  std::vector<std::unique_ptr<repository>> handles_;
+  std::vector<oid> roots_;
+};
+
+} // namespace cppgit2
@@ -0,0 +1,69 @@
+#pragma once
+#include <cppgit2/git_exception.hpp>
+#include <cppgit2/libgit2_api.hpp>
+#include <cppgit2/status.hpp>
+#include <cppgit2/untracked_cache.hpp>
+#include <functional>
+#include <git2.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace cppgit2 {
+
+class repository;
+
+// Multi-threaded working directory status
+//
+// Reports the same statuses as repository::for_each_status (i.e.,
+// git_status_foreach): changes between HEAD and the index, changes between
+// the index and the working directory, untracked and ignored files, and
+// conflicts. Renames are not detected and submodules are not examined.
+//
+// The index-to-workdir comparison is split across threads in chunks of the
+// sorted index entries (so every thread handles a few whole directories),
+// and untracked files are found by a parallel directory walk, which loads
+// the ignore rules of each directory once, as it reaches it. Files are
+// only hashed when their stat data differs from the index entry or the
+// entry is racy (modified in the same second the index was written). The
+// index itself is never refreshed or written.
+//
+// Each thread reads objects through its own repository handle, opened once
+// by the constructor and kept for every scan.
+class parallel_status : public libgit2_api {
+public:
+  // Prepare a status scan of `repo` using `thread_count` threads
+  // 0 uses one thread per hardware thread
+  explicit parallel_status(const repository &repo, size_t thread_count = 0);
+
+  ~parallel_status();
+
+  // Number of worker threads
+  size_t thread_count() const;
+
+  // Gather file statuses and run a callback for each one
+  //
+  // With `sorted`, statuses are collected and reported in path order once
+  // the scan is complete. Otherwise they are reported as soon as they are
+  // found, in no particular order. Calls to the visitor are serialized.
+  // Throws git_exception for bare repositories.
+  void for_each(
+      std::function<void(const std::string &, status::status_type)> visitor,
+      bool sorted = true);
+
+  // Same as above, using and updating `cache` to find untracked files
+  // The cache is not saved; see untracked_cache::save.
+  void for_each(
+      std::function<void(const std::string &, status::status_type)> visitor,
+      untracked_cache &cache, bool sorted = true);
+
+private:
+  void scan(
+      std::function<void(const std::string &, status::status_type)> visitor,
+      bool sorted, untracked_cache *cache);
+
+  std::string path_;
+  std::vector<std::unique_ptr<repository>> handles_;
+};
+
+} // namespace cppgit2
@@ -0,0 +1,120 @@
+#pragma once
+#include <cppgit2/diff.hpp>
+#include <cppgit2/git_exception.hpp>
+#include <cppgit2/libgit2_api.hpp>
+#include <cppgit2/oid.hpp>
+#include <git2.h>
+#include <list>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace cppgit2 {
+
+class repository;
+
+// Rename and copy detection for tree-to-tree diffs
+//
+// Pairs the deleted files of a diff (and, for copies, the old side of the
+// modified files) with its added files, like `git diff -M` / `-C`:
+// identical blobs first, then by similarity, best scores first. The
+// similarity of two blobs is the share of their content found in both, as
+// measured on chunks of up to 64 bytes ending at newlines (the same
+// estimate as git's diffcore), relative to the larger blob.
+//
+// Every blob is summarized once into a signature (the sizes of its chunks,
+// by chunk hash), by worker threads. Signatures are cached by blob id, so
+// blobs seen by earlier calls are not read again. Instead of scoring every
+// source against every target, the sources are indexed by chunk hash and
+// each target is only scored against the sources it shares chunks with.
+//
+// Blobs are read through one repository handle per worker thread, opened
+// once by the constructor.
+// Not thread-safe: use one detector per thread.
+class rename_detector : public libgit2_api {
+public:
+  // A rename or copy
+  struct match {
+    std::string old_path;
+    std::string new_path;
+    oid old_id;
+    oid new_id;
+    uint16_t similarity; // 0 to 100
+    bool is_copy;
+  };
+
+  // Prepare rename detection in `repo` using `thread_count` threads
+  // 0 uses one thread per hardware thread
+  explicit rename_detector(const repository &repo, size_t thread_count = 0);
+
+  ~rename_detector();
+
+  // Number of worker threads
+  size_t thread_count() const;
+
+  // Minimum similarity of a rename or copy, in percent
+  // 50 by default, as in git.
+  uint16_t threshold() const;
+  void set_threshold(uint16_t percent);
+
+  // Maximum number of sources and of targets for inexact detection
+  // Above `limit` * `limit` source/target pairs, only identical files are
+  // paired. 1000 by default, as git's diff.renameLimit.
+  size_t rename_limit() const;
+  void set_rename_limit(size_t limit);
+
+  // Also look for copies, from modified files and from deleted files that
+  // are already renamed
+  // Off by default.
+  bool find_copies() const;
+  void set_find_copies(bool enabled);
+
+  // Maximum number of signatures kept between calls, 100000 by default
+  // The least recently used are dropped first.
+  size_t cache_capacity() const;
+  void set_cache_capacity(size_t capacity);
+
+  // Number of cached signatures
+  size_t cache_size() const;
+
+  // Drop all the cached signatures
+  void clear_cache();
+
+  // Find the renames (and copies) of a tree-to-tree diff, in path order of
+  // the new files
+  // Empty files and submodules are never paired.
+  std::vector<match> find(const diff &changes);
+
+  // Whether the last call to find skipped inexact detection because of
+  // the rename limit
+  bool limit_exceeded() const;
+
+private:
+  // Content summary of a blob: total size, and the sizes of its chunks
+  // sorted by chunk hash
+  struct signature {
+    uint64_t size;
+    std::vector<std::pair<uint32_t, uint32_t>> chunks;
+  };
+
+  // Signatures of `ids`, from the cache or computed by the workers
+  std::vector<std::shared_ptr<const signature>>
+  signatures(const std::vector<oid> &ids);
+
+  std::string path_;
+  std::vector<std::unique_ptr<repository>> handles_;
+  uint16_t threshold_;
+  size_t rename_limit_;
+  bool find_copies_;
+  size_t cache_capacity_;
+  bool limit_exceeded_;
+
+  // Most recently used first
+  typedef std::pair<oid, std::shared_ptr<const signature>> cache_entry;
+  std::list<cache_entry> cache_;
+  std::unordered_map<oid, std::list<cache_entry>::iterator> cache_index_;
+};
+
+} // namespace cppgit2
@@ -1,15 +1,20 @@
 #pragma once
 #include <cppgit2/annotated_commit.hpp>
 #include <cppgit2/apply.hpp>
+#include <cppgit2/async_executor.hpp>
 #include <cppgit2/attribute.hpp>
 #include <cppgit2/bitmask_operators.hpp>
 #include <cppgit2/blame.hpp>
+#include <cppgit2/blame_cache.hpp>
 #include <cppgit2/blob.hpp>
+#include <cppgit2/blob_reader.hpp>
 #include <cppgit2/branch.hpp>
+#include <cppgit2/cancellation_token.hpp>
 #include <cppgit2/checkout.hpp>
 #include <cppgit2/cherrypick.hpp>
 #include <cppgit2/clone.hpp>
 #include <cppgit2/commit.hpp>
+#include <cppgit2/commit_graph.hpp>
 #include <cppgit2/config.hpp>
 #include <cppgit2/data_buffer.hpp>
 #include <cppgit2/fetch.hpp>
@@ -18,24 +23,38 @@
 #include <cppgit2/libgit2_api.hpp>
 #include <cppgit2/note.hpp>
 #include <cppgit2/object.hpp>
+#include <cppgit2/object_loader.hpp>
 #include <cppgit2/oid.hpp>
+#include <cppgit2/pack_bitmap.hpp>
 #include <cppgit2/pack_builder.hpp>
+#include <cppgit2/pack_index.hpp>
+#include <cppgit2/parallel_blame.hpp>
+#include <cppgit2/parallel_checkout.hpp>
+#include <cppgit2/parallel_diff.hpp>
+#include <cppgit2/parallel_revwalk.hpp>
+#include <cppgit2/parallel_status.hpp>
 #include <cppgit2/pathspec.hpp>
 #include <cppgit2/rebase.hpp>
 #include <cppgit2/refdb.hpp>
 #include <cppgit2/reference.hpp>
 #include <cppgit2/remote.hpp>
+#include <cppgit2/rename_detector.hpp>
+#include <cppgit2/repository_pool.hpp>
 #include <cppgit2/reset.hpp>
 #include <cppgit2/revert.hpp>
 #include <cppgit2/revision.hpp>
 #include <cppgit2/revparse.hpp>
 #include <cppgit2/revspec.hpp>
 #include <cppgit2/revwalk.hpp>
+#include <cppgit2/settings.hpp>
+#include <cppgit2/sparse_checkout.hpp>
 #include <cppgit2/stash.hpp>
 #include <cppgit2/status.hpp>
+#include <cppgit2/status_monitor.hpp>
 #include <cppgit2/submodule.hpp>
 #include <cppgit2/tag.hpp>
 #include <cppgit2/tree_builder.hpp>
+#include <cppgit2/untracked_cache.hpp>
 #include <cppgit2/worktree.hpp>
 #include <functional>
 #include <git2.h>
@@ -269,10 +288,21 @@ public:
                          bool)>
           visitor) const;
 
+  // Same as above, stopping once `token` is cancelled
+  void for_each_fetch_head(
+      std::function<void(const std::string &, const std::string &, const oid &,
+                         bool)>
+          visitor,
+      const cancellation_token &token) const;
+
   // If a merge is in progress, invoke 'visitor'
   // for each commit ID in the MERGE_HEAD file.
   void for_each_merge_head(std::function<void(const oid &)> visitor) const;
 
+  // Same as above, stopping once `token` is cancelled
+  void for_each_merge_head(std::function<void(const oid &)> visitor,
+                           const cancellation_token &token) const;
+
   // Currently active namespace for this repo
   std::string namespace_() const;
 
@@ -480,6 +510,12 @@ public:
       attribute::flag flags, const std::string &path,
       std::function<void(const std::string &, const std::string &)> visitor) const;
 
+  // Same as above, stopping once `token` is cancelled
+  void for_each_attribute(
+      attribute::flag flags, const std::string &path,
+      std::function<void(const std::string &, const std::string &)> visitor,
+      const cancellation_token &token) const;
+
   // Look up the value of one git attribute for path.
   std::string lookup_attribute(attribute::flag flags, const std::string &path,
                                const std::string &name) const;
@@ -715,6 +751,43 @@ public:
                        const commit &start_from,
                        revision::sort sort_ordering = revision::sort::none) const;
 
+  // Same as above, stopping once `token` is cancelled
+  // The walk is incremental with the default sort ordering, so the rest of
+  // the history is not read.
+  void for_each_commit(std::function<void(const commit &id)> visitor,
+                       const cancellation_token &token,
+                       revision::sort sort_ordering = revision::sort::none) const;
+  void for_each_commit(std::function<void(const commit &id)> visitor,
+                       const commit &start_from,
+                       const cancellation_token &token,
+                       revision::sort sort_ordering = revision::sort::none) const;
+
+  // Streaming versions of for_each_commit
+  //
+  // The visitor returns true to continue and false to stop the walk, e.g.,
+  // for `git log | head` style queries. With the default sort ordering, the
+  // walk is incremental, so stopping early skips the rest of the history.
+
+  // Run operation for each commit id, without looking up the commits
+  void for_each_commit_id(std::function<bool(const oid &)> visitor,
+                          revision::sort sort_ordering = revision::sort::none) const;
+
+  // Run operation for each commit id reachable from `start_from`
+  void for_each_commit_id(std::function<bool(const oid &)> visitor,
+                          const oid &start_from,
+                          revision::sort sort_ordering = revision::sort::none) const;
+
+  // Run operation for each commit, loading each commit only if the visitor
+  // asks for more than its id
+  void for_each_commit_view(std::function<bool(const commit_view &)> visitor,
+                            revision::sort sort_ordering = revision::sort::none) const;
+
+  // Run operation for each commit reachable from `start_from`, loading each
+  // commit only if the visitor asks for more than its id
+  void for_each_commit_view(std::function<bool(const commit_view &)> visitor,
+                            const oid &start_from,
+                            revision::sort sort_ordering = revision::sort::none) const;
+
   /*
    * CONFIG API
    * See git_config_* functions
@@ -918,6 +991,11 @@ public:
   void for_each_note(const std::string &notes_ref,
                      std::function<void(const oid &, const oid &)> visitor) const;
 
+  // Same as above, stopping once `token` is cancelled
+  void for_each_note(const std::string &notes_ref,
+                     std::function<void(const oid &, const oid &)> visitor,
+                     const cancellation_token &token) const;
+
   /*
    * OBJECT API
    * See git_object_* functions
@@ -939,6 +1017,14 @@ public:
   object lookup_object(const object &treeish, const std::string &path,
                        object::object_type type) const;
 
+  // Lookup many objects at once
+  // Objects are read in pack order; the result is in the order of `ids`.
+  // This maps the pack indexes on every call, use object_loader to look up
+  // several batches.
+  std::vector<object>
+  lookup_objects(const std::vector<oid> &ids,
+                 object::object_type type = object::object_type::any) const;
+
   /*
    * PACKBUILDER API
    * See git_packbuilder_* functions
@@ -1029,6 +1115,10 @@ public:
   // Perform a callback on each reference in the repository.
   void for_each_reference(std::function<void(const reference &)> visitor) const;
 
+  // Same as above, stopping once `token` is cancelled
+  void for_each_reference(std::function<void(const reference &)> visitor,
+                          const cancellation_token &token) const;
+
   // Callback used to iterate over reference names
   void
   for_each_reference_name(std::function<void(const std::string &)> visitor) const;
@@ -1207,6 +1297,11 @@ public:
       std::function<void(size_t, const std::string &, const oid &)> visitor)
       const;
 
+  // Same as above, stopping once `token` is cancelled
+  void for_each_stash(
+      std::function<void(size_t, const std::string &, const oid &)> visitor,
+      const cancellation_token &token) const;
+
   // Apply a single stashed state from the stash list
   // and remove it from the list if successful.
   void
@@ -1234,6 +1329,15 @@ public:
       const status::options &options,
       std::function<void(const std::string &, status::status_type)> visitor) const;
 
+  // Same as above, stopping once `token` is cancelled
+  void for_each_status(
+      std::function<void(const std::string &, status::status_type)> visitor,
+      const cancellation_token &token) const;
+  void for_each_status(
+      const status::options &options,
+      std::function<void(const std::string &, status::status_type)> visitor,
+      const cancellation_token &token) const;
+
   // Gather file status information and populate the git_status_list.
   status::list status_list(const status::options &options = status::options()) const;
 
@@ -1270,6 +1374,11 @@ public:
   void for_each_submodule(
       std::function<void(const submodule &, const std::string &)> visitor) const;
 
+  // Same as above, stopping once `token` is cancelled
+  void for_each_submodule(
+      std::function<void(const submodule &, const std::string &)> visitor,
+      const cancellation_token &token) const;
+
   // Lookup submodule information by name or path.
   submodule lookup_submodule(const std::string &name) const;
 
@@ -1330,6 +1439,19 @@ public:
   void
   for_each_tag(std::function<void(const std::string &, const oid &)> visitor) const;
 
+  // Same as above, stopping once `token` is cancelled, e.g., to find the
+  // first matching tag:
+  //
+  //   cancellation_token found;
+  //   repo.for_each_tag([&](const std::string &name, const oid &id) {
+  //     if (id == target) {
+  //       result = name;
+  //       found.cancel();
+  //     }
+  //   }, found);
+  void for_each_tag(std::function<void(const std::string &, const oid &)> visitor,
+                    const cancellation_token &token) const;
+
   // Fill a list with all the tags in the Repository
   // The string array will be filled with the names of the matching tags;
   // these values are owned by the user.
@@ -1395,11 +1517,22 @@ public:
   worktree open_worktree() const;
 
 private:
+  friend class async_executor;
+  friend class blame_cache;
   friend class index;
+  friend class parallel_blame;
+  friend class parallel_checkout;
+  friend class parallel_diff;
+  friend class parallel_revwalk;
+  friend class parallel_status;
   friend class pathspec;
   friend class remote;
+  friend class rename_detector;
+  friend class sparse_checkout;
+  friend class status_monitor;
   friend class submodule;
   friend class tree_builder;
+  friend class untracked_cache;
   git_repository *c_ptr_;
 };
 ENABLE_BITMASK_OPERATORS(repository::init_flag);
@@ -0,0 +1,134 @@
+#pragma once
+#include <chrono>
+#include <condition_variable>
+#include <cppgit2/git_exception.hpp>
+#include <cppgit2/libgit2_api.hpp>
+#include <git2.h>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace cppgit2 {
+
+class repository;
+
+// Pool of repository handles for concurrent readers
+//
+// A libgit2 repository must not be used by two threads at once. A thread
+// checks out a handle from the pool, uses it alone, and the handle goes
+// back to the pool when the checkout is destroyed. Handles are opened on
+// the same path when needed, up to max_size(), and then reused: a checkout
+// with every handle in use waits for one to be returned.
+//
+// With libgit2 1.2 or later, all the handles share one object database, so
+// pack indexes and windows mapped by one are reused by the others. Earlier
+// object databases are not safe to use from several threads, and each handle
+// has its own. Either way, the cache of parsed objects belongs to each handle,
+// and references are read through each handle's own reference database.
+//
+// The pool must outlive its checkouts.
+class repository_pool : public libgit2_api {
+public:
+  // Handle checked out from a pool, returned when destroyed
+  class handle {
+  public:
+    handle(handle &&other);
+    handle &operator=(handle &&other);
+    ~handle();
+
+    handle(const handle &) = delete;
+    handle &operator=(const handle &) = delete;
+
+    // Check if the handle holds a repository (e.g., try_checkout succeeded)
+    explicit operator bool() const;
+
+    // Repository, for use by this thread only, until the handle is returned
+    // Do not copy it: copies share the libgit2 repository.
+    repository &operator*() const;
+    repository *operator->() const;
+
+    // Return the repository to the pool now
+    void reset();
+
+  private:
+    friend class repository_pool;
+    handle(repository_pool *pool, std::unique_ptr<repository> repo);
+
+    repository_pool *pool_;
+    std::unique_ptr<repository> repo_;
+  };
+
+  // Pool of up to `max_size` handles on `repo`'s path
+  // 0 allows one handle per hardware thread
+  explicit repository_pool(const repository &repo, size_t max_size = 0);
+
+  // Pool of up to `max_size` handles on the repository at `path`
+  // Throws git_exception if it cannot be opened
+  explicit repository_pool(const std::string &path, size_t max_size = 0);
+
+  ~repository_pool();
+
+  repository_pool(const repository_pool &) = delete;
+  repository_pool &operator=(const repository_pool &) = delete;
+
+  // Check out a handle, waiting for one if all are in use
+  // Throws git_exception if a new handle cannot be opened
+  handle checkout();
+
+  // Check out a handle, waiting at most `timeout`
+  // Returns an empty handle if none was returned in time
+  handle checkout(std::chrono::steady_clock::duration timeout);
+
+  // Check out a handle if one is available or can be opened, without
+  // waiting; returns an empty handle otherwise
+  handle try_checkout();
+
+  // Maximum number of handles
+  size_t max_size() const;
+
+  // Number of handles opened, and of handles checked out
+  size_t size() const;
+  size_t in_use() const;
+
+  // Number of checkouts, and of those that had to wait
+  size_t checkouts() const;
+  size_t waits() const;
+
+  // Time spent waiting for a handle, in total and by the longest wait
+  // Checkouts that timed out are counted as waits.
+  std::chrono::steady_clock::duration total_wait_time() const;
+  std::chrono::steady_clock::duration max_wait_time() const;
+
+  // Reset the counters and wait times (e.g., at every metrics report)
+  void reset_metrics();
+
+private:
+  void open(size_t max_size);
+
+  // Take an idle handle, or open one if below max_size(); null otherwise
+  // Called with `lock` held, which is released while a handle is opened.
+  std::unique_ptr<repository> take(std::unique_lock<std::mutex> &lock);
+
+  // Wait for a handle until `deadline`, or forever if `bounded` is false
+  handle wait(bool bounded, std::chrono::steady_clock::time_point deadline);
+
+  void give_back(std::unique_ptr<repository> repo);
+
+  std::string path_;
+  size_t max_size_;
+  std::unique_ptr<git_odb, void (*)(git_odb *)> odb_; // null if not shared
+
+  mutable std::mutex mutex_;
+  std::condition_variable returned_;
+  std::vector<std::unique_ptr<repository>> idle_;
+  size_t opened_;
+  size_t in_use_;
+
+  size_t checkouts_;
+  size_t waits_;
+  std::chrono::steady_clock::duration total_wait_;
+  std::chrono::steady_clock::duration max_wait_;
+};
+
+} // namespace cppgit2
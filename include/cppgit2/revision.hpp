@@ -1,3 +1,4 @@
+#pragma once
 #include <cppgit2/bitmask_operators.hpp>
 
 namespace cppgit2 {
@@ -0,0 +1,46 @@
+#pragma once
+#include <cppgit2/git_exception.hpp>
+#include <cppgit2/libgit2_api.hpp>
+#include <cppgit2/object.hpp>
+#include <git2.h>
+
+namespace cppgit2 {
+
+// Process-wide libgit2 settings (see git_libgit2_opts)
+//
+// These apply to every repository opened by the process; set them once at
+// startup, before repositories are opened, e.g., in a long-running server.
+class settings : public libgit2_api {
+public:
+  // Memory used by the object caches of all repositories
+  struct cache_statistics {
+    size_t current_bytes; // Bytes currently held by the caches
+    size_t max_bytes;     // Maximum size (see set_cache_max_size)
+  };
+
+  // Enable or disable caching of parsed objects
+  // Disabling the cache may cause serious performance degradation
+  static void enable_caching(bool enabled);
+
+  // Maximum memory the object caches may use, across all repositories
+  // libgit2's default is 256MB
+  static void set_cache_max_size(size_t bytes);
+
+  // Largest object of type `type` that will be cached
+  // 0 disables caching for the type. libgit2 caches commits, trees and tags
+  // up to 4KB by default, and no blobs.
+  static void set_cache_object_limit(object::object_type type, size_t bytes);
+
+  // Current and maximum size of the object caches
+  static cache_statistics cache_stats();
+
+  // Size of the windows mapped into memory from pack files
+  static size_t mwindow_size();
+  static void set_mwindow_size(size_t bytes);
+
+  // Maximum memory mapped from pack files at any time
+  static size_t mwindow_mapped_limit();
+  static void set_mwindow_mapped_limit(size_t bytes);
+};
+
+} // namespace cppgit2
@@ -0,0 +1,90 @@
+#pragma once
+#include <cppgit2/git_exception.hpp>
+#include <cppgit2/libgit2_api.hpp>
+#include <cppgit2/tree.hpp>
+#include <git2.h>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace cppgit2 {
+
+class repository;
+
+// Cone-mode sparse checkout
+//
+// The cone is a set of directories whose whole contents are checked out,
+// e.g., "src/lib". The files directly inside the root and inside every
+// parent of those directories ("src/") are checked out as well; nothing
+// else is. This is the same model as `git sparse-checkout --cone`, and the
+// patterns are stored in the same place (.git/info/sparse-checkout).
+//
+// libgit2 has no sparse checkout support of its own, so:
+//  - apply() updates the index (skip-worktree bits) and the working
+//    directory,
+//  - checkout::options::set_sparse_checkout restricts later checkouts to
+//    the cone,
+//  - index::for_each(cone, visitor) only visits entries of the cone.
+// All three only visit the directories of the cone and their parents, not
+// the directories outside of it.
+class sparse_checkout : public libgit2_api {
+public:
+  // Cone with the files at the root only
+  sparse_checkout();
+
+  // Cone of `directories`, e.g., {"src/lib", "docs"}
+  explicit sparse_checkout(const std::vector<std::string> &directories);
+
+  // Load the cone of `repo` from .git/info/sparse-checkout
+  // Throws git_exception if the patterns are not in cone mode
+  explicit sparse_checkout(const repository &repo);
+
+  // Add a directory, and all its contents, to the cone
+  void add(const std::string &directory);
+
+  // Directories of the cone, without trailing slashes, in path order
+  std::vector<std::string> directories() const;
+
+  // Check if `path` (a file path, relative to the working directory) is
+  // inside the cone
+  bool contains(const std::string &path) const;
+
+  // Outermost directory of `path` that is outside the cone, with a trailing
+  // slash, or an empty string if `path` is inside the cone
+  std::string excluded_directory(const std::string &path) const;
+
+  // Cone-mode patterns, as written to .git/info/sparse-checkout
+  std::vector<std::string> patterns() const;
+
+  // Paths of `target` that are inside the cone: the files of the root and
+  // of the parent directories, and the cone directories themselves
+  // Meant for checkout pathspecs with exact matching; see
+  // checkout::options::set_sparse_checkout.
+  std::vector<std::string> paths(const tree &target) const;
+
+  // Write the patterns to .git/info/sparse-checkout of `repo` and enable
+  // core.sparseCheckout and core.sparseCheckoutCone
+  void save(const repository &repo) const;
+
+  // Make the index and the working directory of `repo` match the cone
+  //
+  // Index entries entering the cone lose their skip-worktree bit and are
+  // checked out. Entries leaving the cone get the bit, and their files are
+  // removed from the working directory, along with directories left empty.
+  // Modified files outside the cone are kept, and their entries are left
+  // as they were. Conflicted entries are not touched. Files are removed
+  // only after the index is written, so a failure leaves them in place.
+  void apply(const repository &repo) const;
+
+private:
+  // Check if a parent of `directory` is included with all its contents
+  bool is_covered(const std::string &directory) const;
+
+  // Directories (with a trailing slash) whose contents are all included
+  std::set<std::string> recursive_;
+
+  // Directories whose files are included, "" being the root
+  std::set<std::string> parents_;
+};
+
+} // namespace cppgit2
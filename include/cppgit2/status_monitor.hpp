@@ -0,0 +1,96 @@
+#pragma once
+#include <cppgit2/git_exception.hpp>
+#include <cppgit2/libgit2_api.hpp>
+#include <cppgit2/parallel_status.hpp>
+#include <cppgit2/status.hpp>
+#include <functional>
+#include <git2.h>
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <unordered_map>
+
+namespace cppgit2 {
+
+class repository;
+
+// Incremental working directory status, driven by filesystem events
+//
+// The first call to for_each runs a full (parallel_status) scan and starts
+// watching every directory of the working tree with inotify. Later calls
+// only re-examine the paths that changed since the previous call, with
+// git_status_file, and report the cached status of everything else. A path
+// that has become a directory is rescanned with everything below it.
+//
+// A full rescan happens when the watch queue overflows, when HEAD, the
+// index, the refs or a .gitignore change, when a nested repository appears,
+// or after invalidate(). Ignored directories and nested repositories are
+// not watched.
+//
+// On platforms without inotify, or when the watches cannot be created
+// (e.g., fs.inotify.max_user_watches is too low), every call is a full
+// scan; see is_watching().
+//
+// Not thread-safe: use one monitor per thread.
+class status_monitor : public libgit2_api {
+public:
+  // Monitor the working directory of `repo`
+  // `thread_count` is passed on to parallel_status for full scans
+  explicit status_monitor(const repository &repo, size_t thread_count = 0);
+
+  ~status_monitor();
+
+  status_monitor(const status_monitor &) = delete;
+  status_monitor &operator=(const status_monitor &) = delete;
+
+  // Check if filesystem events are being watched
+  bool is_watching() const;
+
+  // Force a full scan on the next call to for_each
+  void invalidate();
+
+  // Number of full scans so far
+  size_t full_scans() const;
+
+  // Gather file statuses and run a callback for each one, in path order
+  void for_each(
+      std::function<void(const std::string &, status::status_type)> visitor);
+
+private:
+  void full_scan();
+  void close_watches();
+
+  // Returns false if the cache can no longer be updated incrementally
+  bool read_events();
+  bool watch_tree(const std::string &directory, bool mark_dirty);
+  bool watch_git_dir(const std::string &directory);
+  void forget_tree(const std::string &directory);
+  void update(const std::string &path);
+
+  // Read the statuses of `path` and of everything below it again
+  void rescan_tree(const std::string &path);
+
+  std::unique_ptr<repository> repo_;
+  parallel_status scanner_;
+  std::string workdir_;
+  std::string git_dir_;
+
+  bool valid_;
+  bool watching_;
+  size_t full_scans_;
+
+  // Cached statuses, by path
+  std::map<std::string, unsigned int> statuses_;
+
+  // Paths that changed since the last call
+  std::set<std::string> dirty_;
+
+  // inotify descriptor and watched directories (with a trailing slash,
+  // relative to the working directory)
+  int fd_;
+  std::unordered_map<int, std::string> watches_;
+  std::set<int> git_dir_watches_;
+};
+
+} // namespace cppgit2
@@ -1,4 +1,5 @@
 #pragma once
+#include <cppgit2/cancellation_token.hpp>
 #include <cppgit2/file_mode.hpp>
 #include <cppgit2/git_exception.hpp>
 #include <cppgit2/libgit2_api.hpp>
@@ -135,6 +136,22 @@ public:
             std::function<void(const std::string &, const tree::entry &)>
                 visitor) const;
 
+  // What a walk does after visiting an entry
+  enum class walk_action {
+    proceed = 0,      // continue the walk
+    skip_subtree = 1, // don't walk into this entry (preorder only)
+    stop = 2          // end the walk
+  };
+
+  // Traverse the entries in a tree and its subtrees, letting the visitor
+  // skip subtrees or stop the walk
+  // The walk also stops once `token` is cancelled, e.g., from another
+  // thread.
+  void walk(traversal_mode mode,
+            std::function<walk_action(const std::string &, const tree::entry &)>
+                visitor,
+            const cancellation_token &token) const;
+
   enum class update_type {
     upsert, // Update or insert an entry at the specified path
     remove  // Remove an entry from the specified path
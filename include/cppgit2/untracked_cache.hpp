@@ -0,0 +1,106 @@
+#pragma once
+#include <cppgit2/git_exception.hpp>
+#include <cppgit2/libgit2_api.hpp>
+#include <cstdint>
+#include <git2.h>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace cppgit2 {
+
+class repository;
+
+// Untracked cache, used by parallel_status to find untracked files
+//
+// Plays the part of git's untracked cache (the UNTR index extension, which
+// libgit2 neither reads nor writes). For every directory of the working
+// tree, the cache keeps its listing and the ignore decision for each name,
+// along with the stat data of the directory and of its .gitignore. A
+// directory whose stat data is unchanged is not read again and its names
+// are not matched against the ignore rules again; only the (in-memory)
+// index lookups are repeated.
+//
+// A directory is listed again when it, or the .gitignore of one of its
+// parents, changed. The whole cache is dropped when .git/info/exclude or
+// core.excludesfile change. Directories modified in the second the scan
+// started are not cached (as with racy index entries).
+//
+// The cache is stored next to the index file, in "<index>.untracked".
+//
+// There is no split index counterpart: libgit2 cannot load split indexes
+// (their "link" extension is mandatory) and index::write always writes the
+// whole index. samples/benchmark_untracked_cache.cpp measures the cache.
+class untracked_cache : public libgit2_api {
+public:
+  // Load the cache of `repo`, if there is one
+  explicit untracked_cache(const repository &repo);
+
+  untracked_cache(const untracked_cache &) = delete;
+  untracked_cache &operator=(const untracked_cache &) = delete;
+
+  // Path of the cache file
+  std::string path() const;
+
+  // Number of cached directories
+  size_t size() const;
+
+  // Check if the cache changed since it was loaded or saved
+  bool is_modified() const;
+
+  // Forget every cached directory
+  void clear();
+
+  // Write the cache file, if the cache was modified
+  void save();
+
+private:
+  friend class parallel_status;
+
+  // Stat data of a directory or a .gitignore (zeroes if it is missing)
+  struct stamp {
+    int64_t seconds;
+    int64_t nanoseconds;
+    uint64_t size;
+    uint64_t inode;
+    bool operator==(const stamp &rhs) const;
+  };
+
+  struct entry {
+    std::string name;
+    bool is_directory;
+    int ignored; // -1 until checked
+  };
+
+  struct directory {
+    stamp directory_stamp;
+    stamp ignore_stamp;
+    bool valid;
+    bool visited;
+    std::vector<entry> entries;
+  };
+
+  // Drop the cache if the ignore rules from outside the working directory
+  // changed, and prepare for a scan
+  void prepare(git_repository *repo);
+
+  // Check if the listing of `record` (at `absolute_path`, with a trailing
+  // slash) can be reused. Otherwise, clears it for a new listing.
+  // `trusted` tells if the .gitignore files of the parents are unchanged,
+  // `trusted_below` is set for the subdirectories.
+  bool revalidate(directory &record, const std::string &absolute_path,
+                  bool trusted, int64_t scan_start, bool &trusted_below);
+
+  // Remove the directories that were not seen in the last scan
+  void prune();
+
+  static stamp stamp_of(const std::string &path);
+  static std::string fingerprint(git_repository *repo);
+
+  std::string path_;
+  std::string fingerprint_;
+  std::map<std::string, directory> directories_;
+  bool modified_;
+};
+
+} // namespace cppgit2
@@ -0,0 +1,60 @@
+#include <chrono>
+#include <cppgit2/repository.hpp>
+#include <iostream>
+using namespace cppgit2;
+
+// Compares a topological walk from HEAD with revwalk and with commit_graph
+//
+// Run `git commit-graph write --reachable` in the repository first to time
+// the graph loaded from disk; otherwise it is built by walking the history.
+template <typename Fn> double seconds(Fn fn) {
+  auto start = std::chrono::steady_clock::now();
+  fn();
+  auto end = std::chrono::steady_clock::now();
+  return std::chrono::duration<double>(end - start).count();
+}
+
+int main(int argc, char **argv) {
+  if (argc == 2) {
+    auto repo = repository::open(argv[1]);
+    auto head = repo.head().resolve().target();
+
+    // Like `git rev-list --topo-order HEAD`
+    size_t count = 0;
+    auto elapsed = seconds([&]() {
+      auto walker = repo.create_revwalk();
+      walker.set_sorting_mode(revwalk::sort::topological);
+      walker.push(head);
+      while (true) {
+        walker.next();
+        if (walker.done())
+          break;
+        ++count;
+      }
+    });
+    std::cout << "revwalk: " << count << " commits in " << elapsed << "s"
+              << std::endl;
+
+    // The load is timed separately: it is paid once per graph
+    auto start = std::chrono::steady_clock::now();
+    commit_graph graph(repo);
+    elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                            start)
+                  .count();
+    std::cout << "commit_graph load: " << graph.size_on_disk() << " of "
+              << graph.size() << " commits from disk in " << elapsed << "s"
+              << std::endl;
+
+    count = 0;
+    elapsed = seconds([&]() {
+      graph.for_each_commit({head}, [&](const oid &) {
+        ++count;
+        return true;
+      });
+    });
+    std::cout << "commit_graph walk: " << count << " commits in " << elapsed
+              << "s" << std::endl;
+  } else {
+    std::cout << "Usage: ./executable <repo_path>\n";
+  }
+}
@@ -0,0 +1,60 @@
+#include <algorithm>
+#include <chrono>
+#include <cppgit2/repository.hpp>
+#include <iostream>
+#include <random>
+#include <vector>
+using namespace cppgit2;
+
+// Compares batched object lookups with one lookup_object call per id
+//
+// Collects every commit reachable from HEAD and its tree, shuffles the ids
+// and looks them all up. Each measurement opens the repository again so
+// that no run benefits from the object cache of another.
+template <typename Fn> double seconds(Fn fn) {
+  auto start = std::chrono::steady_clock::now();
+  fn();
+  auto end = std::chrono::steady_clock::now();
+  return std::chrono::duration<double>(end - start).count();
+}
+
+int main(int argc, char **argv) {
+  if (argc == 2) {
+    std::vector<oid> ids;
+    {
+      auto repo = repository::open(argv[1]);
+      repo.for_each_commit([&](const commit &c) {
+        ids.push_back(c.id());
+        ids.push_back(c.tree_id());
+      });
+    }
+    std::shuffle(ids.begin(), ids.end(), std::mt19937(42));
+
+    auto report = [&](const char *name, double elapsed) {
+      std::cout << name << ": " << ids.size() << " objects in " << elapsed
+                << "s (" << static_cast<size_t>(ids.size() / elapsed)
+                << " objects/s)" << std::endl;
+    };
+
+    {
+      auto repo = repository::open(argv[1]);
+      report("lookup_object loop", seconds([&]() {
+               for (const auto &id : ids)
+                 repo.lookup_object(id, object::object_type::any);
+             }));
+    }
+    {
+      auto repo = repository::open(argv[1]);
+      report("lookup_objects", seconds([&]() { repo.lookup_objects(ids); }));
+    }
+    {
+      auto repo = repository::open(argv[1]);
+      object_loader loader(repo);
+      report("object_loader::for_each", seconds([&]() {
+               loader.for_each(ids, [](const object &) { return true; });
+             }));
+    }
+  } else {
+    std::cout << "Usage: ./executable <repo_path>\n";
+  }
+}
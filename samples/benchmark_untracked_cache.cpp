@@ -0,0 +1,64 @@
+#include <algorithm>
+#include <chrono>
+#include <cppgit2/parallel_status.hpp>
+#include <cppgit2/repository.hpp>
+#include <functional>
+#include <iostream>
+using namespace cppgit2;
+
+// Compares status scans with and without the untracked cache
+//
+// Run it on a working tree with many untracked (or ignored) files. The
+// cache is rebuilt from scratch first, then every scan is repeated and the
+// fastest run is kept. Warm scans load the cache file again each time, as
+// a new process would.
+template <typename Fn> double seconds(Fn fn) {
+  auto start = std::chrono::steady_clock::now();
+  fn();
+  auto end = std::chrono::steady_clock::now();
+  return std::chrono::duration<double>(end - start).count();
+}
+
+int main(int argc, char **argv) {
+  if (argc == 2 || argc == 3) {
+    size_t runs = (argc == 3) ? std::stoul(argv[2]) : 5;
+    auto repo = repository::open(argv[1]);
+    parallel_status scanner(repo);
+    size_t count = 0;
+    auto visitor = [&](const std::string &, status::status_type) { ++count; };
+
+    auto report = [&](const char *name, double elapsed) {
+      std::cout << name << ": " << count << " statuses in "
+                << elapsed * 1000 << "ms" << std::endl;
+    };
+    auto best = [&](std::function<void()> scan) {
+      double result = 0;
+      for (size_t i = 0; i < runs; ++i) {
+        count = 0;
+        const double elapsed = seconds(scan);
+        result = i ? std::min(result, elapsed) : elapsed;
+      }
+      return result;
+    };
+
+    report("for_each_status", best([&]() { repo.for_each_status(visitor); }));
+    report("parallel_status", best([&]() { scanner.for_each(visitor); }));
+
+    {
+      untracked_cache cache(repo);
+      cache.clear();
+      count = 0;
+      report("parallel_status, cold cache", seconds([&]() {
+               scanner.for_each(visitor, cache);
+               cache.save();
+             }));
+    }
+    report("parallel_status, warm cache", best([&]() {
+             untracked_cache cache(repo);
+             scanner.for_each(visitor, cache);
+             cache.save();
+           }));
+  } else {
+    std::cout << "Usage: ./executable <repo_path> [runs]\n";
+  }
+}
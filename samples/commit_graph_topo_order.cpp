@@ -0,0 +1,22 @@
+#include <cppgit2/repository.hpp>
+#include <iostream>
+using namespace cppgit2;
+
+int main(int argc, char **argv) {
+  if (argc == 2) {
+    auto repo = repository::open(argv[1]);
+
+    // Uses .git/objects/info/commit-graph if present
+    // (see `git commit-graph write --reachable`)
+    commit_graph graph(repo);
+    auto head = repo.head().resolve().target();
+
+    // Like `git log --topo-order --format=%h`
+    graph.for_each_commit({head}, [](const oid &id) {
+      std::cout << id.to_hex_string(7) << std::endl;
+      return true;
+    });
+  } else {
+    std::cout << "Usage: ./executable <repo_path>\n";
+  }
+}
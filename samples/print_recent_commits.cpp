@@ -0,0 +1,23 @@
+#include <cppgit2/repository.hpp>
+#include <iostream>
+using namespace cppgit2;
+
+int main(int argc, char **argv) {
+  if (argc == 3) {
+    auto repo = repository::open(argv[1]);
+    size_t remaining = std::stoul(argv[2]);
+
+    // Like `git log --format='%h %ct' | head -n <count>`
+    // The walk stops after `count` commits
+    repo.for_each_commit_view([&remaining](const commit_view &c) {
+      if (remaining == 0)
+        return false;
+      --remaining;
+      std::cout << c.id().to_hex_string(8) << " " << c.time() << std::endl;
+      return true;
+    });
+
+  } else {
+    std::cout << "Usage: ./executable <repo_path> <count>\n";
+  }
+}
@@ -0,0 +1,389 @@
+#include <algorithm>
+#include <cppgit2/async_executor.hpp>
+#include <cppgit2/repository.hpp>
+
+namespace cppgit2 {
+
+namespace {
+
+// Strings of a git_strarray, copied so the array can be rebuilt later
+std::vector<std::string> copy_strarray(const git_strarray &array) {
+  std::vector<std::string> result;
+  for (size_t i = 0; i < array.count; ++i)
+    result.push_back(array.strings[i]);
+  return result;
+}
+
+std::vector<char *> c_strings(const std::vector<std::string> &strings) {
+  std::vector<char *> result;
+  for (const auto &string : strings)
+    result.push_back(const_cast<char *>(string.c_str()));
+  return result;
+}
+
+// Optional string of a C struct, copied
+struct owned_c_string {
+  owned_c_string(const char *value)
+      : is_set(value != nullptr), value(value ? value : "") {}
+
+  const char *c_str() const { return is_set ? value.c_str() : nullptr; }
+
+  bool is_set;
+  std::string value;
+};
+
+} // namespace
+
+struct async_executor::handle_returns {
+  std::mutex mutex;
+  async_executor *executor; // null once destroyed
+};
+
+async_executor::async_executor(size_t thread_count, size_t repository_limit)
+    : default_limit_(std::max<size_t>(repository_limit, 1)), queued_(0),
+      idle_count_(0), uses_(0), stop_(false),
+      returns_(std::make_shared<handle_returns>()) {
+  returns_->executor = this;
+  if (thread_count == 0)
+    thread_count = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+  for (size_t i = 0; i < thread_count; ++i)
+    threads_.emplace_back([this] { work(); });
+}
+
+async_executor::~async_executor() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  wake_.notify_all();
+  for (auto &thread : threads_)
+    thread.join();
+
+  // Results destroyed from now on close their handles
+  std::lock_guard<std::mutex> lock(returns_->mutex);
+  returns_->executor = nullptr;
+}
+
+size_t async_executor::thread_count() const { return threads_.size(); }
+
+size_t async_executor::repository_limit(const repository &repo) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto found = repositories_.find(repo.path());
+  if (found == repositories_.end() || found->second.limit == 0)
+    return default_limit_;
+  return found->second.limit;
+}
+
+void async_executor::set_repository_limit(const repository &repo,
+                                          size_t limit) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto state = repositories_.emplace(repo.path(), repository_state()).first;
+    state->second.limit = limit;
+    prune(state);
+  }
+  wake_.notify_all();
+}
+
+size_t async_executor::repository_limit() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return default_limit_;
+}
+
+void async_executor::set_repository_limit(size_t limit) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    default_limit_ = std::max<size_t>(limit, 1);
+  }
+  wake_.notify_all();
+}
+
+void async_executor::submit(const std::string &path, task operation,
+                            bool open_handle) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    repositories_[path].queue.emplace_back(std::move(operation), open_handle);
+    ++queued_;
+  }
+  wake_.notify_one();
+}
+
+void async_executor::work() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  for (;;) {
+    // Next repository, after the last one served, with an operation queued
+    // and below its limit
+    auto found = repositories_.end();
+    auto start = repositories_.upper_bound(last_served_);
+    for (size_t i = 0; i < repositories_.size(); ++i, ++start) {
+      if (start == repositories_.end())
+        start = repositories_.begin();
+      const auto &state = start->second;
+      const size_t limit = state.limit ? state.limit : default_limit_;
+      if (!state.queue.empty() && state.running < limit) {
+        found = start;
+        break;
+      }
+    }
+    if (found == repositories_.end()) {
+      // Operations still queued keep the workers until they are done
+      if (stop_ && queued_ == 0)
+        return;
+      wake_.wait(lock);
+      continue;
+    }
+
+    const std::string &path = found->first;
+    repository_state &state = found->second;
+    last_served_ = path;
+    auto operation = std::move(state.queue.front());
+    state.queue.pop_front();
+    --queued_;
+    ++state.running;
+    std::unique_ptr<repository> handle;
+    if (operation.second && !state.idle.empty()) {
+      handle = std::move(state.idle.back());
+      state.idle.pop_back();
+      --idle_count_;
+    }
+    lock.unlock();
+
+    // A handle that fails to open is passed as null; the operation reports
+    // the error, which libgit2 keeps for this thread
+    if (operation.second && !handle) {
+      git_repository *handle_c;
+      if (git_repository_open(&handle_c, path.c_str()) == 0)
+        handle.reset(new repository(handle_c));
+    }
+    operation.first(handle);
+
+    lock.lock();
+    --state.running;
+    std::unique_ptr<repository> closed;
+    if (handle)
+      closed = make_idle(path, std::move(handle));
+    prune(found);
+    wake_.notify_all();
+    if (closed) {
+      lock.unlock();
+      closed.reset();
+      lock.lock();
+    }
+  }
+}
+
+template <typename T>
+std::shared_ptr<T>
+async_executor::keep_handle(T *result, const std::string &path,
+                            std::unique_ptr<repository> &handle) {
+  auto returns = returns_;
+  repository *kept = handle.release();
+  return std::shared_ptr<T>(result, [returns, path, kept](T *value) {
+    delete value;
+    std::unique_ptr<repository> handle(kept), closed;
+    std::lock_guard<std::mutex> returns_lock(returns->mutex);
+    if (returns->executor) {
+      std::lock_guard<std::mutex> lock(returns->executor->mutex_);
+      closed = returns->executor->make_idle(path, std::move(handle));
+    }
+  });
+}
+
+std::unique_ptr<repository>
+async_executor::make_idle(const std::string &path,
+                          std::unique_ptr<repository> handle) {
+  auto &state = repositories_[path];
+  state.idle.push_back(std::move(handle));
+  state.last_used = ++uses_;
+  std::unique_ptr<repository> closed;
+  if (++idle_count_ <= threads_.size())
+    return closed;
+
+  auto oldest = repositories_.end();
+  for (auto it = repositories_.begin(); it != repositories_.end(); ++it) {
+    if (!it->second.idle.empty() &&
+        (oldest == repositories_.end() ||
+         it->second.last_used < oldest->second.last_used))
+      oldest = it;
+  }
+  closed = std::move(oldest->second.idle.back());
+  oldest->second.idle.pop_back();
+  --idle_count_;
+  prune(oldest);
+  return closed;
+}
+
+void async_executor::prune(state_iterator state) {
+  const repository_state &value = state->second;
+  if (value.limit == 0 && value.running == 0 && value.queue.empty() &&
+      value.idle.empty())
+    repositories_.erase(state);
+}
+
+std::future<std::shared_ptr<blame>>
+async_executor::blame_file(const repository &repo, const std::string &path,
+                           blame::options options) {
+  auto promise = std::make_shared<std::promise<std::shared_ptr<blame>>>();
+  const std::string repo_path = repo.path();
+  const git_blame_options options_c = *options.c_ptr();
+  submit(
+      repo_path,
+      [=](std::unique_ptr<repository> &handle) {
+        try {
+          if (!handle)
+            throw git_exception();
+          git_blame_options blame_options = options_c;
+          git_blame *blame_c;
+          if (git_blame_file(&blame_c, handle->c_ptr_, path.c_str(),
+                             &blame_options))
+            throw git_exception();
+          std::unique_ptr<blame> result(new blame(blame_c, ownership::user));
+          promise->set_value(keep_handle(result.release(), repo_path, handle));
+        } catch (...) {
+          promise->set_exception(std::current_exception());
+        }
+      },
+      true);
+  return promise->get_future();
+}
+
+std::future<std::shared_ptr<diff>> async_executor::create_diff_tree_to_tree(
+    const repository &repo, const tree &old_tree, const tree &new_tree,
+    const diff::options &options) {
+  auto promise = std::make_shared<std::promise<std::shared_ptr<diff>>>();
+  const std::string repo_path = repo.path();
+
+  // Trees are looked up again in the worker's handle
+  const bool has_old_tree = old_tree.c_ptr() != nullptr;
+  const bool has_new_tree = new_tree.c_ptr() != nullptr;
+  git_oid old_id, new_id;
+  if (has_old_tree)
+    git_oid_cpy(&old_id, git_tree_id(old_tree.c_ptr()));
+  if (has_new_tree)
+    git_oid_cpy(&new_id, git_tree_id(new_tree.c_ptr()));
+
+  // Null options stay null (libgit2 defaults); strings are copied
+  const bool has_options = options.c_ptr() != nullptr;
+  git_diff_options options_c;
+  git_diff_init_options(&options_c, GIT_DIFF_OPTIONS_VERSION);
+  std::vector<std::string> pathspec;
+  if (has_options) {
+    options_c = *options.c_ptr();
+    pathspec = copy_strarray(options_c.pathspec);
+  }
+  const owned_c_string old_prefix(has_options ? options_c.old_prefix
+                                              : nullptr);
+  const owned_c_string new_prefix(has_options ? options_c.new_prefix
+                                              : nullptr);
+
+  submit(
+      repo_path,
+      [=](std::unique_ptr<repository> &handle) {
+        try {
+          if (!handle)
+            throw git_exception();
+          git_tree *old_c = nullptr, *new_c = nullptr;
+          if (has_old_tree &&
+              git_tree_lookup(&old_c, handle->c_ptr_, &old_id))
+            throw git_exception();
+          std::unique_ptr<git_tree, void (*)(git_tree *)> old_owner(
+              old_c, git_tree_free);
+          if (has_new_tree &&
+              git_tree_lookup(&new_c, handle->c_ptr_, &new_id))
+            throw git_exception();
+          std::unique_ptr<git_tree, void (*)(git_tree *)> new_owner(
+              new_c, git_tree_free);
+
+          git_diff_options diff_options = options_c;
+          auto pathspec_c = c_strings(pathspec);
+          if (has_options) {
+            diff_options.pathspec = {pathspec_c.data(), pathspec_c.size()};
+            diff_options.old_prefix = old_prefix.c_str();
+            diff_options.new_prefix = new_prefix.c_str();
+          }
+
+          git_diff *diff_c;
+          if (git_diff_tree_to_tree(&diff_c, handle->c_ptr_, old_c, new_c,
+                                    has_options ? &diff_options : nullptr))
+            throw git_exception();
+          std::unique_ptr<diff> result(new diff(diff_c, ownership::user));
+          promise->set_value(keep_handle(result.release(), repo_path, handle));
+        } catch (...) {
+          promise->set_exception(std::current_exception());
+        }
+      },
+      true);
+  return promise->get_future();
+}
+
+std::future<void> async_executor::for_each_status(
+    const repository &repo,
+    std::function<void(const std::string &, status::status_type)> visitor,
+    const cancellation_token &token) {
+  auto promise = std::make_shared<std::promise<void>>();
+  submit(
+      repo.path(),
+      [=](std::unique_ptr<repository> &handle) {
+        try {
+          if (!handle)
+            throw git_exception();
+          handle->for_each_status(visitor, token);
+          promise->set_value();
+        } catch (...) {
+          promise->set_exception(std::current_exception());
+        }
+      },
+      true);
+  return promise->get_future();
+}
+
+std::future<std::shared_ptr<repository>>
+async_executor::clone(const std::string &url, const std::string &local_path,
+                      const clone::options &options) {
+  auto promise = std::make_shared<std::promise<std::shared_ptr<repository>>>();
+  const git_clone_options options_c = *options.c_ptr();
+  const owned_c_string checkout_branch(options_c.checkout_branch);
+  const auto &checkout_c = options_c.checkout_opts;
+  const auto checkout_paths = copy_strarray(checkout_c.paths);
+  const owned_c_string target_directory(checkout_c.target_directory);
+  const owned_c_string ancestor_label(checkout_c.ancestor_label);
+  const owned_c_string our_label(checkout_c.our_label);
+  const owned_c_string their_label(checkout_c.their_label);
+  const owned_c_string proxy_url(options_c.fetch_opts.proxy_opts.url);
+  const auto custom_headers =
+      copy_strarray(options_c.fetch_opts.custom_headers);
+  submit(
+      local_path,
+      [=](std::unique_ptr<repository> &) {
+        try {
+          git_clone_options clone_options = options_c;
+          clone_options.checkout_branch = checkout_branch.c_str();
+
+          auto &checkout_options = clone_options.checkout_opts;
+          auto checkout_paths_c = c_strings(checkout_paths);
+          checkout_options.paths = {checkout_paths_c.data(),
+                                    checkout_paths_c.size()};
+          checkout_options.target_directory = target_directory.c_str();
+          checkout_options.ancestor_label = ancestor_label.c_str();
+          checkout_options.our_label = our_label.c_str();
+          checkout_options.their_label = their_label.c_str();
+
+          auto &fetch_options = clone_options.fetch_opts;
+          auto custom_headers_c = c_strings(custom_headers);
+          fetch_options.proxy_opts.url = proxy_url.c_str();
+          fetch_options.custom_headers = {custom_headers_c.data(),
+                                          custom_headers_c.size()};
+          git_repository *repo_c;
+          if (git_clone(&repo_c, url.c_str(), local_path.c_str(),
+                        &clone_options))
+            throw git_exception();
+          promise->set_value(std::make_shared<repository>(repo_c));
+        } catch (...) {
+          promise->set_exception(std::current_exception());
+        }
+      },
+      false);
+  return promise->get_future();
+}
+
+} // namespace cppgit2
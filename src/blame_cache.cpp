@@ -0,0 +1,248 @@
+#include <cppgit2/blame_cache.hpp>
+#include <cppgit2/repository.hpp>
+
+#include "worker_pool.hpp"
+
+namespace cppgit2 {
+
+namespace {
+
+// Id of the blob at `path` in the tree of `commit_id`
+// Returns false if there is no such blob
+bool blob_id(git_repository *repo, const oid &commit_id,
+             const std::string &path, git_oid *id) {
+  git_commit *commit_c;
+  if (git_commit_lookup(&commit_c, repo, commit_id.c_ptr()))
+    throw git_exception();
+  std::unique_ptr<git_commit, void (*)(git_commit *)> commit(commit_c,
+                                                             git_commit_free);
+  git_tree *tree_c;
+  if (git_commit_tree(&tree_c, commit_c))
+    throw git_exception();
+  std::unique_ptr<git_tree, void (*)(git_tree *)> tree(tree_c, git_tree_free);
+
+  git_tree_entry *entry_c;
+  const int ret = git_tree_entry_bypath(&entry_c, tree_c, path.c_str());
+  if (ret == GIT_ENOTFOUND) {
+    git_exception::clear();
+    return false;
+  }
+  if (ret)
+    throw git_exception();
+  const bool is_blob = git_tree_entry_type(entry_c) == GIT_OBJECT_BLOB;
+  if (is_blob)
+    git_oid_cpy(id, git_tree_entry_id(entry_c));
+  git_tree_entry_free(entry_c);
+  return is_blob;
+}
+
+// Changed line ranges of a blob diff
+struct blob_changes {
+  bool binary = false;
+  std::vector<git_diff_hunk> hunks;
+};
+
+} // namespace
+
+blame_cache::blame_cache(const repository &repo, blame::options options,
+                         size_t capacity)
+    : repo_(std::move(detail::open_worker_handles(repo.path(), 1).front())),
+      options_(*options.c_ptr()), capacity_(capacity), max_distance_(100),
+      hits_(0), incremental_(0), full_(0) {
+  options_.min_line = 0;
+  options_.max_line = 0;
+}
+
+blame_cache::~blame_cache() {}
+
+size_t blame_cache::max_distance() const { return max_distance_; }
+
+void blame_cache::set_max_distance(size_t distance) {
+  max_distance_ = distance;
+}
+
+size_t blame_cache::capacity() const { return capacity_; }
+
+void blame_cache::set_capacity(size_t capacity) {
+  capacity_ = capacity;
+  while (entries_.size() > capacity_) {
+    index_.erase(entries_.back().first);
+    entries_.pop_back();
+  }
+}
+
+size_t blame_cache::size() const { return entries_.size(); }
+
+void blame_cache::clear() {
+  entries_.clear();
+  index_.clear();
+}
+
+size_t blame_cache::hits() const { return hits_; }
+
+size_t blame_cache::incremental() const { return incremental_; }
+
+size_t blame_cache::full() const { return full_; }
+
+blame_cache::result blame_cache::find(const std::string &path,
+                                      const oid &commit_id) {
+  auto found = index_.find(key(path, commit_id));
+  if (found == index_.end())
+    return nullptr;
+  entries_.splice(entries_.begin(), entries_, found->second);
+  return found->second->second;
+}
+
+void blame_cache::insert(const std::string &path, const oid &commit_id,
+                         result origins) {
+  if (capacity_ == 0)
+    return;
+  const key entry_key(path, commit_id);
+  auto found = index_.find(entry_key);
+  if (found != index_.end()) {
+    entries_.erase(found->second);
+    index_.erase(found);
+  } else if (entries_.size() >= capacity_) {
+    index_.erase(entries_.back().first);
+    entries_.pop_back();
+  }
+  entries_.emplace_front(entry_key, std::move(origins));
+  index_[entry_key] = entries_.begin();
+}
+
+blame_cache::result blame_cache::blame_file(const std::string &path,
+                                            const oid &commit_id) {
+  auto origins = find(path, commit_id);
+  if (origins) {
+    ++hits_;
+    return origins;
+  }
+
+  // Walk back the first-parent chain, to the first cached ancestor
+  const bool first_parent =
+      (options_.flags & GIT_BLAME_FIRST_PARENT) == GIT_BLAME_FIRST_PARENT;
+  const oid oldest(&options_.oldest_commit);
+  std::vector<oid> chain{commit_id};
+  while (chain.size() <= max_distance_) {
+    if (!git_oid_iszero(oldest.c_ptr()) && chain.back() == oldest)
+      break;
+    git_commit *commit_c;
+    if (git_commit_lookup(&commit_c, repo_->c_ptr_, chain.back().c_ptr()))
+      throw git_exception();
+    const auto parents = git_commit_parentcount(commit_c);
+    if (parents == 1 || (parents > 1 && first_parent))
+      chain.push_back(oid(git_commit_parent_id(commit_c, 0)));
+    git_commit_free(commit_c);
+    if (parents == 0 || (parents > 1 && !first_parent))
+      break;
+
+    origins = find(path, chain.back());
+    if (origins)
+      break;
+  }
+
+  if (origins) {
+    for (size_t i = chain.size() - 1; origins && i > 0; --i)
+      origins = carry_forward(path, chain[i], chain[i - 1], origins);
+    if (origins)
+      ++incremental_;
+  }
+  if (!origins) {
+    origins = blame_from_scratch(path, commit_id);
+    ++full_;
+  }
+  insert(path, commit_id, origins);
+  return origins;
+}
+
+blame_cache::result blame_cache::carry_forward(const std::string &path,
+                                               const oid &parent,
+                                               const oid &child,
+                                               const result &origins) const {
+  git_oid old_id, new_id;
+  if (!blob_id(repo_->c_ptr_, parent, path, &old_id) ||
+      !blob_id(repo_->c_ptr_, child, path, &new_id))
+    return nullptr;
+  if (git_oid_equal(&old_id, &new_id))
+    return origins;
+
+  git_blob *old_blob_c, *new_blob_c;
+  if (git_blob_lookup(&old_blob_c, repo_->c_ptr_, &old_id))
+    throw git_exception();
+  std::unique_ptr<git_blob, void (*)(git_blob *)> old_blob(old_blob_c,
+                                                           git_blob_free);
+  if (git_blob_lookup(&new_blob_c, repo_->c_ptr_, &new_id))
+    throw git_exception();
+  std::unique_ptr<git_blob, void (*)(git_blob *)> new_blob(new_blob_c,
+                                                           git_blob_free);
+
+  git_diff_options diff_options;
+  git_diff_init_options(&diff_options, GIT_DIFF_OPTIONS_VERSION);
+  diff_options.context_lines = 0;
+  blob_changes changes;
+  if (git_diff_blobs(
+          old_blob_c, path.c_str(), new_blob_c, path.c_str(), &diff_options,
+          [](const git_diff_delta *delta_c, float, void *payload) -> int {
+            if (delta_c->flags & GIT_DIFF_FLAG_BINARY)
+              static_cast<blob_changes *>(payload)->binary = true;
+            return 0;
+          },
+          nullptr,
+          [](const git_diff_delta *, const git_diff_hunk *hunk_c,
+             void *payload) -> int {
+            static_cast<blob_changes *>(payload)->hunks.push_back(*hunk_c);
+            return 0;
+          },
+          nullptr, &changes))
+    throw git_exception();
+  if (changes.binary)
+    return nullptr;
+
+  // Lines between hunks keep their origin; lines of a hunk are the child's
+  // A hunk without lines on one side starts after the given line number.
+  std::shared_ptr<std::vector<line_origin>> carried(
+      new std::vector<line_origin>);
+  size_t old_line = 0; // lines of the parent copied or replaced so far
+  for (const auto &hunk : changes.hunks) {
+    const size_t old_begin =
+        hunk.old_lines ? hunk.old_start - 1 : hunk.old_start;
+    const size_t new_begin =
+        hunk.new_lines ? hunk.new_start - 1 : hunk.new_start;
+    if (old_begin < old_line || old_begin + hunk.old_lines > origins->size() ||
+        carried->size() + (old_begin - old_line) != new_begin)
+      return nullptr;
+    carried->insert(carried->end(), origins->begin() + old_line,
+                    origins->begin() + old_begin);
+    for (int i = 0; i < hunk.new_lines; ++i)
+      carried->push_back({child, path, new_begin + i + 1, false});
+    old_line = old_begin + hunk.old_lines;
+  }
+  carried->insert(carried->end(), origins->begin() + old_line, origins->end());
+  return carried;
+}
+
+blame_cache::result blame_cache::blame_from_scratch(const std::string &path,
+                                                    const oid &commit_id) {
+  git_blame_options options = options_;
+  git_oid_cpy(&options.newest_commit, commit_id.c_ptr());
+  git_blame *blame_c;
+  if (git_blame_file(&blame_c, repo_->c_ptr_, path.c_str(), &options))
+    throw git_exception();
+  std::unique_ptr<git_blame, void (*)(git_blame *)> blame(blame_c,
+                                                          git_blame_free);
+
+  std::shared_ptr<std::vector<line_origin>> origins(
+      new std::vector<line_origin>);
+  const auto hunks = git_blame_get_hunk_count(blame_c);
+  for (uint32_t i = 0; i < hunks; ++i) {
+    const auto hunk = git_blame_get_hunk_byindex(blame_c, i);
+    const std::string orig_path = hunk->orig_path ? hunk->orig_path : path;
+    for (size_t j = 0; j < hunk->lines_in_hunk; ++j)
+      origins->push_back({oid(&hunk->orig_commit_id), orig_path,
+                          hunk->orig_start_line_number + j,
+                          hunk->boundary != 0});
+  }
+  return origins;
+}
+
+} // namespace cppgit2
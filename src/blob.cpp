@@ -1,4 +1,5 @@
 #include <cppgit2/repository.hpp>
+#include <cstring>
 
 namespace cppgit2 {
 
@@ -33,4 +34,28 @@ blob_size blob::raw_size() const { return git_blob_rawsize(c_ptr_); }
 
 const git_blob *blob::c_ptr() const { return c_ptr_; }
 
+blob_view::blob_view(const git_blob *c_ptr)
+    : c_ptr_(c_ptr),
+      data_(static_cast<const char *>(git_blob_rawcontent(c_ptr))),
+      size_(static_cast<size_t>(git_blob_rawsize(c_ptr))) {}
+
+blob_view::blob_view(const blob &b) : blob_view(b.c_ptr()) {}
+
+oid blob_view::id() const { return oid(git_blob_id(c_ptr_)); }
+
+bool blob_view::is_binary() const { return git_blob_is_binary(c_ptr_); }
+
+void blob_view::for_each_line(
+    std::function<bool(const char *line, size_t length)> visitor) const {
+  const char *current = data_, *last = data_ + size_;
+  while (current < last) {
+    auto newline = static_cast<const char *>(
+        std::memchr(current, '\n', static_cast<size_t>(last - current)));
+    auto line_end = newline ? newline : last;
+    if (!visitor(current, static_cast<size_t>(line_end - current)))
+      return;
+    current = line_end + 1;
+  }
+}
+
 } // namespace cppgit2
@@ -0,0 +1,265 @@
+#include <algorithm>
+#include <cppgit2/blob_reader.hpp>
+#include <cppgit2/pack_index.hpp>
+#include <cppgit2/repository.hpp>
+#include <cstring>
+#include <fstream>
+#include <zlib.h>
+
+namespace cppgit2 {
+
+// zlib stream over a whole (not deltified) object in a pack file
+// See Documentation/technical/pack-format.txt in git
+struct blob_reader::pack_entry {
+  pack_entry() : inflating(false) { std::memset(&zlib, 0, sizeof(zlib)); }
+
+  ~pack_entry() {
+    if (inflating)
+      inflateEnd(&zlib);
+  }
+
+  std::ifstream file;
+  std::vector<unsigned char> input;
+  z_stream zlib;
+  bool inflating;
+};
+
+namespace {
+
+const int pack_object_blob = 3;
+
+} // namespace
+
+blob_reader::blob_reader(const repository &repo, const oid &id,
+                         size_t buffer_size)
+    : odb_(nullptr), stream_(nullptr), object_(nullptr), size_(0),
+      position_(0) {
+  if (buffer_size == 0)
+    throw git_exception("blob_reader buffer size must not be 0");
+  if (git_repository_odb(&odb_, const_cast<git_repository *>(repo.c_ptr())))
+    throw git_exception();
+
+  size_t length;
+  git_object_t type;
+  const bool streamed =
+      git_odb_open_rstream(&stream_, &length, &type, odb_, id.c_ptr()) == 0;
+  if (!streamed) {
+    git_exception::clear();
+    stream_ = nullptr;
+  }
+
+  bool packed = false;
+  try {
+    packed = !streamed && open_packed(repo, id, buffer_size);
+  } catch (...) {
+    close();
+    throw;
+  }
+
+  if (streamed || packed) {
+    if (streamed)
+      size_ = length;
+    else
+      type = GIT_OBJECT_BLOB;
+    buffer_.resize(std::min(buffer_size, std::max<size_t>(size_, 1)));
+  } else {
+    // Neither streamed by a backend nor stored whole in a pack
+    if (git_odb_read(&object_, odb_, id.c_ptr())) {
+      close();
+      throw git_exception();
+    }
+    type = git_odb_object_type(object_);
+    size_ = git_odb_object_size(object_);
+    buffer_.resize(buffer_size); // Only used for the chunk size
+  }
+
+  if (type != GIT_OBJECT_BLOB) {
+    close();
+    throw git_exception("object is not a blob");
+  }
+}
+
+bool blob_reader::open_packed(const repository &repo, const oid &id,
+                              size_t buffer_size) {
+  for (const auto &index_path : pack_index::paths(repo)) {
+    const pack_index index(index_path);
+    size_t n;
+    if (!index.find(id, n))
+      continue;
+
+    std::unique_ptr<pack_entry> entry(new pack_entry());
+    const auto pack_path =
+        index_path.substr(0, index_path.size() - 4) + ".pack";
+    entry->file.open(pack_path, std::ios::binary);
+    entry->file.seekg(static_cast<std::streamoff>(index.offset(n)));
+
+    // Object header: type, and size as a little-endian base-128 number
+    int byte = entry->file.get();
+    const int type = (byte >> 4) & 7;
+    uint64_t size = byte & 15;
+    for (unsigned shift = 4; byte >= 0 && (byte & 0x80) && shift < 64;
+         shift += 7) {
+      byte = entry->file.get();
+      size |= static_cast<uint64_t>(byte & 0x7f) << shift;
+    }
+
+    // Unreadable packs (e.g., removed by a repack) are left to libgit2,
+    // and so are deltas, which need their base
+    if (!entry->file || byte < 0 || type != pack_object_blob)
+      return false;
+
+    if (inflateInit(&entry->zlib) != Z_OK)
+      throw git_exception("failed to initialize zlib");
+    entry->inflating = true;
+    entry->input.resize(buffer_size);
+    size_ = static_cast<size_t>(size);
+    pack_ = std::move(entry);
+    return true;
+  }
+  return false;
+}
+
+size_t blob_reader::read_packed(char *buffer, size_t length) {
+  auto &zlib = pack_->zlib;
+  zlib.next_out = reinterpret_cast<Bytef *>(buffer);
+  zlib.avail_out = static_cast<uInt>(length);
+  while (zlib.avail_out > 0) {
+    if (zlib.avail_in == 0) {
+      pack_->file.read(reinterpret_cast<char *>(pack_->input.data()),
+                       static_cast<std::streamsize>(pack_->input.size()));
+      const auto read = pack_->file.gcount();
+      if (read <= 0)
+        throw git_exception("unexpected end of pack file");
+      zlib.next_in = pack_->input.data();
+      zlib.avail_in = static_cast<uInt>(read);
+    }
+    const auto ret = inflate(&zlib, Z_NO_FLUSH);
+    if (ret == Z_STREAM_END)
+      break;
+    if (ret != Z_OK)
+      throw git_exception("corrupt object in pack file");
+  }
+
+  const auto inflated = length - zlib.avail_out;
+  if (inflated == 0)
+    throw git_exception("unexpected end of object in pack file");
+  return inflated;
+}
+
+blob_reader::~blob_reader() { close(); }
+
+void blob_reader::close() {
+  if (stream_)
+    git_odb_stream_free(stream_);
+  pack_.reset();
+  if (object_)
+    git_odb_object_free(object_);
+  if (odb_)
+    git_odb_free(odb_);
+  stream_ = nullptr;
+  object_ = nullptr;
+  odb_ = nullptr;
+}
+
+size_t blob_reader::size() const { return size_; }
+
+size_t blob_reader::position() const { return position_; }
+
+bool blob_reader::eof() const { return position_ >= size_; }
+
+bool blob_reader::is_streaming() const { return stream_ || pack_; }
+
+bool blob_reader::next(const char *&data, size_t &length) {
+  if (eof())
+    return false;
+
+  if (object_) {
+    data = static_cast<const char *>(git_odb_object_data(object_)) + position_;
+    length = std::min(buffer_.size(), size_ - position_);
+  } else if (pack_) {
+    length = read_packed(buffer_.data(),
+                         std::min(buffer_.size(), size_ - position_));
+    data = buffer_.data();
+  } else {
+    const auto ret = git_odb_stream_read(
+        stream_, buffer_.data(), std::min(buffer_.size(), size_ - position_));
+    if (ret < 0)
+      throw git_exception();
+    if (ret == 0)
+      throw git_exception("unexpected end of object stream");
+    data = buffer_.data();
+    length = static_cast<size_t>(ret);
+  }
+  position_ += length;
+  return true;
+}
+
+size_t blob_reader::read(char *buffer, size_t length) {
+  if (eof() || length == 0)
+    return 0;
+
+  if (object_) {
+    length = std::min(length, size_ - position_);
+    std::memcpy(buffer,
+                static_cast<const char *>(git_odb_object_data(object_)) +
+                    position_,
+                length);
+    position_ += length;
+    return length;
+  }
+
+  // Stream straight into the caller's buffer
+  if (pack_) {
+    length = read_packed(buffer, std::min(length, size_ - position_));
+    position_ += length;
+    return length;
+  }
+  const auto ret =
+      git_odb_stream_read(stream_, buffer, std::min(length, size_ - position_));
+  if (ret < 0)
+    throw git_exception();
+  if (ret == 0)
+    throw git_exception("unexpected end of object stream");
+  position_ += static_cast<size_t>(ret);
+  return static_cast<size_t>(ret);
+}
+
+void blob_reader::for_each_chunk(
+    std::function<bool(const char *data, size_t length)> visitor) {
+  const char *data;
+  size_t length;
+  while (next(data, length)) {
+    if (!visitor(data, length))
+      return;
+  }
+}
+
+void blob_reader::copy_to(std::ostream &out) {
+  for_each_chunk([&out](const char *data, size_t length) -> bool {
+    out.write(data, static_cast<std::streamsize>(length));
+    return static_cast<bool>(out);
+  });
+}
+
+blob_istream::blob_istream(const repository &repo, const oid &id,
+                           size_t buffer_size)
+    : std::istream(nullptr), reader_(repo, id, buffer_size),
+      buffer_(reader_) {
+  rdbuf(&buffer_);
+}
+
+blob_istream::buffer::int_type blob_istream::buffer::underflow() {
+  if (gptr() < egptr())
+    return traits_type::to_int_type(*gptr());
+
+  const char *data;
+  size_t length;
+  if (!reader_.next(data, length))
+    return traits_type::eof();
+  // The get area is never written to
+  auto begin = const_cast<char *>(data);
+  setg(begin, begin, begin + length);
+  return traits_type::to_int_type(*gptr());
+}
+
+} // namespace cppgit2
@@ -139,4 +139,42 @@ repository commit::owner() const {
 
 const git_commit *commit::c_ptr() const { return c_ptr_; }
 
-} // namespace cppgit2
\ No newline at end of file
+commit_view::commit_view(git_repository *repo, const oid &id)
+    : repo_(repo), id_(id) {}
+
+commit_view::~commit_view() {}
+
+const oid &commit_view::id() const { return id_; }
+
+bool commit_view::is_loaded() const { return commit_ != nullptr; }
+
+oid commit_view::parent_id(unsigned int n) const {
+  return oid(git_commit_parent_id(load(), n));
+}
+
+unsigned int commit_view::parent_count() const {
+  return git_commit_parentcount(load());
+}
+
+epoch_time_seconds commit_view::time() const {
+  return git_commit_time(load());
+}
+
+oid commit_view::tree_id() const { return oid(git_commit_tree_id(load())); }
+
+const commit &commit_view::get() const {
+  load();
+  return *commit_;
+}
+
+const git_commit *commit_view::load() const {
+  if (!commit_) {
+    git_commit *result = nullptr;
+    if (git_commit_lookup(&result, repo_, id_.c_ptr()))
+      throw git_exception();
+    commit_.reset(new commit(result, ownership::user));
+  }
+  return commit_->c_ptr();
+}
+
+} // namespace cppgit2
@@ -0,0 +1,711 @@
+#include <algorithm>
+#include <cppgit2/commit_graph.hpp>
+#include <cppgit2/repository.hpp>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+namespace cppgit2 {
+
+namespace {
+
+// commit-graph file format constants
+// See Documentation/technical/commit-graph-format.txt in git
+const uint32_t chunk_oid_fanout = 0x4f494446; // "OIDF"
+const uint32_t chunk_oid_lookup = 0x4f49444c; // "OIDL"
+const uint32_t chunk_commit_data = 0x43444154; // "CDAT"
+const uint32_t chunk_extra_edges = 0x45444745; // "EDGE"
+const size_t commit_data_size = GIT_OID_RAWSZ + 16;
+const uint32_t parent_none = 0x70000000;
+const uint32_t parent_extra_edges = 0x80000000;
+const uint32_t parent_last_edge = 0x80000000;
+
+// Scratch flags used by the graph queries
+enum paint : uint8_t {
+  parent1 = (1u << 0),
+  parent2 = (1u << 1),
+  stale = (1u << 2),
+  result = (1u << 3),
+  seen = (1u << 4),
+};
+
+uint32_t read_be32(const unsigned char *p) {
+  return (static_cast<uint32_t>(p[0]) << 24) |
+         (static_cast<uint32_t>(p[1]) << 16) |
+         (static_cast<uint32_t>(p[2]) << 8) | static_cast<uint32_t>(p[3]);
+}
+
+uint64_t read_be64(const unsigned char *p) {
+  return (static_cast<uint64_t>(read_be32(p)) << 32) | read_be32(p + 4);
+}
+
+bool file_exists(const std::string &path) {
+  std::ifstream file(path, std::ios::binary);
+  return file.good();
+}
+
+// Flags set during a single query
+// Every flag that was set is cleared again when the query finishes
+class scratch_flags {
+public:
+  scratch_flags(std::vector<uint8_t> &flags, size_t size) : flags_(flags) {
+    if (flags_.size() < size)
+      flags_.resize(size, 0);
+  }
+
+  ~scratch_flags() {
+    for (auto position : touched_)
+      flags_[position] = 0;
+  }
+
+  uint8_t get(uint32_t position) const { return flags_[position]; }
+
+  void add(uint32_t position, uint8_t bits) {
+    if (!flags_[position])
+      touched_.push_back(position);
+    flags_[position] |= bits;
+  }
+
+private:
+  std::vector<uint8_t> &flags_;
+  std::vector<uint32_t> touched_;
+};
+
+struct queue_entry {
+  uint32_t generation;
+  epoch_time_seconds time;
+  uint32_t position;
+};
+
+// Max-heap ordering: highest generation first, then newest commit
+struct by_generation {
+  bool operator()(const queue_entry &lhs, const queue_entry &rhs) const {
+    if (lhs.generation != rhs.generation)
+      return lhs.generation < rhs.generation;
+    return lhs.time < rhs.time;
+  }
+};
+
+// Max-heap ordering: newest commit first, then highest generation
+struct by_time {
+  bool operator()(const queue_entry &lhs, const queue_entry &rhs) const {
+    if (lhs.time != rhs.time)
+      return lhs.time < rhs.time;
+    return lhs.generation < rhs.generation;
+  }
+};
+
+bool has_flag(revision::sort value, revision::sort flag) {
+  return (value & flag) == flag;
+}
+
+} // namespace
+
+commit_graph::commit_graph(git_repository *repo)
+    : repo_(repo), size_on_disk_(0), parent_offsets_(1, 0) {}
+
+commit_graph::commit_graph(const repository &repo)
+    : commit_graph(const_cast<git_repository *>(repo.c_ptr())) {
+  std::string objects_dir(git_repository_commondir(repo_));
+  if (!objects_dir.empty() && objects_dir.back() != '/')
+    objects_dir += '/';
+  objects_dir += "objects/";
+
+  if (!read_files(objects_dir))
+    *this = build(repo);
+}
+
+commit_graph commit_graph::build(const repository &repo) {
+  commit_graph result(const_cast<git_repository *>(repo.c_ptr()));
+
+  git_revwalk *iter;
+  if (git_revwalk_new(&iter, result.repo_))
+    throw git_exception();
+  revwalk walker(iter, ownership::user);
+
+  // Non-commit references are skipped by the glob;
+  // HEAD is missing in empty repositories
+  if (git_revwalk_push_glob(iter, "refs/*"))
+    throw git_exception();
+  git_revwalk_push_head(iter);
+  git_exception::clear();
+
+  // Parents before children, so every commit is appended right away
+  git_revwalk_sorting(iter, GIT_SORT_TOPOLOGICAL | GIT_SORT_REVERSE);
+  git_oid id_c;
+  int ret;
+  while ((ret = git_revwalk_next(&id_c, iter)) == 0)
+    result.position(oid(&id_c));
+  if (ret != GIT_ITEROVER)
+    throw git_exception();
+
+  return result;
+}
+
+size_t commit_graph::size() const { return ids_.size(); }
+
+size_t commit_graph::size_on_disk() const { return size_on_disk_; }
+
+bool commit_graph::contains(const oid &id) const {
+  return positions_.find(id) != positions_.end();
+}
+
+uint32_t commit_graph::generation(const oid &id) {
+  return generations_[position(id)];
+}
+
+std::vector<oid> commit_graph::parent_ids(const oid &id) {
+  auto commit = position(id);
+  std::vector<oid> result;
+  for (auto p = parents_begin(commit); p != parents_end(commit); ++p)
+    result.push_back(ids_[*p]);
+  return result;
+}
+
+epoch_time_seconds commit_graph::time(const oid &id) {
+  return times_[position(id)];
+}
+
+oid commit_graph::tree_id(const oid &id) { return trees_[position(id)]; }
+
+bool commit_graph::is_ancestor(const oid &ancestor, const oid &descendant) {
+  auto target = position(ancestor);
+  auto start = position(descendant);
+  if (target == start)
+    return true;
+
+  // Every ancestor of `start` that can reach `target` has a higher
+  // generation than `target`
+  const auto min_generation = generations_[target];
+  if (generations_[start] <= min_generation)
+    return false;
+
+  scratch_flags flags(flags_, size());
+  std::vector<uint32_t> stack{start};
+  flags.add(start, seen);
+  while (!stack.empty()) {
+    auto commit = stack.back();
+    stack.pop_back();
+    for (auto p = parents_begin(commit); p != parents_end(commit); ++p) {
+      if (*p == target)
+        return true;
+      if (flags.get(*p) & seen)
+        continue;
+      flags.add(*p, seen);
+      if (generations_[*p] > min_generation)
+        stack.push_back(*p);
+    }
+  }
+  return false;
+}
+
+oid commit_graph::find_merge_base(const oid &first_commit,
+                                  const oid &second_commit) {
+  auto bases = merge_base_positions(position(first_commit),
+                                    position(second_commit));
+  if (bases.empty())
+    throw git_exception("no merge base found");
+  return ids_[bases.front()];
+}
+
+std::vector<oid> commit_graph::find_merge_bases(const oid &first_commit,
+                                                const oid &second_commit) {
+  auto bases = merge_base_positions(position(first_commit),
+                                    position(second_commit));
+  std::vector<oid> result;
+  for (auto base : bases)
+    result.push_back(ids_[base]);
+  return result;
+}
+
+std::pair<size_t, size_t> commit_graph::ahead_behind(const oid &local,
+                                                     const oid &upstream) {
+  auto one = position(local);
+  auto two = position(upstream);
+  if (one == two)
+    return {0, 0};
+
+  scratch_flags flags(flags_, size());
+  std::vector<queue_entry> queue;
+  auto push = [&](uint32_t commit) {
+    queue.push_back({generations_[commit], times_[commit], commit});
+    std::push_heap(queue.begin(), queue.end(), by_generation());
+  };
+  auto has_nonstale = [&]() -> bool {
+    for (const auto &entry : queue)
+      if ((flags.get(entry.position) & (parent1 | parent2)) !=
+          (parent1 | parent2))
+        return true;
+    return false;
+  };
+
+  flags.add(one, parent1 | seen);
+  push(one);
+  flags.add(two, parent2 | seen);
+  push(two);
+
+  // All children of a commit have a higher generation, so a commit's flags
+  // are final once it is popped
+  size_t ahead = 0, behind = 0;
+  while (has_nonstale()) {
+    std::pop_heap(queue.begin(), queue.end(), by_generation());
+    auto commit = queue.back().position;
+    queue.pop_back();
+
+    const uint8_t side = flags.get(commit) & (parent1 | parent2);
+    if (side == parent1)
+      ++ahead;
+    else if (side == parent2)
+      ++behind;
+
+    for (auto p = parents_begin(commit); p != parents_end(commit); ++p) {
+      const auto current = flags.get(*p);
+      if ((current & side) == side)
+        continue;
+      flags.add(*p, side);
+      if (!(current & seen)) {
+        flags.add(*p, seen);
+        push(*p);
+      }
+    }
+  }
+  return {ahead, behind};
+}
+
+void commit_graph::for_each_commit(const std::vector<oid> &roots,
+                                   std::function<bool(const oid &)> visitor,
+                                   revision::sort sort_ordering) {
+  std::vector<uint32_t> starts;
+  for (const auto &root : roots)
+    starts.push_back(position(root));
+
+  const bool topological =
+      has_flag(sort_ordering, revision::sort::topological);
+  const bool by_commit_time =
+      has_flag(sort_ordering, revision::sort::commit_time);
+  const bool reverse = has_flag(sort_ordering, revision::sort::reverse);
+
+  scratch_flags flags(flags_, size());
+  std::vector<uint32_t> reversed;
+  auto emit = [&](uint32_t commit) -> bool {
+    if (reverse) {
+      reversed.push_back(commit);
+      return true;
+    }
+    return visitor(ids_[commit]);
+  };
+
+  if (!topological) {
+    // Newest commit first, incremental
+    std::vector<queue_entry> queue;
+    for (auto start : starts) {
+      if (flags.get(start) & seen)
+        continue;
+      flags.add(start, seen);
+      queue.push_back({generations_[start], times_[start], start});
+      std::push_heap(queue.begin(), queue.end(), by_time());
+    }
+    while (!queue.empty()) {
+      std::pop_heap(queue.begin(), queue.end(), by_time());
+      auto commit = queue.back().position;
+      queue.pop_back();
+      if (!emit(commit))
+        return;
+      for (auto p = parents_begin(commit); p != parents_end(commit); ++p) {
+        if (flags.get(*p) & seen)
+          continue;
+        flags.add(*p, seen);
+        queue.push_back({generations_[*p], times_[*p], *p});
+        std::push_heap(queue.begin(), queue.end(), by_time());
+      }
+    }
+  } else {
+    // Collect the reachable commits and count their children
+    std::vector<uint32_t> stack;
+    std::vector<uint32_t> children(size(), 0);
+    for (auto start : starts) {
+      if (flags.get(start) & seen)
+        continue;
+      flags.add(start, seen);
+      stack.push_back(start);
+    }
+    while (!stack.empty()) {
+      auto commit = stack.back();
+      stack.pop_back();
+      for (auto p = parents_begin(commit); p != parents_end(commit); ++p) {
+        ++children[*p];
+        if (flags.get(*p) & seen)
+          continue;
+        flags.add(*p, seen);
+        stack.push_back(*p);
+      }
+    }
+
+    // Emit commits once all of their children have been emitted
+    std::vector<queue_entry> ready;
+    auto make_ready = [&](uint32_t commit) {
+      ready.push_back({generations_[commit], times_[commit], commit});
+      if (by_commit_time)
+        std::push_heap(ready.begin(), ready.end(), by_time());
+    };
+    for (auto start = starts.rbegin(); start != starts.rend(); ++start) {
+      if (children[*start] == 0 && !(flags.get(*start) & result)) {
+        flags.add(*start, result);
+        make_ready(*start);
+      }
+    }
+    while (!ready.empty()) {
+      if (by_commit_time)
+        std::pop_heap(ready.begin(), ready.end(), by_time());
+      auto commit = ready.back().position;
+      ready.pop_back();
+      if (!emit(commit))
+        return;
+      for (auto p = parents_begin(commit); p != parents_end(commit); ++p)
+        if (--children[*p] == 0)
+          make_ready(*p);
+    }
+  }
+
+  for (auto commit = reversed.rbegin(); commit != reversed.rend(); ++commit)
+    if (!visitor(ids_[*commit]))
+      return;
+}
+
+bool commit_graph::read_files(const std::string &objects_dir) {
+  const auto single = objects_dir + "info/commit-graph";
+  const auto chain_dir = objects_dir + "info/commit-graphs/";
+  if (file_exists(single)) {
+    read_file(single, false);
+  } else {
+    std::ifstream chain(chain_dir + "commit-graph-chain");
+    if (!chain)
+      return false;
+    std::string hash;
+    while (std::getline(chain, hash))
+      if (!hash.empty())
+        read_file(chain_dir + "graph-" + hash + ".graph", true);
+    if (ids_.empty())
+      return false;
+  }
+  size_on_disk_ = ids_.size();
+
+  // Files written by old versions of git have no generation numbers
+  if (std::find(generations_.begin(), generations_.end(), 0u) !=
+      generations_.end())
+    compute_generations();
+  return true;
+}
+
+void commit_graph::read_file(const std::string &path, bool is_chain_layer) {
+  std::ifstream file(path, std::ios::binary);
+  if (!file)
+    throw git_exception("failed to open commit-graph file");
+  std::vector<unsigned char> data((std::istreambuf_iterator<char>(file)),
+                                  std::istreambuf_iterator<char>());
+
+  // Header: signature, version, hash version, chunk count, base graph count
+  const size_t header_size = 8, chunk_entry_size = 12;
+  if (data.size() < header_size || std::memcmp(data.data(), "CGPH", 4) ||
+      data[4] != 1 || data[5] != 1)
+    throw git_exception("unsupported commit-graph file");
+  const size_t chunk_count = data[6];
+  const size_t base_count = data[7];
+  if (!is_chain_layer && base_count != 0)
+    throw git_exception("invalid commit-graph file");
+  if (data.size() < header_size + (chunk_count + 1) * chunk_entry_size)
+    throw git_exception("invalid commit-graph file");
+
+  // Chunk table of contents
+  const unsigned char *fanout = nullptr, *lookup = nullptr,
+                      *commit_data = nullptr, *edges = nullptr;
+  size_t lookup_size = 0, commit_data_bytes = 0, edges_size = 0,
+         fanout_size = 0;
+  for (size_t i = 0; i < chunk_count; ++i) {
+    const auto entry = data.data() + header_size + i * chunk_entry_size;
+    const auto id = read_be32(entry);
+    const auto offset = read_be64(entry + 4);
+    const auto end = read_be64(entry + 4 + chunk_entry_size);
+    if (offset > end || end > data.size())
+      throw git_exception("invalid commit-graph file");
+    const auto chunk = data.data() + offset;
+    const size_t chunk_size = static_cast<size_t>(end - offset);
+    if (id == chunk_oid_fanout) {
+      fanout = chunk;
+      fanout_size = chunk_size;
+    } else if (id == chunk_oid_lookup) {
+      lookup = chunk;
+      lookup_size = chunk_size;
+    } else if (id == chunk_commit_data) {
+      commit_data = chunk;
+      commit_data_bytes = chunk_size;
+    } else if (id == chunk_extra_edges) {
+      edges = chunk;
+      edges_size = chunk_size;
+    }
+  }
+  if (!fanout || !lookup || !commit_data || fanout_size < 256 * 4)
+    throw git_exception("invalid commit-graph file");
+
+  const size_t count = read_be32(fanout + 255 * 4);
+  if (lookup_size < count * GIT_OID_RAWSZ ||
+      commit_data_bytes < count * commit_data_size)
+    throw git_exception("invalid commit-graph file");
+
+  // Parent positions are global across the layers of a chain
+  const size_t base = ids_.size();
+  const size_t total = base + count;
+  auto check_position = [total](uint32_t position) -> uint32_t {
+    if (position >= total)
+      throw git_exception("invalid commit-graph file");
+    return position;
+  };
+
+  ids_.reserve(total);
+  trees_.reserve(total);
+  generations_.reserve(total);
+  times_.reserve(total);
+  parent_offsets_.reserve(total + 1);
+  positions_.reserve(total);
+
+  for (size_t i = 0; i < count; ++i) {
+    const auto entry = commit_data + i * commit_data_size;
+    ids_.push_back(oid(lookup + i * GIT_OID_RAWSZ));
+    trees_.push_back(oid(entry));
+
+    const auto first = read_be32(entry + GIT_OID_RAWSZ);
+    const auto second = read_be32(entry + GIT_OID_RAWSZ + 4);
+    if (first != parent_none)
+      parents_.push_back(check_position(first));
+    if (second != parent_none) {
+      if (second & parent_extra_edges) {
+        // Octopus merge: second and later parents are in the EDGE chunk
+        size_t edge = second & ~parent_extra_edges;
+        while (true) {
+          if (!edges || (edge + 1) * 4 > edges_size)
+            throw git_exception("invalid commit-graph file");
+          const auto value = read_be32(edges + edge * 4);
+          parents_.push_back(check_position(value & ~parent_last_edge));
+          if (value & parent_last_edge)
+            break;
+          ++edge;
+        }
+      } else {
+        parents_.push_back(check_position(second));
+      }
+    }
+    parent_offsets_.push_back(static_cast<uint32_t>(parents_.size()));
+
+    // Top 30 bits: generation number; bottom 34 bits: commit time
+    const auto generation_and_time = read_be32(entry + GIT_OID_RAWSZ + 8);
+    const auto time_low = read_be32(entry + GIT_OID_RAWSZ + 12);
+    generations_.push_back(generation_and_time >> 2);
+    times_.push_back(static_cast<epoch_time_seconds>(
+        (static_cast<uint64_t>(generation_and_time & 0x3) << 32) | time_low));
+
+    positions_.emplace(ids_.back(), static_cast<uint32_t>(base + i));
+  }
+}
+
+uint32_t commit_graph::position(const oid &id) {
+  auto found = positions_.find(id);
+  if (found != positions_.end())
+    return found->second;
+
+  // Look up the commit, and any of its ancestors that are not in the
+  // graph yet, without recursion
+  struct frame {
+    explicit frame(const oid &id) : id(id), expanded(false), time(0) {}
+    oid id;
+    bool expanded;
+    oid tree;
+    epoch_time_seconds time;
+    std::vector<oid> parents;
+  };
+
+  std::vector<frame> stack{frame(id)};
+  while (!stack.empty()) {
+    if (contains(stack.back().id)) {
+      stack.pop_back();
+      continue;
+    }
+
+    if (!stack.back().expanded) {
+      git_commit *commit_c;
+      auto ret = git_commit_lookup(&commit_c, repo_, stack.back().id.c_ptr());
+      if (ret != 0) {
+        // Missing parents (e.g., in shallow clones) are left out
+        if (ret == GIT_ENOTFOUND && stack.size() > 1) {
+          git_exception::clear();
+          stack.pop_back();
+          continue;
+        }
+        throw git_exception();
+      }
+      commit cleanup(commit_c, ownership::user);
+
+      auto &top = stack.back();
+      top.expanded = true;
+      top.tree = oid(git_commit_tree_id(commit_c));
+      top.time = git_commit_time(commit_c);
+      for (unsigned int n = 0; n < git_commit_parentcount(commit_c); ++n)
+        top.parents.push_back(oid(git_commit_parent_id(commit_c, n)));
+
+      std::vector<oid> missing;
+      for (const auto &parent : top.parents)
+        if (!contains(parent))
+          missing.push_back(parent);
+      for (auto parent = missing.rbegin(); parent != missing.rend(); ++parent)
+        stack.push_back(frame(*parent));
+      continue;
+    }
+
+    auto &top = stack.back();
+    std::vector<uint32_t> parents;
+    for (const auto &parent : top.parents) {
+      auto parent_position = positions_.find(parent);
+      if (parent_position != positions_.end())
+        parents.push_back(parent_position->second);
+    }
+    append(top.id, top.tree, parents, top.time);
+    stack.pop_back();
+  }
+  return positions_.at(id);
+}
+
+uint32_t commit_graph::append(const oid &id, const oid &tree,
+                              const std::vector<uint32_t> &parents,
+                              epoch_time_seconds time) {
+  const auto result = static_cast<uint32_t>(ids_.size());
+  uint32_t generation = 0;
+  for (auto parent : parents)
+    generation = std::max(generation, generations_[parent]);
+
+  ids_.push_back(id);
+  trees_.push_back(tree);
+  generations_.push_back(generation + 1);
+  times_.push_back(time);
+  parents_.insert(parents_.end(), parents.begin(), parents.end());
+  parent_offsets_.push_back(static_cast<uint32_t>(parents_.size()));
+  positions_.emplace(id, result);
+  return result;
+}
+
+void commit_graph::compute_generations() {
+  std::vector<uint32_t> generations(size(), 0);
+  std::vector<uint32_t> stack;
+  for (uint32_t start = 0; start < generations.size(); ++start) {
+    if (generations[start])
+      continue;
+    stack.push_back(start);
+    while (!stack.empty()) {
+      auto commit = stack.back();
+      if (generations[commit]) {
+        stack.pop_back();
+        continue;
+      }
+      bool ready = true;
+      uint32_t generation = 0;
+      for (auto p = parents_begin(commit); p != parents_end(commit); ++p) {
+        if (!generations[*p]) {
+          stack.push_back(*p);
+          ready = false;
+        } else {
+          generation = std::max(generation, generations[*p]);
+        }
+      }
+      if (ready) {
+        generations[commit] = generation + 1;
+        stack.pop_back();
+      }
+    }
+  }
+  generations_.swap(generations);
+}
+
+const uint32_t *commit_graph::parents_begin(uint32_t position) const {
+  return parents_.data() + parent_offsets_[position];
+}
+
+const uint32_t *commit_graph::parents_end(uint32_t position) const {
+  return parents_.data() + parent_offsets_[position + 1];
+}
+
+std::vector<uint32_t> commit_graph::merge_base_positions(uint32_t one,
+                                                         uint32_t two) {
+  if (one == two)
+    return {one};
+
+  std::vector<uint32_t> candidates;
+  {
+    // Paint ancestors of both commits, highest generation first, until
+    // only commits reachable from both sides are left to visit
+    scratch_flags flags(flags_, size());
+    std::vector<queue_entry> queue;
+    auto push = [&](uint32_t commit) {
+      queue.push_back({generations_[commit], times_[commit], commit});
+      std::push_heap(queue.begin(), queue.end(), by_generation());
+    };
+    auto has_nonstale = [&]() -> bool {
+      for (const auto &entry : queue)
+        if (!(flags.get(entry.position) & stale))
+          return true;
+      return false;
+    };
+
+    flags.add(one, parent1);
+    push(one);
+    flags.add(two, parent2);
+    push(two);
+
+    std::vector<uint32_t> results;
+    while (has_nonstale()) {
+      std::pop_heap(queue.begin(), queue.end(), by_generation());
+      auto commit = queue.back().position;
+      queue.pop_back();
+
+      uint8_t painted = flags.get(commit) & (parent1 | parent2 | stale);
+      if (painted == (parent1 | parent2)) {
+        if (!(flags.get(commit) & result)) {
+          flags.add(commit, result);
+          results.push_back(commit);
+        }
+        painted |= stale;
+      }
+      for (auto p = parents_begin(commit); p != parents_end(commit); ++p) {
+        if ((flags.get(*p) & painted) == painted)
+          continue;
+        flags.add(*p, painted);
+        push(*p);
+      }
+    }
+
+    for (auto commit : results)
+      if (!(flags.get(commit) & stale))
+        candidates.push_back(commit);
+  }
+
+  // Drop candidates that are ancestors of other candidates
+  std::vector<uint32_t> bases;
+  for (auto candidate : candidates) {
+    bool redundant = false;
+    for (auto other : candidates) {
+      if (other != candidate && is_ancestor(ids_[candidate], ids_[other])) {
+        redundant = true;
+        break;
+      }
+    }
+    if (!redundant)
+      bases.push_back(candidate);
+  }
+
+  std::sort(bases.begin(), bases.end(),
+            [this](uint32_t lhs, uint32_t rhs) -> bool {
+              if (generations_[lhs] != generations_[rhs])
+                return generations_[lhs] > generations_[rhs];
+              return times_[lhs] > times_[rhs];
+            });
+  return bases;
+}
+
+} // namespace cppgit2
@@ -1,6 +1,8 @@
 #include <cppgit2/config.hpp>
 #include <functional>
 
+#include "foreach_payload.hpp"
+
 namespace cppgit2 {
 
 config::config() : c_ptr_(nullptr), owner_(ownership::libgit2) {}
@@ -218,41 +220,40 @@ size_t config::size() const {
 }
 
 void config::for_each(std::function<void(const entry &)> visitor) {
-  struct visitor_wrapper {
-    std::function<void(const entry &)> fn;
-  };
-
-  visitor_wrapper wrapper;
-  wrapper.fn = visitor;
-
-  auto callback_c = [](const git_config_entry *entry, void *payload) {
-    auto wrapper = reinterpret_cast<visitor_wrapper *>(payload);
-    wrapper->fn(config::entry(const_cast<git_config_entry *>(entry)));
-    return 0;
-  };
-
-  if (git_config_foreach(c_ptr_, callback_c, (void *)(&wrapper)))
-    throw git_exception();
+  for_each(visitor, cancellation_token());
 }
 
 void config::for_each(const std::string &regexp,
                       std::function<void(const entry &)> visitor) {
-  struct visitor_wrapper {
-    std::function<void(const entry &)> fn;
+  for_each(regexp, visitor, cancellation_token());
+}
+
+void config::for_each(std::function<void(const entry &)> visitor,
+                      const cancellation_token &token) {
+  typedef detail::foreach_payload<decltype(visitor)> payload;
+  payload wrapper(visitor, token);
+
+  auto callback_c = [](const git_config_entry *entry, void *data) -> int {
+    return payload::from(data)(
+        config::entry(const_cast<git_config_entry *>(entry)));
   };
 
-  visitor_wrapper wrapper;
-  wrapper.fn = visitor;
+  wrapper.finish(git_config_foreach(c_ptr_, callback_c, wrapper.c_ptr()));
+}
 
-  auto callback_c = [](const git_config_entry *entry, void *payload) {
-    auto wrapper = reinterpret_cast<visitor_wrapper *>(payload);
-    wrapper->fn(config::entry(const_cast<git_config_entry *>(entry)));
-    return 0;
+void config::for_each(const std::string &regexp,
+                      std::function<void(const entry &)> visitor,
+                      const cancellation_token &token) {
+  typedef detail::foreach_payload<decltype(visitor)> payload;
+  payload wrapper(visitor, token);
+
+  auto callback_c = [](const git_config_entry *entry, void *data) -> int {
+    return payload::from(data)(
+        config::entry(const_cast<git_config_entry *>(entry)));
   };
 
-  if (git_config_foreach_match(c_ptr_, regexp.c_str(), callback_c,
-                               (void *)(&wrapper)))
-    throw git_exception();
+  wrapper.finish(git_config_foreach_match(c_ptr_, regexp.c_str(), callback_c,
+                                          wrapper.c_ptr()));
 }
 
 const git_config *config::c_ptr() const { return c_ptr_; }
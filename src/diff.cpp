@@ -1,6 +1,8 @@
 #include <cppgit2/diff.hpp>
 #include <functional>
 
+#include "foreach_payload.hpp"
+
 namespace cppgit2 {
 
 diff::diff() : c_ptr_(nullptr), owner_(ownership::libgit2) {}
@@ -107,9 +109,22 @@ void diff::for_each(
     std::function<void(const diff::delta &, const diff::hunk &,
                        const diff::line &)>
         line_callback) {
+  for_each(file_callback, binary_callback, hunk_callback, line_callback,
+           cancellation_token());
+}
+
+void diff::for_each(
+    std::function<void(const diff::delta &, float)> file_callback,
+    std::function<void(const diff::delta &, const diff::binary &)>
+        binary_callback,
+    std::function<void(const diff::delta &, const diff::hunk &)> hunk_callback,
+    std::function<void(const diff::delta &, const diff::hunk &,
+                       const diff::line &)>
+        line_callback,
+    const cancellation_token &token) {
 
   // Prepare wrapper to pass to C API
-  struct visitor_wrapper {
+  struct callbacks {
     std::function<void(const diff::delta &, float)> file_callback;
     std::function<void(const diff::delta &, const diff::binary &)>
         binary_callback;
@@ -118,48 +133,56 @@ void diff::for_each(
                        const diff::line &)>
         line_callback;
   };
-
-  visitor_wrapper wrapper;
-  wrapper.file_callback = file_callback;
-  wrapper.binary_callback = binary_callback;
-  wrapper.hunk_callback = hunk_callback;
-  wrapper.line_callback = line_callback;
+  typedef detail::foreach_payload<callbacks> payload;
+  payload wrapper(
+      {file_callback, binary_callback, hunk_callback, line_callback}, token);
 
   auto file_callback_c = [](const git_diff_delta *delta_c, float progress,
-                            void *payload) {
-    auto wrapper = reinterpret_cast<visitor_wrapper *>(payload);
-    wrapper->file_callback(delta(delta_c), progress);
+                            void *data) -> int {
+    auto &wrapper = payload::from(data);
+    if (wrapper.cancelled())
+      return GIT_EUSER;
+    if (wrapper.visitor.file_callback)
+      wrapper.visitor.file_callback(delta(delta_c), progress);
     return 0;
   };
 
   auto binary_callback_c = [](const git_diff_delta *delta_c,
-                              const git_diff_binary *binary_c, void *payload) {
-    auto wrapper = reinterpret_cast<visitor_wrapper *>(payload);
-    if (wrapper->binary_callback)
-      wrapper->binary_callback(delta(delta_c), binary(binary_c));
+                              const git_diff_binary *binary_c,
+                              void *data) -> int {
+    auto &wrapper = payload::from(data);
+    if (wrapper.cancelled())
+      return GIT_EUSER;
+    if (wrapper.visitor.binary_callback)
+      wrapper.visitor.binary_callback(delta(delta_c), binary(binary_c));
     return 0;
   };
 
   auto hunk_callback_c = [](const git_diff_delta *delta_c,
-                            const git_diff_hunk *hunk_c, void *payload) {
-    auto wrapper = reinterpret_cast<visitor_wrapper *>(payload);
-    if (wrapper->hunk_callback)
-      wrapper->hunk_callback(delta(delta_c), hunk(hunk_c));
+                            const git_diff_hunk *hunk_c, void *data) -> int {
+    auto &wrapper = payload::from(data);
+    if (wrapper.cancelled())
+      return GIT_EUSER;
+    if (wrapper.visitor.hunk_callback)
+      wrapper.visitor.hunk_callback(delta(delta_c), hunk(hunk_c));
     return 0;
   };
 
   auto line_callback_c = [](const git_diff_delta *delta_c,
                             const git_diff_hunk *hunk_c,
-                            const git_diff_line *line_c, void *payload) {
-    auto wrapper = reinterpret_cast<visitor_wrapper *>(payload);
-    if (wrapper->line_callback)
-      wrapper->line_callback(delta(delta_c), hunk(hunk_c), line(line_c));
+                            const git_diff_line *line_c, void *data) -> int {
+    auto &wrapper = payload::from(data);
+    if (wrapper.cancelled())
+      return GIT_EUSER;
+    if (wrapper.visitor.line_callback)
+      wrapper.visitor.line_callback(delta(delta_c), hunk(hunk_c),
+                                    line(line_c));
     return 0;
   };
 
-  if (git_diff_foreach(c_ptr_, file_callback_c, binary_callback_c,
-                       hunk_callback_c, line_callback_c, (void *)(&wrapper)))
-    throw git_exception();
+  wrapper.finish(git_diff_foreach(c_ptr_, file_callback_c, binary_callback_c,
+                                  hunk_callback_c, line_callback_c,
+                                  wrapper.c_ptr()));
 }
 
 void diff::print(diff::format format,
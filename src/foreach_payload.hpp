@@ -0,0 +1,71 @@
+#pragma once
+#include <cppgit2/cancellation_token.hpp>
+#include <cppgit2/git_exception.hpp>
+#include <git2.h>
+#include <utility>
+
+// Payload of the C callbacks of cancellable libgit2 iterations
+// Internal: not installed with the public headers.
+
+namespace cppgit2 {
+
+namespace detail {
+
+// Visitor passed through the `void *payload` of a libgit2 foreach function
+//
+// The C callbacks return GIT_EUSER once `token` is cancelled, or once the
+// visitor asks to stop; libgit2 then ends the iteration and returns
+// GIT_EUSER, which finish() turns into a normal return. `Visitor` is a
+// std::function, or a struct of them for iterations with several callbacks.
+template <typename Visitor> class foreach_payload {
+public:
+  foreach_payload(Visitor visitor, const cancellation_token &token)
+      : visitor(std::move(visitor)), token_(token), stopped_(false) {}
+
+  // Pointer to pass as the payload of the libgit2 function
+  void *c_ptr() { return this; }
+
+  // The payload behind a callback's `void *payload`
+  static foreach_payload &from(void *payload) {
+    return *reinterpret_cast<foreach_payload *>(payload);
+  }
+
+  // Check if the iteration must end before the next visit
+  bool cancelled() const { return stopped_ || token_.is_cancelled(); }
+
+  // Callback result for a visit: calls `visitor` with `args`, unless the
+  // iteration is cancelled or `visitor` is empty
+  template <typename... Args> int operator()(Args &&... args) {
+    if (cancelled())
+      return GIT_EUSER;
+    if (visitor)
+      visitor(std::forward<Args>(args)...);
+    return 0;
+  }
+
+  // Callback result that ends the iteration without an error
+  int stop() {
+    stopped_ = true;
+    return GIT_EUSER;
+  }
+
+  // Check the result of the libgit2 function
+  // Throws git_exception, unless the iteration succeeded or was ended by
+  // the token or by stop().
+  void finish(int ret) const {
+    if (ret == GIT_EUSER && cancelled())
+      git_exception::clear();
+    else if (ret)
+      throw git_exception();
+  }
+
+  Visitor visitor;
+
+private:
+  const cancellation_token &token_;
+  bool stopped_;
+};
+
+} // namespace detail
+
+} // namespace cppgit2
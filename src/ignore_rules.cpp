@@ -0,0 +1,265 @@
+#include "ignore_rules.hpp"
+#include <cctype>
+#include <cppgit2/git_exception.hpp>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+namespace cppgit2 {
+
+namespace detail {
+
+namespace {
+
+bool read_file(const std::string &path, std::string &contents) {
+  std::ifstream file(path, std::ios::binary);
+  if (!file)
+    return false;
+  std::ostringstream stream;
+  stream << file.rdbuf();
+  contents = stream.str();
+  return true;
+}
+
+bool same_char(char lhs, char rhs, bool ignore_case) {
+  if (ignore_case)
+    return std::tolower(static_cast<unsigned char>(lhs)) ==
+           std::tolower(static_cast<unsigned char>(rhs));
+  return lhs == rhs;
+}
+
+bool in_range(char low, char high, char c, bool ignore_case) {
+  const auto value = static_cast<unsigned char>(c);
+  if (static_cast<unsigned char>(low) <= value &&
+      value <= static_cast<unsigned char>(high))
+    return true;
+  if (!ignore_case)
+    return false;
+  const auto other = std::isupper(value) ? std::tolower(value)
+                                         : std::toupper(value);
+  return static_cast<unsigned char>(low) <= other &&
+         other <= static_cast<unsigned char>(high);
+}
+
+// Bracket expression at `p` ("[...]"), advanced past it
+// Returns false if the expression is not closed, for a literal '['.
+bool match_bracket(const char *&p, char c, bool ignore_case, bool &matched) {
+  const char *q = p + 1;
+  const bool negated = *q == '!' || *q == '^';
+  if (negated)
+    ++q;
+  const char *first = q;
+  bool found = false;
+  for (; *q && (*q != ']' || q == first); ++q) {
+    char low = *q;
+    if (low == '\\' && q[1])
+      low = *++q;
+    char high = low;
+    if (q[1] == '-' && q[2] && q[2] != ']') {
+      q += 2;
+      high = *q;
+      if (high == '\\' && q[1])
+        high = *++q;
+    }
+    if (in_range(low, high, c, ignore_case))
+      found = true;
+  }
+  if (*q != ']')
+    return false;
+  p = q + 1;
+  matched = found != negated;
+  return true;
+}
+
+bool match_from(const char *pattern, const char *p, const char *t,
+                bool ignore_case) {
+  while (*p) {
+    if (*p == '*') {
+      const char *stars = p;
+      while (*p == '*')
+        ++p;
+      const bool any_depth = p - stars >= 2 &&
+                             (stars == pattern || stars[-1] == '/') &&
+                             (*p == '\0' || *p == '/');
+      if (any_depth) {
+        if (*p == '\0')
+          return true;
+        // "**/" matches zero or more leading directories
+        for (const char *s = t;; ++s) {
+          if (match_from(pattern, p + 1, s, ignore_case))
+            return true;
+          s = std::strchr(s, '/');
+          if (!s)
+            return false;
+        }
+      }
+      if (*p == '\0')
+        return std::strchr(t, '/') == nullptr;
+      for (const char *s = t;; ++s) {
+        if (match_from(pattern, p, s, ignore_case))
+          return true;
+        if (*s == '\0' || *s == '/')
+          return false;
+      }
+    }
+
+    if (*t == '\0')
+      return false;
+    if (*p == '?') {
+      if (*t == '/')
+        return false;
+      ++p;
+      ++t;
+      continue;
+    }
+    if (*p == '[') {
+      bool matched;
+      if (match_bracket(p, *t, ignore_case, matched)) {
+        if (*t == '/' || !matched)
+          return false;
+        ++t;
+        continue;
+      }
+    } else if (*p == '\\' && p[1]) {
+      ++p;
+    }
+    if (!same_char(*p, *t, ignore_case))
+      return false;
+    ++p;
+    ++t;
+  }
+  return *t == '\0';
+}
+
+} // namespace
+
+std::shared_ptr<const ignore_rules> ignore_rules::load(git_repository *repo) {
+  std::shared_ptr<ignore_rules> result(new ignore_rules());
+  result->workdir_ = git_repository_workdir(repo);
+
+  git_config *config_c;
+  if (git_repository_config_snapshot(&config_c, repo))
+    throw git_exception();
+  std::unique_ptr<git_config, void (*)(git_config *)> config_owner(
+      config_c, git_config_free);
+  int ignore_case;
+  if (git_config_get_bool(&ignore_case, config_c, "core.ignorecase") == 0)
+    result->ignore_case_ = ignore_case != 0;
+
+  std::string excludes_file;
+  git_buf buffer = {nullptr, 0, 0};
+  if (git_config_get_path(&buffer, config_c, "core.excludesfile") == 0) {
+    excludes_file.assign(buffer.ptr, buffer.size);
+    git_buf_dispose(&buffer);
+  } else if (const char *xdg = std::getenv("XDG_CONFIG_HOME")) {
+    excludes_file = std::string(xdg) + "/git/ignore";
+  } else if (const char *home = std::getenv("HOME")) {
+    excludes_file = std::string(home) + "/.config/git/ignore";
+  }
+  git_exception::clear();
+
+  result->global_.resize(2);
+  parse(std::string(git_repository_commondir(repo)) + "info/exclude",
+        result->global_[0]);
+  if (!excludes_file.empty())
+    parse(excludes_file, result->global_[1]);
+  parse(result->workdir_ + ".gitignore", result->own_);
+  return result;
+}
+
+std::shared_ptr<const ignore_rules>
+ignore_rules::enter(const std::shared_ptr<const ignore_rules> &parent,
+                    const std::string &directory) {
+  std::shared_ptr<ignore_rules> result(new ignore_rules());
+  result->parent_ = parent;
+  result->workdir_ = parent->workdir_;
+  result->ignore_case_ = parent->ignore_case_;
+  result->own_.base = directory;
+  parse(result->workdir_ + directory + ".gitignore", result->own_);
+  return result;
+}
+
+void ignore_rules::parse(const std::string &file, pattern_list &list) {
+  std::string contents;
+  if (!read_file(file, contents))
+    return;
+
+  std::istringstream lines(contents);
+  std::string line;
+  while (std::getline(lines, line)) {
+    if (!line.empty() && line.back() == '\r')
+      line.pop_back();
+
+    // Trailing spaces are dropped, unless escaped
+    auto end = line.size();
+    while (end > 0 && (line[end - 1] == ' ' || line[end - 1] == '\t') &&
+           !(end > 1 && line[end - 2] == '\\'))
+      --end;
+    line.resize(end);
+    if (line.empty() || line[0] == '#')
+      continue;
+
+    pattern item{line, false, false, false};
+    if (item.glob[0] == '!') {
+      item.negated = true;
+      item.glob.erase(0, 1);
+    }
+    if (!item.glob.empty() && item.glob.back() == '/') {
+      item.directory_only = true;
+      item.glob.pop_back();
+    }
+    if (item.glob.find('/') != std::string::npos) {
+      item.anchored = true;
+      if (item.glob[0] == '/')
+        item.glob.erase(0, 1);
+    }
+    if (!item.glob.empty())
+      list.patterns.push_back(item);
+  }
+}
+
+int ignore_rules::match_list(const pattern_list &list,
+                             const std::string &path,
+                             bool is_directory) const {
+  if (list.patterns.empty() || path.compare(0, list.base.size(), list.base))
+    return 0;
+  const char *relative = path.c_str() + list.base.size();
+  const char *slash = std::strrchr(relative, '/');
+  const char *name = slash ? slash + 1 : relative;
+
+  for (auto it = list.patterns.rbegin(); it != list.patterns.rend(); ++it) {
+    if (it->directory_only && !is_directory)
+      continue;
+    if (match(it->glob.c_str(), it->anchored ? relative : name, ignore_case_))
+      return it->negated ? -1 : 1;
+  }
+  return 0;
+}
+
+bool ignore_rules::is_ignored(const std::string &path) const {
+  const bool is_directory = !path.empty() && path.back() == '/';
+  const std::string name =
+      is_directory ? path.substr(0, path.size() - 1) : path;
+
+  const ignore_rules *rules = this;
+  for (;; rules = rules->parent_.get()) {
+    if (const int result = match_list(rules->own_, name, is_directory))
+      return result > 0;
+    if (!rules->parent_)
+      break;
+  }
+  for (const auto &list : rules->global_)
+    if (const int result = match_list(list, name, is_directory))
+      return result > 0;
+  return false;
+}
+
+bool ignore_rules::match(const char *pattern, const char *text,
+                         bool ignore_case) {
+  return match_from(pattern, pattern, text, ignore_case);
+}
+
+} // namespace detail
+
+} // namespace cppgit2
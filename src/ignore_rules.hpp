@@ -0,0 +1,78 @@
+#pragma once
+#include <git2.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Ignore rules loaded once per directory of a working directory walk
+// Internal: not installed with the public headers.
+
+namespace cppgit2 {
+
+namespace detail {
+
+// Ignore rules in effect in one directory of the working directory
+//
+// git_ignore_path_is_ignored loads (or checks) the ignore files of every
+// parent of the path on each call. Here the rules of a directory are built
+// once, from those of its parent and its own .gitignore, as a walk
+// descends, and are then shared by the threads checking its entries.
+//
+// As in gitignore(5), the deepest .gitignore with a matching pattern
+// decides, then info/exclude, then core.excludesFile; within a file, the
+// last matching pattern wins. Leading directories are not checked: walks
+// do not descend into ignored directories, or report everything below them
+// as ignored.
+class ignore_rules {
+public:
+  // Rules of the top-level directory of `repo`'s working directory
+  // Throws git_exception if the configuration cannot be read.
+  static std::shared_ptr<const ignore_rules> load(git_repository *repo);
+
+  // Rules of `directory` (e.g., "src/"), a subdirectory of `parent`'s
+  static std::shared_ptr<const ignore_rules>
+  enter(const std::shared_ptr<const ignore_rules> &parent,
+        const std::string &directory);
+
+  // Check if `path`, relative to the working directory, is ignored
+  // Directories end with a '/'.
+  bool is_ignored(const std::string &path) const;
+
+  // Match `text` against the glob `pattern`, as git's wildmatch does with
+  // WM_PATHNAME: '*', '?' and brackets do not match '/', "**/" matches any
+  // number of leading directories and a trailing "/**" anything below
+  static bool match(const char *pattern, const char *text,
+                    bool ignore_case = false);
+
+private:
+  struct pattern {
+    std::string glob;
+    bool negated;
+    bool directory_only;
+    bool anchored; // matched against the whole relative path
+  };
+
+  // Patterns of one ignore file, relative to `base` ("" or "dir/")
+  struct pattern_list {
+    std::string base;
+    std::vector<pattern> patterns;
+  };
+
+  ignore_rules() : ignore_case_(false) {}
+
+  static void parse(const std::string &file, pattern_list &list);
+
+  // 1 if ignored, -1 if re-included, 0 if no pattern of `list` matches
+  int match_list(const pattern_list &list, const std::string &path,
+                 bool is_directory) const;
+
+  std::shared_ptr<const ignore_rules> parent_;
+  pattern_list own_;                 // .gitignore of this directory
+  std::vector<pattern_list> global_; // info/exclude, core.excludesFile
+  std::string workdir_;
+  bool ignore_case_;
+};
+
+} // namespace detail
+
+} // namespace cppgit2
@@ -1,5 +1,12 @@
+#include <algorithm>
+#include <atomic>
 #include <cppgit2/repository.hpp>
+#include <cppgit2/sparse_checkout.hpp>
+#include <cstring>
 #include <functional>
+#include <thread>
+
+#include "worker_pool.hpp"
 
 namespace cppgit2 {
 
@@ -101,18 +108,78 @@ size_t index::find_first_matching_prefix(const std::string &prefix) {
 }
 
 void index::for_each(std::function<void(const index::entry &)> visitor) {
+  for_each(visitor, cancellation_token());
+}
+
+void index::for_each(std::function<void(const index::entry &)> visitor,
+                     const cancellation_token &token) {
   git_index_iterator *iter;
   git_index_iterator_new(&iter, c_ptr_);
   const git_index_entry *entry_c;
   int ret;
-  while ((ret = git_index_iterator_next(&entry_c, iter)) == 0) {
-    entry payload(nullptr);
-    *(payload.c_ptr_) = *(entry_c);
+  while (!token.is_cancelled() &&
+         (ret = git_index_iterator_next(&entry_c, iter)) == 0) {
+    // Wraps the entry in the iterator's snapshot, nothing is copied
+    const entry payload(const_cast<git_index_entry *>(entry_c));
     visitor(payload);
   }
   git_index_iterator_free(iter);
 }
 
+index::entry_range index::entries() const {
+  return entry_range(c_ptr_, git_index_entrycount(c_ptr_));
+}
+
+void index::parallel_for_each(std::function<void(const entry_view &)> visitor,
+                              size_t thread_count) const {
+  const auto count = git_index_entrycount(c_ptr_);
+  if (count == 0)
+    return;
+  // Sorts the entries (if needed) before they are shared between threads
+  git_index_get_byindex(c_ptr_, 0);
+
+  if (thread_count == 0)
+    thread_count = std::max<size_t>(1, std::thread::hardware_concurrency());
+  const auto chunk_size = (count + thread_count - 1) / thread_count;
+
+  // One chunk of consecutive entries per thread
+  std::atomic<bool> stop(false);
+  detail::run_workers(
+      (count + chunk_size - 1) / chunk_size, stop, [&](size_t worker) {
+        const auto begin = worker * chunk_size;
+        const auto end = std::min(begin + chunk_size, count);
+        for (auto i = begin; i < end && !stop; ++i)
+          visitor(entry_view(git_index_get_byindex(c_ptr_, i)));
+      });
+}
+
+void index::for_each(const sparse_checkout &cone,
+                     std::function<void(const entry_view &)> visitor) const {
+  const auto count = git_index_entrycount(c_ptr_);
+  size_t i = 0;
+  while (i < count) {
+    const auto entry = git_index_get_byindex(c_ptr_, i);
+    const auto excluded = cone.excluded_directory(entry->path);
+    if (excluded.empty()) {
+      visitor(entry_view(entry));
+      ++i;
+      continue;
+    }
+
+    // Skip to the first entry after the excluded directory
+    size_t low = i + 1, high = count;
+    while (low < high) {
+      const auto middle = low + (high - low) / 2;
+      if (std::strncmp(git_index_get_byindex(c_ptr_, middle)->path,
+                       excluded.c_str(), excluded.size()) == 0)
+        low = middle + 1;
+      else
+        high = middle;
+    }
+    i = low;
+  }
+}
+
 void index::for_each_conflict(
     std::function<void(const entry &, const entry &, const entry &)> visitor) {
   git_index_conflict_iterator *iter;
@@ -121,11 +188,10 @@ void index::for_each_conflict(
   int ret;
   while ((ret = git_index_conflict_next(&ancestor_out, &our_out, &their_out,
                                         iter)) == 0) {
-    entry ancestor_payload(nullptr), our_payload(nullptr),
-        their_payload(nullptr);
-    *(ancestor_payload.c_ptr_) = *(ancestor_out);
-    *(our_payload.c_ptr_) = *(our_out);
-    *(their_payload.c_ptr_) = *(their_out);
+    // A side that is missing from the conflict is an empty entry
+    const entry ancestor_payload(const_cast<git_index_entry *>(ancestor_out)),
+        our_payload(const_cast<git_index_entry *>(our_out)),
+        their_payload(const_cast<git_index_entry *>(their_out));
     visitor(ancestor_payload, our_payload, their_payload);
   }
   git_index_conflict_iterator_free(iter);
@@ -0,0 +1,18 @@
+#include <cppgit2/libgit2_api.hpp>
+
+namespace cppgit2 {
+
+namespace {
+
+// Process-wide libgit2 lifetime
+// Constructed on first use, destroyed at exit
+struct process_lifetime {
+  process_lifetime() { git_libgit2_init(); }
+  ~process_lifetime() { git_libgit2_shutdown(); }
+};
+
+} // namespace
+
+void libgit2_api::initialize() { static process_lifetime lifetime; }
+
+} // namespace cppgit2
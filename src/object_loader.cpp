@@ -0,0 +1,114 @@
+#include <algorithm>
+#include <cppgit2/object_loader.hpp>
+#include <cppgit2/repository.hpp>
+#include <tuple>
+
+namespace cppgit2 {
+
+namespace {
+
+std::vector<oid> sorted_unique(const std::vector<oid> &ids) {
+  std::vector<oid> result(ids);
+  std::sort(result.begin(), result.end());
+  result.erase(std::unique(result.begin(), result.end()), result.end());
+  return result;
+}
+
+// Objects looked up by a batch, free'd at the end of the batch
+struct loaded_objects {
+  explicit loaded_objects(size_t size) : objects(size, nullptr) {}
+
+  ~loaded_objects() {
+    for (auto object_c : objects)
+      if (object_c)
+        git_object_free(object_c);
+  }
+
+  std::vector<git_object *> objects;
+};
+
+} // namespace
+
+object_loader::object_loader(const repository &repo)
+    : repo_(const_cast<git_repository *>(repo.c_ptr())),
+      pack_dir_(repo.commondir()) {
+  if (!pack_dir_.empty() && pack_dir_.back() != '/')
+    pack_dir_ += '/';
+  pack_dir_ += "objects/pack";
+  refresh();
+}
+
+void object_loader::refresh() {
+  std::vector<pack_index> packs;
+  for (const auto &path : pack_index::paths(pack_dir_))
+    packs.emplace_back(path);
+  packs_.swap(packs);
+}
+
+std::vector<object> object_loader::lookup(const std::vector<oid> &ids,
+                                          object::object_type type) const {
+  const auto unique_ids = sorted_unique(ids);
+  loaded_objects loaded(unique_ids.size());
+  for (auto i : storage_order(unique_ids)) {
+    if (git_object_lookup(&loaded.objects[i], repo_, unique_ids[i].c_ptr(),
+                          static_cast<git_object_t>(type)))
+      throw git_exception();
+  }
+
+  // Capacity is reserved up front, so the objects are never copied
+  std::vector<object> result;
+  result.reserve(ids.size());
+  for (const auto &id : ids) {
+    const auto i = static_cast<size_t>(
+        std::lower_bound(unique_ids.begin(), unique_ids.end(), id) -
+        unique_ids.begin());
+    git_object *object_c;
+    if (git_object_dup(&object_c, loaded.objects[i]))
+      throw git_exception();
+    result.emplace_back(object_c, ownership::user);
+  }
+  return result;
+}
+
+void object_loader::for_each(const std::vector<oid> &ids,
+                             std::function<bool(const object &)> visitor,
+                             object::object_type type) const {
+  const auto unique_ids = sorted_unique(ids);
+  for (auto i : storage_order(unique_ids)) {
+    git_object *object_c;
+    if (git_object_lookup(&object_c, repo_, unique_ids[i].c_ptr(),
+                          static_cast<git_object_t>(type)))
+      throw git_exception();
+    const object current(object_c, ownership::user);
+    if (!visitor(current))
+      return;
+  }
+}
+
+std::vector<size_t>
+object_loader::storage_order(const std::vector<oid> &ids) const {
+  // {pack, offset, position}; objects outside the packs sort last, by id
+  typedef std::tuple<size_t, uint64_t, size_t> location;
+  std::vector<location> locations;
+  locations.reserve(ids.size());
+  for (size_t i = 0; i < ids.size(); ++i) {
+    location current(packs_.size(), 0, i);
+    for (size_t pack = 0; pack < packs_.size(); ++pack) {
+      size_t n;
+      if (packs_[pack].find(ids[i], n)) {
+        current = location(pack, packs_[pack].offset(n), i);
+        break;
+      }
+    }
+    locations.push_back(current);
+  }
+  std::sort(locations.begin(), locations.end());
+
+  std::vector<size_t> result;
+  result.reserve(locations.size());
+  for (const auto &current : locations)
+    result.push_back(std::get<2>(current));
+  return result;
+}
+
+} // namespace cppgit2
@@ -2,6 +2,8 @@
 using namespace cppgit2;
 #include <functional>
 
+#include "foreach_payload.hpp"
+
 odb::odb() : c_ptr_(nullptr), owner_(ownership::user) {
   git_odb_new(&c_ptr_); // owned by user
 }
@@ -76,23 +78,19 @@ oid odb::exists(const oid &id, size_t length) const {
 }
 
 void odb::for_each(std::function<void(const oid &)> visitor) {
-  // Prepare wrapper to pass to C API
-  struct visitor_wrapper {
-    std::function<void(const oid &)> fn;
-  };
+  for_each(visitor, cancellation_token());
+}
 
-  visitor_wrapper wrapper;
-  wrapper.fn = visitor;
+void odb::for_each(std::function<void(const oid &)> visitor,
+                   const cancellation_token &token) {
+  typedef detail::foreach_payload<decltype(visitor)> payload;
+  payload wrapper(visitor, token);
 
-  auto callback_c = [](const git_oid *oid_c, void *payload) {
-    auto wrapper = reinterpret_cast<visitor_wrapper *>(payload);
-    if (wrapper->fn)
-      wrapper->fn(oid(oid_c));
-    return 0;
+  auto callback_c = [](const git_oid *oid_c, void *data) -> int {
+    return payload::from(data)(oid(oid_c));
   };
 
-  if (git_odb_foreach(c_ptr_, callback_c, (void *)(&wrapper)))
-    throw git_exception();
+  wrapper.finish(git_odb_foreach(c_ptr_, callback_c, wrapper.c_ptr()));
 }
 
 oid odb::hash(const void *data, size_t length,
@@ -1,41 +1,69 @@
 #include <cppgit2/oid.hpp>
 #include <iostream>
+#include <type_traits>
 
 namespace cppgit2 {
 
-oid::oid() {}
+static_assert(sizeof(oid) == GIT_OID_RAWSZ, "oid must be a 20-byte value");
+static_assert(std::is_standard_layout<oid>::value &&
+                  std::is_trivially_copy_constructible<oid>::value &&
+                  std::is_trivially_destructible<oid>::value,
+              "oid must be a trivially copyable POD");
+
+namespace {
+
+// Two hex digits for every byte value
+struct hex_table {
+  char pairs[256][2];
+  hex_table() {
+    static const char digits[] = "0123456789abcdef";
+    for (int i = 0; i < 256; ++i) {
+      pairs[i][0] = digits[i >> 4];
+      pairs[i][1] = digits[i & 0xF];
+    }
+  }
+};
+
+const hex_table &hex_pairs() {
+  static const hex_table table;
+  return table;
+}
+
+// Write the 40 hex characters of `id` to `out` (no NUL terminator)
+void format_hex(const git_oid &id, char *out) {
+  const auto &table = hex_pairs();
+  for (size_t i = 0; i < GIT_OID_RAWSZ; ++i) {
+    out[2 * i] = table.pairs[id.id[i]][0];
+    out[2 * i + 1] = table.pairs[id.id[i]][1];
+  }
+}
+
+} // namespace
 
 oid::oid(const std::string &hex_string) {
+  libgit2_api::initialize();
   if (git_oid_fromstr(&c_struct_, hex_string.c_str()))
     throw git_exception();
 }
 
 oid::oid(const std::string &hex_string, size_t length) {
+  libgit2_api::initialize();
   if (git_oid_fromstrn(&c_struct_, hex_string.c_str(), length))
     throw git_exception();
 }
 
-oid::oid(const git_oid *c_ptr) {
-  // Convert git_oid * to string and construct this oid
-  size_t n = GIT_OID_HEXSZ;
-  std::string buffer(n, '0');
-  if (!git_oid_tostr(const_cast<char *>(buffer.c_str()), n + 1, c_ptr))
-    throw git_exception();
-  // Construct from string
-  if (git_oid_fromstr(&c_struct_, buffer.c_str()))
-    throw git_exception();
-}
+oid::oid(const git_oid *c_ptr) { git_oid_cpy(&c_struct_, c_ptr); }
 
 oid::oid(const unsigned char *raw) { git_oid_fromraw(&c_struct_, raw); }
 
-int oid::compare(const oid &rhs) const {
-  return git_oid_cmp(&c_struct_, rhs.c_ptr());
-}
-
 int oid::compare(const oid &rhs, size_t length) const {
   return git_oid_ncmp(&c_struct_, rhs.c_ptr(), length);
 }
 
+int oid::compare(const std::string &rhs) const {
+  return git_oid_strcmp(&c_struct_, rhs.c_str());
+}
+
 oid oid::copy() const {
   oid result;
   git_oid_cpy(&result.c_struct_, &c_struct_);
@@ -44,18 +72,34 @@ oid oid::copy() const {
 
 bool oid::is_zero() const { return git_oid_iszero(&c_struct_); }
 
-bool oid::operator==(const oid &rhs) const {
-  return git_oid_equal(&c_struct_, rhs.c_ptr());
-}
-
 bool oid::operator==(const std::string &rhs) const {
   return git_oid_streq(&c_struct_, rhs.c_str()) ? false : true;
 }
 
 std::string oid::to_hex_string(size_t n) const {
-  std::string result(n, '0');
-  if (!git_oid_tostr(const_cast<char *>(result.c_str()), n + 1, &c_struct_))
-    throw git_exception();
+  char buffer[GIT_OID_HEXSZ];
+  format_hex(c_struct_, buffer);
+  return std::string(buffer, n < GIT_OID_HEXSZ ? n : GIT_OID_HEXSZ);
+}
+
+std::vector<std::string> oid::to_hex_string(const std::vector<oid> &ids) {
+  std::vector<std::string> result;
+  result.reserve(ids.size());
+  char buffer[GIT_OID_HEXSZ];
+  for (const auto &id : ids) {
+    format_hex(id.c_struct_, buffer);
+    result.emplace_back(buffer, GIT_OID_HEXSZ);
+  }
+  return result;
+}
+
+std::string oid::to_hex_string(const std::vector<oid> &ids, char separator) {
+  std::string result(ids.size() * (GIT_OID_HEXSZ + 1), separator);
+  char *out = &result[0];
+  for (const auto &id : ids) {
+    format_hex(id.c_struct_, out);
+    out += GIT_OID_HEXSZ + 1;
+  }
   return result;
 }
 
@@ -0,0 +1,395 @@
+#include <algorithm>
+#include <cppgit2/pack_bitmap.hpp>
+#include <cppgit2/repository.hpp>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <unordered_set>
+
+namespace cppgit2 {
+
+namespace {
+
+// See Documentation/technical/bitmap-format.txt in git
+const size_t bitmap_header_size = 4 + 2 + 2 + 4 + GIT_OID_RAWSZ;
+
+uint32_t read_be32(const unsigned char *p) {
+  return (static_cast<uint32_t>(p[0]) << 24) |
+         (static_cast<uint32_t>(p[1]) << 16) |
+         (static_cast<uint32_t>(p[2]) << 8) | static_cast<uint32_t>(p[3]);
+}
+
+uint64_t read_be64(const unsigned char *p) {
+  return (static_cast<uint64_t>(read_be32(p)) << 32) | read_be32(p + 4);
+}
+
+std::vector<unsigned char> read_contents(const std::string &path) {
+  std::ifstream file(path, std::ios::binary);
+  if (!file)
+    throw git_exception("failed to open pack bitmap file");
+  return std::vector<unsigned char>((std::istreambuf_iterator<char>(file)),
+                                    std::istreambuf_iterator<char>());
+}
+
+// First pack with a .bitmap next to its index, or "" if there is none
+std::string find_bitmap(const repository &repo) {
+  for (const auto &index_path : pack_index::paths(repo)) {
+    auto path = index_path.substr(0, index_path.size() - 4) + ".bitmap";
+    if (std::ifstream(path, std::ios::binary))
+      return path;
+  }
+  throw git_exception("repository has no pack bitmap");
+}
+
+// The .idx next to a .bitmap
+std::string index_path(const std::string &bitmap_path) {
+  const std::string suffix = ".bitmap";
+  if (bitmap_path.size() <= suffix.size() ||
+      bitmap_path.compare(bitmap_path.size() - suffix.size(), suffix.size(),
+                          suffix) != 0)
+    throw git_exception("pack bitmap path must end in .bitmap");
+  return bitmap_path.substr(0, bitmap_path.size() - suffix.size()) + ".idx";
+}
+
+// Decompress an EWAH bitmap (git's ewah/ewah_io.c layout)
+// Returns the number of bytes read
+size_t read_ewah(const unsigned char *data, size_t size,
+                 std::vector<uint64_t> &words, size_t &bit_size) {
+  if (size < 8)
+    throw git_exception("invalid EWAH bitmap");
+  bit_size = read_be32(data);
+  const size_t word_count = read_be32(data + 4);
+  const size_t total = 8 + word_count * 8 + 4;
+  if (size < total)
+    throw git_exception("invalid EWAH bitmap");
+
+  words.assign((bit_size + 63) / 64, 0);
+  size_t out = 0;
+  const unsigned char *word = data + 8;
+  for (size_t i = 0; i < word_count;) {
+    // Marker word: running bit, run length (32 bits), literal count (31 bits)
+    const uint64_t marker = read_be64(word + i * 8);
+    ++i;
+    const bool running_bit = marker & 1;
+    const size_t running_length = (marker >> 1) & 0xFFFFFFFFull;
+    const size_t literal_count = static_cast<size_t>(marker >> 33);
+    if (out + running_length > words.size() ||
+        out + running_length + literal_count > words.size() ||
+        i + literal_count > word_count)
+      throw git_exception("invalid EWAH bitmap");
+    if (running_bit)
+      std::fill(words.begin() + out, words.begin() + out + running_length,
+                ~0ull);
+    out += running_length;
+    for (size_t n = 0; n < literal_count; ++n, ++i)
+      words[out++] = read_be64(word + i * 8);
+  }
+  if (bit_size % 64 && !words.empty())
+    words.back() &= (1ull << (bit_size % 64)) - 1;
+  return total;
+}
+
+size_t popcount(uint64_t word) {
+#if defined(__GNUC__) || defined(__clang__)
+  return static_cast<size_t>(__builtin_popcountll(word));
+#else
+  size_t result = 0;
+  for (; word; word &= word - 1)
+    ++result;
+  return result;
+#endif
+}
+
+size_t lowest_bit(uint64_t word) {
+#if defined(__GNUC__) || defined(__clang__)
+  return static_cast<size_t>(__builtin_ctzll(word));
+#else
+  size_t result = 0;
+  while (!(word & 1)) {
+    word >>= 1;
+    ++result;
+  }
+  return result;
+#endif
+}
+
+} // namespace
+
+pack_bitmap::bitset::bitset() : size_(0) {}
+
+pack_bitmap::bitset::bitset(size_t size)
+    : size_(size), words_((size + 63) / 64, 0) {}
+
+size_t pack_bitmap::bitset::size() const { return size_; }
+
+bool pack_bitmap::bitset::test(size_t position) const {
+  return position < size_ && (words_[position / 64] >> (position % 64)) & 1;
+}
+
+void pack_bitmap::bitset::set(size_t position) {
+  if (position >= size_) {
+    size_ = position + 1;
+    words_.resize((size_ + 63) / 64, 0);
+  }
+  words_[position / 64] |= 1ull << (position % 64);
+}
+
+size_t pack_bitmap::bitset::count() const {
+  size_t result = 0;
+  for (auto word : words_)
+    result += popcount(word);
+  return result;
+}
+
+pack_bitmap::bitset &pack_bitmap::bitset::operator|=(const bitset &rhs) {
+  if (rhs.size_ > size_) {
+    size_ = rhs.size_;
+    words_.resize(rhs.words_.size(), 0);
+  }
+  for (size_t i = 0; i < rhs.words_.size(); ++i)
+    words_[i] |= rhs.words_[i];
+  return *this;
+}
+
+pack_bitmap::bitset &pack_bitmap::bitset::operator&=(const bitset &rhs) {
+  for (size_t i = 0; i < words_.size(); ++i)
+    words_[i] &= (i < rhs.words_.size()) ? rhs.words_[i] : 0;
+  return *this;
+}
+
+pack_bitmap::bitset &pack_bitmap::bitset::operator^=(const bitset &rhs) {
+  if (rhs.size_ > size_) {
+    size_ = rhs.size_;
+    words_.resize(rhs.words_.size(), 0);
+  }
+  for (size_t i = 0; i < rhs.words_.size(); ++i)
+    words_[i] ^= rhs.words_[i];
+  return *this;
+}
+
+pack_bitmap::bitset &pack_bitmap::bitset::and_not(const bitset &rhs) {
+  const auto common = std::min(words_.size(), rhs.words_.size());
+  for (size_t i = 0; i < common; ++i)
+    words_[i] &= ~rhs.words_[i];
+  return *this;
+}
+
+void pack_bitmap::bitset::for_each(
+    std::function<void(size_t position)> visitor) const {
+  for (size_t i = 0; i < words_.size(); ++i) {
+    for (auto word = words_[i]; word; word &= word - 1)
+      visitor(i * 64 + lowest_bit(word));
+  }
+}
+
+const std::vector<uint64_t> &pack_bitmap::bitset::words() const {
+  return words_;
+}
+
+pack_bitmap::pack_bitmap(const repository &repo)
+    : pack_bitmap(repo, find_bitmap(repo)) {}
+
+pack_bitmap::pack_bitmap(const repository &repo,
+                         const std::string &bitmap_path)
+    : repo_(const_cast<git_repository *>(repo.c_ptr())),
+      index_(index_path(bitmap_path)) {
+  open(bitmap_path);
+}
+
+size_t pack_bitmap::object_count() const { return index_.size(); }
+
+size_t pack_bitmap::commit_count() const { return entries_.size(); }
+
+bool pack_bitmap::has_bitmap(const oid &commit_id) const {
+  return commit_entries_.find(commit_id) != commit_entries_.end();
+}
+
+pack_bitmap::bitset pack_bitmap::bitmap(const oid &commit_id) const {
+  auto found = commit_entries_.find(commit_id);
+  if (found == commit_entries_.end())
+    throw git_exception("commit has no stored bitmap");
+
+  // Entries may be stored as the XOR with an earlier entry
+  bitset result(index_.size()), stored;
+  for (auto i = found->second;;) {
+    const auto &current = entries_[i];
+    read_ewah(data_.data() + current.offset, data_.size() - current.offset,
+              stored.words_, stored.size_);
+    result ^= stored;
+    if (!current.xor_offset)
+      break;
+    i -= current.xor_offset;
+  }
+  return result;
+}
+
+pack_bitmap::bitset
+pack_bitmap::reachable(const std::vector<oid> &commits) const {
+  bitset result(index_.size());
+  std::vector<oid> pending(commits);
+  std::unordered_set<oid> visited;
+  while (!pending.empty()) {
+    auto commit_id = pending.back();
+    pending.pop_back();
+    if (!visited.insert(commit_id).second)
+      continue;
+
+    size_t position;
+    if (find(commit_id, position) && result.test(position))
+      continue; // Already covered by another bitmap
+    if (has_bitmap(commit_id))
+      result |= bitmap(commit_id);
+    else
+      walk(commit_id, result, pending);
+  }
+  return result;
+}
+
+pack_bitmap::bitset
+pack_bitmap::reachable(const std::vector<oid> &include,
+                       const std::vector<oid> &exclude) const {
+  auto result = reachable(include);
+  result.and_not(reachable(exclude));
+  return result;
+}
+
+const pack_bitmap::bitset &pack_bitmap::commits() const { return commits_; }
+
+const pack_bitmap::bitset &pack_bitmap::trees() const { return trees_; }
+
+const pack_bitmap::bitset &pack_bitmap::blobs() const { return blobs_; }
+
+const pack_bitmap::bitset &pack_bitmap::tags() const { return tags_; }
+
+bool pack_bitmap::contains(const oid &id) const {
+  size_t position;
+  return find(id, position);
+}
+
+size_t pack_bitmap::position(const oid &id) const {
+  size_t result;
+  if (!find(id, result))
+    throw git_exception("object is not in the bitmapped pack");
+  return result;
+}
+
+oid pack_bitmap::object_id(size_t position) const {
+  if (position >= index_.size())
+    throw git_exception("bitmap position out of range");
+  return index_.id(pack_to_index_[position]);
+}
+
+void pack_bitmap::for_each_object(
+    const bitset &objects, std::function<bool(const oid &)> visitor) const {
+  const auto &words = objects.words();
+  for (size_t i = 0; i < words.size(); ++i) {
+    for (auto word = words[i]; word; word &= word - 1) {
+      const auto position = i * 64 + lowest_bit(word);
+      if (position >= index_.size())
+        return;
+      if (!visitor(object_id(position)))
+        return;
+    }
+  }
+}
+
+void pack_bitmap::open(const std::string &bitmap_path) {
+  // Pack order is the order of the objects in the pack file
+  const auto object_count = index_.size();
+  pack_to_index_.resize(object_count);
+  for (size_t i = 0; i < object_count; ++i)
+    pack_to_index_[i] = static_cast<uint32_t>(i);
+  std::sort(pack_to_index_.begin(), pack_to_index_.end(),
+            [this](uint32_t lhs, uint32_t rhs) -> bool {
+              return index_.offset(lhs) < index_.offset(rhs);
+            });
+  index_to_pack_.resize(object_count);
+  for (size_t i = 0; i < object_count; ++i)
+    index_to_pack_[pack_to_index_[i]] = static_cast<uint32_t>(i);
+
+  // Header: magic, version, options, entry count, pack checksum
+  data_ = read_contents(bitmap_path);
+  if (data_.size() < bitmap_header_size ||
+      std::memcmp(data_.data(), "BITM", 4) || data_[4] != 0 || data_[5] != 1)
+    throw git_exception("unsupported pack bitmap file");
+  const size_t entry_count = read_be32(data_.data() + 8);
+  if (oid(data_.data() + 12) != index_.pack_checksum())
+    throw git_exception("pack bitmap does not match its pack index");
+
+  // Type bitmaps
+  size_t offset = bitmap_header_size;
+  for (auto type : {&commits_, &trees_, &blobs_, &tags_})
+    offset += read_ewah(data_.data() + offset, data_.size() - offset,
+                        type->words_, type->size_);
+
+  // Commit entries: index position, XOR offset, flags, EWAH bitmap
+  entries_.reserve(entry_count);
+  for (size_t i = 0; i < entry_count; ++i) {
+    if (data_.size() < offset + 6)
+      throw git_exception("invalid pack bitmap file");
+    const size_t index_position = read_be32(data_.data() + offset);
+    const size_t xor_offset = data_[offset + 4];
+    if (index_position >= object_count || xor_offset > i)
+      throw git_exception("invalid pack bitmap file");
+    offset += 6;
+
+    entries_.push_back({offset, xor_offset});
+    commit_entries_.emplace(index_.id(index_position), i);
+
+    std::vector<uint64_t> words;
+    size_t bit_size;
+    offset += read_ewah(data_.data() + offset, data_.size() - offset, words,
+                        bit_size);
+  }
+}
+
+bool pack_bitmap::find(const oid &id, size_t &position) const {
+  size_t n;
+  if (!index_.find(id, n))
+    return false;
+  position = index_to_pack_[n];
+  return true;
+}
+
+void pack_bitmap::walk(const oid &commit_id, bitset &result,
+                       std::vector<oid> &pending) const {
+  git_commit *commit_c;
+  if (git_commit_lookup(&commit_c, repo_, commit_id.c_ptr()))
+    throw git_exception();
+  commit current(commit_c, ownership::user);
+
+  size_t position;
+  if (find(commit_id, position))
+    result.set(position);
+  for (unsigned int n = 0; n < git_commit_parentcount(commit_c); ++n)
+    pending.push_back(oid(git_commit_parent_id(commit_c, n)));
+
+  // Mark the commit's tree, skipping subtrees that are already marked
+  std::vector<oid> trees{oid(git_commit_tree_id(commit_c))};
+  while (!trees.empty()) {
+    auto tree_id = trees.back();
+    trees.pop_back();
+    const bool in_pack = find(tree_id, position);
+    if (in_pack && result.test(position))
+      continue;
+    if (in_pack)
+      result.set(position);
+
+    git_tree *tree_c;
+    if (git_tree_lookup(&tree_c, repo_, tree_id.c_ptr()))
+      throw git_exception();
+    tree current_tree(tree_c, ownership::user);
+    const auto entry_count = git_tree_entrycount(tree_c);
+    for (size_t i = 0; i < entry_count; ++i) {
+      const auto entry = git_tree_entry_byindex(tree_c, i);
+      const auto type = git_tree_entry_type(entry);
+      if (type == GIT_OBJECT_TREE)
+        trees.push_back(oid(git_tree_entry_id(entry)));
+      else if (type == GIT_OBJECT_BLOB && find(oid(git_tree_entry_id(entry)),
+                                               position))
+        result.set(position);
+    }
+  }
+}
+
+} // namespace cppgit2
@@ -0,0 +1,209 @@
+#include <algorithm>
+#include <cppgit2/pack_index.hpp>
+#include <cppgit2/repository.hpp>
+#include <cstring>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace cppgit2 {
+
+namespace {
+
+// See Documentation/technical/pack-format.txt in git
+const size_t header_size = 8 + 256 * 4;
+
+uint32_t read_be32(const unsigned char *p) {
+  return (static_cast<uint32_t>(p[0]) << 24) |
+         (static_cast<uint32_t>(p[1]) << 16) |
+         (static_cast<uint32_t>(p[2]) << 8) | static_cast<uint32_t>(p[3]);
+}
+
+uint64_t read_be64(const unsigned char *p) {
+  return (static_cast<uint64_t>(read_be32(p)) << 32) | read_be32(p + 4);
+}
+
+bool ends_with(const std::string &value, const std::string &suffix) {
+  return value.size() > suffix.size() &&
+         value.compare(value.size() - suffix.size(), suffix.size(), suffix) ==
+             0;
+}
+
+// Map `path` read-only; the mapping is released with the last copy
+std::shared_ptr<const unsigned char> map_file(const std::string &path,
+                                              size_t &size) {
+#ifdef _WIN32
+  auto file = CreateFileA(path.c_str(), GENERIC_READ,
+                          FILE_SHARE_READ | FILE_SHARE_DELETE, nullptr,
+                          OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+  if (file == INVALID_HANDLE_VALUE)
+    throw git_exception("failed to open pack index file");
+  LARGE_INTEGER file_size;
+  if (!GetFileSizeEx(file, &file_size) || file_size.QuadPart < 1) {
+    CloseHandle(file);
+    throw git_exception("unsupported pack index file");
+  }
+  size = static_cast<size_t>(file_size.QuadPart);
+  auto mapping =
+      CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  CloseHandle(file);
+  if (!mapping)
+    throw git_exception("failed to map pack index file");
+  auto view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+  CloseHandle(mapping);
+  if (!view)
+    throw git_exception("failed to map pack index file");
+  return std::shared_ptr<const unsigned char>(
+      static_cast<const unsigned char *>(view),
+      [](const unsigned char *data) {
+        UnmapViewOfFile(const_cast<unsigned char *>(data));
+      });
+#else
+  const int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0)
+    throw git_exception("failed to open pack index file");
+  struct stat status;
+  if (fstat(fd, &status) || status.st_size < 1) {
+    close(fd);
+    throw git_exception("unsupported pack index file");
+  }
+  size = static_cast<size_t>(status.st_size);
+  auto view = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (view == MAP_FAILED)
+    throw git_exception("failed to map pack index file");
+  const size_t length = size;
+  return std::shared_ptr<const unsigned char>(
+      static_cast<const unsigned char *>(view),
+      [length](const unsigned char *data) {
+        munmap(const_cast<unsigned char *>(data), length);
+      });
+#endif
+}
+
+} // namespace
+
+pack_index::pack_index(const std::string &path)
+    : path_(path), data_size_(0), size_(0) {
+  data_ = map_file(path, data_size_);
+  const auto data = data_.get();
+
+  // Magic, version, fanout, ids, CRCs, offsets, large offsets,
+  // pack checksum, index checksum
+  if (data_size_ < header_size + 2 * GIT_OID_RAWSZ ||
+      std::memcmp(data, "\377tOc", 4) || read_be32(data + 4) != 2)
+    throw git_exception("unsupported pack index file");
+
+  // Lookups use the fanout entries as bounds into the ids
+  uint32_t previous = 0;
+  for (size_t i = 0; i < 256; ++i) {
+    const auto count = read_be32(data + 8 + i * 4);
+    if (count < previous)
+      throw git_exception("invalid pack index file");
+    previous = count;
+  }
+  size_ = previous;
+  const uint64_t large_offsets_offset =
+      header_size + static_cast<uint64_t>(size_) * (GIT_OID_RAWSZ + 4 + 4);
+  if (data_size_ < large_offsets_offset + 2 * GIT_OID_RAWSZ)
+    throw git_exception("invalid pack index file");
+}
+
+std::vector<std::string> pack_index::paths(const repository &repo) {
+  std::string objects_dir(git_repository_commondir(repo.c_ptr()));
+  if (!objects_dir.empty() && objects_dir.back() != '/')
+    objects_dir += '/';
+  return paths(objects_dir + "objects/pack");
+}
+
+std::vector<std::string> pack_index::paths(const std::string &directory) {
+  auto pack_dir = directory;
+  if (!pack_dir.empty() && pack_dir.back() != '/')
+    pack_dir += '/';
+
+  std::vector<std::string> result;
+#ifdef _WIN32
+  WIN32_FIND_DATAA found;
+  auto handle = FindFirstFileA((pack_dir + "pack-*.idx").c_str(), &found);
+  if (handle != INVALID_HANDLE_VALUE) {
+    do {
+      result.push_back(pack_dir + found.cFileName);
+    } while (FindNextFileA(handle, &found));
+    FindClose(handle);
+  }
+#else
+  if (auto dir = opendir(pack_dir.c_str())) {
+    while (auto item = readdir(dir)) {
+      std::string name(item->d_name);
+      if (name.compare(0, 5, "pack-") == 0 && ends_with(name, ".idx"))
+        result.push_back(pack_dir + name);
+    }
+    closedir(dir);
+  }
+#endif
+  std::sort(result.begin(), result.end());
+  return result;
+}
+
+const std::string &pack_index::path() const { return path_; }
+
+size_t pack_index::size() const { return size_; }
+
+oid pack_index::id(size_t n) const {
+  if (n >= size_)
+    throw git_exception("pack index position out of range");
+  return oid(data_.get() + header_size + n * GIT_OID_RAWSZ);
+}
+
+uint64_t pack_index::offset(size_t n) const {
+  if (n >= size_)
+    throw git_exception("pack index position out of range");
+  const auto data = data_.get();
+  const auto offsets_offset = header_size + size_ * (GIT_OID_RAWSZ + 4);
+  uint64_t value = read_be32(data + offsets_offset + n * 4);
+
+  // Offsets with the MSB set index into the table of 8-byte offsets
+  if (value & 0x80000000u) {
+    const auto large = offsets_offset + size_ * 4 + (value & 0x7FFFFFFFu) * 8;
+    if (large + 8 > data_size_ - 2 * GIT_OID_RAWSZ)
+      throw git_exception("invalid pack index file");
+    value = read_be64(data + large);
+  }
+  return value;
+}
+
+bool pack_index::find(const oid &id, size_t &n) const {
+  // Fanout table narrows the range, then binary search the sorted ids
+  const auto raw = id.c_ptr()->id;
+  const auto fanout = data_.get() + 8;
+  size_t low = raw[0] ? read_be32(fanout + (raw[0] - 1) * 4) : 0;
+  size_t high = read_be32(fanout + raw[0] * 4);
+  const auto ids = data_.get() + header_size;
+  while (low < high) {
+    const auto middle = low + (high - low) / 2;
+    const auto cmp =
+        std::memcmp(ids + middle * GIT_OID_RAWSZ, raw, GIT_OID_RAWSZ);
+    if (cmp == 0) {
+      n = middle;
+      return true;
+    }
+    if (cmp < 0)
+      low = middle + 1;
+    else
+      high = middle;
+  }
+  return false;
+}
+
+oid pack_index::pack_checksum() const {
+  return oid(data_.get() + data_size_ - 2 * GIT_OID_RAWSZ);
+}
+
+} // namespace cppgit2
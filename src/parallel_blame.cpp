@@ -0,0 +1,530 @@
+#include <algorithm>
+#include <chrono>
+#include <cppgit2/parallel_blame.hpp>
+#include <cppgit2/repository.hpp>
+#include <cstring>
+#include <queue>
+#include <unordered_map>
+#include <utility>
+
+#include "worker_pool.hpp"
+
+namespace cppgit2 {
+
+namespace {
+
+typedef std::unique_ptr<git_commit, void (*)(git_commit *)> owned_commit;
+typedef std::unique_ptr<git_tree, void (*)(git_tree *)> owned_tree;
+typedef std::unique_ptr<git_blob, void (*)(git_blob *)> owned_blob;
+typedef std::unique_ptr<git_diff, void (*)(git_diff *)> owned_diff;
+
+owned_commit lookup_commit(git_repository *repo, const git_oid *id) {
+  git_commit *commit_c;
+  if (git_commit_lookup(&commit_c, repo, id))
+    throw git_exception();
+  return owned_commit(commit_c, git_commit_free);
+}
+
+owned_tree commit_tree(const git_commit *commit_c) {
+  git_tree *tree_c;
+  if (git_commit_tree(&tree_c, commit_c))
+    throw git_exception();
+  return owned_tree(tree_c, git_tree_free);
+}
+
+owned_blob lookup_blob(git_repository *repo, const git_oid *id) {
+  git_blob *blob_c;
+  if (git_blob_lookup(&blob_c, repo, id))
+    throw git_exception();
+  return owned_blob(blob_c, git_blob_free);
+}
+
+// Lines of a blamed file, as found in a suspected blob (0-based)
+struct entry {
+  size_t line;
+  size_t count;
+  size_t orig_line;
+};
+
+// Lines of blamed file `file` suspected on `path` in some commit
+struct suspect {
+  size_t file;
+  std::string path;
+  git_oid blob;
+  std::vector<entry> entries;
+};
+
+// Suspects of a commit waiting to be passed on, by file and path
+struct commit_work {
+  git_time_t time;
+  std::map<std::pair<size_t, std::string>, suspect> suspects;
+};
+
+// Lines attributed to a commit
+struct guilty_lines {
+  entry lines;
+  oid commit_id;
+  std::string path;
+  bool boundary;
+  bool resolved;
+};
+
+// Where a suspect's lines may come from, in one parent
+struct candidate {
+  size_t parent;
+  std::string path;
+  git_oid blob;
+};
+
+// Lines of a suspect passed on to the candidates, and the ones left
+struct pass_result {
+  std::vector<std::vector<entry>> passed; // by candidate
+  std::vector<entry> left;
+};
+
+// Diff of a commit with one of its parents, loaded when first needed
+struct parent_diff {
+  parent_diff()
+      : commit(nullptr, git_commit_free), diff(nullptr, git_diff_free),
+        renames(false) {}
+
+  owned_commit commit;
+  owned_diff diff;
+  bool renames;
+  // Deltas by new path
+  std::unordered_map<std::string, const git_diff_delta *> changes;
+};
+
+size_t count_lines(const git_blob *blob_c) {
+  const auto data = static_cast<const char *>(git_blob_rawcontent(blob_c));
+  const auto size = static_cast<size_t>(git_blob_rawsize(blob_c));
+  const size_t lines = std::count(data, data + size, '\n');
+  return size && data[size - 1] != '\n' ? lines + 1 : lines;
+}
+
+// Pass the lines of `from` that `candidates` also have
+pass_result pass_lines(git_repository *repo, const suspect &from,
+                       const std::vector<candidate> &candidates) {
+  // Unchanged ranges of a blob diff: lines [new_begin, new_end) are found
+  // from `old_begin` on in the parent; the last range has no end
+  struct unchanged {
+    size_t new_begin;
+    size_t new_end;
+    size_t old_begin;
+  };
+
+  const auto blob = lookup_blob(repo, &from.blob);
+  git_diff_options options;
+  git_diff_init_options(&options, GIT_DIFF_OPTIONS_VERSION);
+  options.context_lines = 0;
+
+  pass_result result;
+  result.left = from.entries;
+  for (const auto &parent : candidates) {
+    const auto parent_blob = lookup_blob(repo, &parent.blob);
+    std::vector<unchanged> ranges;
+    unchanged next{0, 0, 0};
+    auto payload = std::make_pair(&ranges, &next);
+    if (git_diff_blobs(
+            parent_blob.get(), parent.path.c_str(), blob.get(),
+            from.path.c_str(), &options, nullptr, nullptr,
+            [](const git_diff_delta *, const git_diff_hunk *hunk_c,
+               void *payload) -> int {
+              auto state = static_cast<
+                  std::pair<std::vector<unchanged> *, unchanged *> *>(payload);
+              // A hunk without lines on one side starts after that line
+              const size_t old_begin = hunk_c->old_lines
+                                           ? hunk_c->old_start - 1
+                                           : hunk_c->old_start;
+              const size_t new_begin = hunk_c->new_lines
+                                           ? hunk_c->new_start - 1
+                                           : hunk_c->new_start;
+              auto &range = *state->second;
+              range.new_end = new_begin;
+              if (range.new_end > range.new_begin)
+                state->first->push_back(range);
+              range.new_begin = new_begin + hunk_c->new_lines;
+              range.old_begin = old_begin + hunk_c->old_lines;
+              return 0;
+            },
+            nullptr, &payload))
+      throw git_exception();
+    next.new_end = static_cast<size_t>(-1);
+    ranges.push_back(next);
+
+    std::vector<entry> passed, left;
+    for (const auto &lines : result.left) {
+      size_t begin = lines.orig_line;
+      const size_t end = lines.orig_line + lines.count;
+      auto piece = [&](size_t piece_end, size_t orig_line,
+                       std::vector<entry> &to) {
+        to.push_back({lines.line + (begin - lines.orig_line),
+                      piece_end - begin, orig_line});
+        begin = piece_end;
+      };
+      auto range = std::upper_bound(
+          ranges.begin(), ranges.end(), begin,
+          [](size_t line, const unchanged &range) -> bool {
+            return line < range.new_end;
+          });
+      for (; begin < end && range != ranges.end(); ++range) {
+        if (begin < range->new_begin)
+          piece(std::min(end, range->new_begin), begin, left);
+        if (begin < end)
+          piece(std::min(end, range->new_end),
+                range->old_begin + (begin - range->new_begin), passed);
+      }
+      if (begin < end)
+        piece(end, begin, left);
+    }
+    result.passed.push_back(std::move(passed));
+    result.left = std::move(left);
+  }
+  return result;
+}
+
+} // namespace
+
+std::vector<std::string> parallel_blame::result::paths() const {
+  std::vector<std::string> result;
+  for (const auto &file : files_)
+    result.push_back(file.first);
+  return result;
+}
+
+const std::vector<blame::hunk> &
+parallel_blame::result::hunks(const std::string &path) const {
+  auto found = files_.find(path);
+  if (found == files_.end())
+    throw git_exception("path was not blamed");
+  return found->second;
+}
+
+bool parallel_blame::result::is_complete() const {
+  for (const auto &file : unresolved_)
+    if (!file.second.empty())
+      return false;
+  return true;
+}
+
+const std::vector<std::pair<size_t, size_t>> &
+parallel_blame::result::unresolved_lines(const std::string &path) const {
+  auto found = unresolved_.find(path);
+  if (found == unresolved_.end())
+    throw git_exception("path was not blamed");
+  return found->second;
+}
+
+parallel_blame::parallel_blame(const repository &repo, size_t thread_count)
+    : path_(repo.path()),
+      handles_(detail::open_worker_handles(path_, thread_count)) {}
+
+parallel_blame::~parallel_blame() {}
+
+size_t parallel_blame::thread_count() const { return handles_.size(); }
+
+parallel_blame::result
+parallel_blame::blame_files(const std::vector<std::string> &paths,
+                            blame::options options, limits bounds) {
+  const auto start = std::chrono::steady_clock::now();
+  git_repository *repo = handles_[0]->c_ptr_;
+  const git_blame_options &settings = *options.c_ptr();
+  const bool first_parent = (settings.flags & GIT_BLAME_FIRST_PARENT) != 0;
+  const bool use_mailmap = (settings.flags & GIT_BLAME_USE_MAILMAP) != 0;
+  git_oid newest = settings.newest_commit;
+  if (git_oid_iszero(&newest) &&
+      git_reference_name_to_id(&newest, repo, "HEAD"))
+    throw git_exception();
+
+  detail::task_pool pool(thread_count());
+  std::map<oid, commit_work> work;
+  std::priority_queue<std::pair<git_time_t, oid>> queue;
+  auto suspects_of = [&](const git_commit *commit_c) -> commit_work & {
+    const oid id(git_commit_id(commit_c));
+    auto found = work.find(id);
+    if (found != work.end())
+      return found->second;
+    auto &pending = work[id];
+    pending.time = git_commit_time(commit_c);
+    queue.emplace(pending.time, id);
+    return pending;
+  };
+
+  // The whole files (or the requested lines) are suspected on the newest
+  // commit
+  {
+    const auto commit = lookup_commit(repo, &newest);
+    std::vector<suspect> files(paths.size());
+    pool.run(paths.size(), [&](size_t worker, size_t i) {
+      git_repository *worker_repo = handles_[worker]->c_ptr_;
+      const auto tree = commit_tree(lookup_commit(worker_repo, &newest).get());
+      git_tree_entry *entry_c;
+      if (git_tree_entry_bypath(&entry_c, tree.get(), paths[i].c_str()))
+        throw git_exception();
+      const bool is_blob = git_tree_entry_type(entry_c) == GIT_OBJECT_BLOB;
+      git_oid_cpy(&files[i].blob, git_tree_entry_id(entry_c));
+      git_tree_entry_free(entry_c);
+      if (!is_blob)
+        throw git_exception("path is not a file in the newest commit");
+
+      const size_t lines =
+          count_lines(lookup_blob(worker_repo, &files[i].blob).get());
+      const size_t min_line = std::max<size_t>(settings.min_line, 1) - 1;
+      const size_t max_line = settings.max_line
+                                  ? std::min(settings.max_line, lines)
+                                  : lines;
+      files[i].file = i;
+      files[i].path = paths[i];
+      if (min_line < max_line)
+        files[i].entries.push_back({min_line, max_line - min_line, min_line});
+    });
+    auto &pending = suspects_of(commit.get());
+    for (auto &file : files)
+      if (!file.entries.empty())
+        pending.suspects[std::make_pair(file.file, file.path)] =
+            std::move(file);
+  }
+
+  std::vector<std::vector<guilty_lines>> blamed(paths.size());
+  auto blame_on = [&](const suspect &lines, const oid &commit_id,
+                      bool boundary, const std::vector<entry> &entries,
+                      bool resolved) {
+    for (const auto &range : entries)
+      blamed[lines.file].push_back(
+          {range, commit_id, lines.path, boundary, resolved});
+  };
+  auto pass_on = [&](const suspect &lines, const git_commit *parent_c,
+                     const std::string &path, const git_oid &blob,
+                     std::vector<entry> entries) {
+    if (entries.empty())
+      return;
+    auto &to = suspects_of(parent_c)
+                   .suspects[std::make_pair(lines.file, path)];
+    if (to.entries.empty()) {
+      to.file = lines.file;
+      to.path = path;
+      to.blob = blob;
+    }
+    to.entries.insert(to.entries.end(), entries.begin(), entries.end());
+  };
+
+  // Newest commits first; each one passes what its parents have to them
+  size_t visited = 0;
+  auto within_bounds = [&]() -> bool {
+    if (bounds.max_commits && visited >= bounds.max_commits)
+      return false;
+    return bounds.time_limit == std::chrono::steady_clock::duration::zero() ||
+           std::chrono::steady_clock::now() - start < bounds.time_limit;
+  };
+  while (!queue.empty() && within_bounds()) {
+    const oid commit_id = queue.top().second;
+    queue.pop();
+    auto found = work.find(commit_id);
+    if (found == work.end())
+      continue;
+    const commit_work pending = std::move(found->second);
+    work.erase(found);
+    ++visited;
+
+    const auto commit = lookup_commit(repo, commit_id.c_ptr());
+    size_t parents = git_commit_parentcount(commit.get());
+    if (commit_id == oid(&settings.oldest_commit))
+      parents = 0;
+    else if (first_parent && parents > 1)
+      parents = 1;
+    if (parents == 0) {
+      for (const auto &item : pending.suspects)
+        blame_on(item.second, commit_id, true, item.second.entries, true);
+      continue;
+    }
+
+    owned_tree tree(nullptr, git_tree_free);
+    std::vector<parent_diff> diffs(parents);
+    auto diff_with = [&](size_t i) -> parent_diff & {
+      auto &parent = diffs[i];
+      if (parent.commit)
+        return parent;
+      git_commit *parent_c;
+      if (git_commit_parent(&parent_c, commit.get(), i))
+        throw git_exception();
+      parent.commit.reset(parent_c);
+      if (!tree)
+        tree = commit_tree(commit.get());
+      git_diff_options diff_options;
+      git_diff_init_options(&diff_options, GIT_DIFF_OPTIONS_VERSION);
+      diff_options.flags = GIT_DIFF_SKIP_BINARY_CHECK;
+      git_diff *diff_c;
+      if (git_diff_tree_to_tree(&diff_c, repo,
+                                commit_tree(parent_c).get(), tree.get(),
+                                &diff_options))
+        throw git_exception();
+      parent.diff.reset(diff_c);
+      for (size_t j = 0; j < git_diff_num_deltas(diff_c); ++j) {
+        const auto delta = git_diff_get_delta(diff_c, j);
+        parent.changes[delta->new_file.path] = delta;
+      }
+      return parent;
+    };
+    // Renames are looked for once per parent, when a suspect is new
+    auto find_renames = [&](parent_diff &parent) {
+      if (parent.renames)
+        return;
+      git_diff_find_options find_options;
+      git_diff_find_init_options(&find_options, GIT_DIFF_FIND_OPTIONS_VERSION);
+      find_options.flags = GIT_DIFF_FIND_RENAMES;
+      if (git_diff_find_similar(parent.diff.get(), &find_options))
+        throw git_exception();
+      parent.renames = true;
+      parent.changes.clear();
+      for (size_t j = 0; j < git_diff_num_deltas(parent.diff.get()); ++j) {
+        const auto delta = git_diff_get_delta(parent.diff.get(), j);
+        parent.changes[delta->new_file.path] = delta;
+      }
+    };
+
+    // Suspects unchanged in a parent are passed to it as a whole; the
+    // others have their blobs diffed by the workers
+    std::vector<const suspect *> changed;
+    std::vector<std::vector<candidate>> candidates;
+    for (const auto &item : pending.suspects) {
+      const auto &lines = item.second;
+      std::vector<candidate> sources;
+      bool passed = false;
+      for (size_t i = 0; i < parents && !passed; ++i) {
+        auto &parent = diff_with(i);
+        auto change = parent.changes.find(lines.path);
+        if (change != parent.changes.end() &&
+            change->second->status == GIT_DELTA_ADDED) {
+          find_renames(parent);
+          change = parent.changes.find(lines.path);
+        }
+        candidate source{i, lines.path, lines.blob};
+        if (change != parent.changes.end()) {
+          const auto delta = change->second;
+          if (delta->status != GIT_DELTA_MODIFIED &&
+              delta->status != GIT_DELTA_RENAMED)
+            continue;
+          source.path = delta->old_file.path;
+          source.blob = delta->old_file.id;
+        }
+        if (git_oid_equal(&source.blob, &lines.blob)) {
+          pass_on(lines, parent.commit.get(), source.path, source.blob,
+                  lines.entries);
+          passed = true;
+        } else if (std::none_of(sources.begin(), sources.end(),
+                                [&](const candidate &other) -> bool {
+                                  return git_oid_equal(&other.blob,
+                                                       &source.blob);
+                                })) {
+          sources.push_back(std::move(source));
+        }
+      }
+      if (passed)
+        continue;
+      if (sources.empty()) {
+        blame_on(lines, commit_id, false, lines.entries, true);
+        continue;
+      }
+      changed.push_back(&lines);
+      candidates.push_back(std::move(sources));
+    }
+
+    std::vector<pass_result> results(changed.size());
+    auto pass = [&](size_t worker, size_t i) {
+      results[i] = pass_lines(handles_[worker]->c_ptr_, *changed[i],
+                              candidates[i]);
+    };
+    if (changed.size() == 1)
+      pass(0, 0);
+    else if (changed.size() > 1)
+      pool.run(changed.size(), pass);
+
+    for (size_t i = 0; i < changed.size(); ++i) {
+      for (size_t j = 0; j < candidates[i].size(); ++j) {
+        const auto &source = candidates[i][j];
+        pass_on(*changed[i], diffs[source.parent].commit.get(), source.path,
+                source.blob, std::move(results[i].passed[j]));
+      }
+      blame_on(*changed[i], commit_id, false, results[i].left, true);
+    }
+  }
+
+  // Out of bounds: lines are left on the commits they are suspected on
+  for (const auto &pending : work)
+    for (const auto &item : pending.second.suspects)
+      blame_on(item.second, pending.first, false, item.second.entries, false);
+
+  // Hunks: runs of lines from the same place in the same commit
+  // Hunks are only ever added to the deque, so their addresses are stable.
+  result blame;
+  git_mailmap *mailmap_c = nullptr;
+  if (use_mailmap && git_mailmap_from_repository(&mailmap_c, repo))
+    throw git_exception();
+  std::unique_ptr<git_mailmap, void (*)(git_mailmap *)> mailmap(
+      mailmap_c, git_mailmap_free);
+  std::map<oid, git_signature *> authors;
+  auto author = [&](const oid &commit_id) -> git_signature * {
+    auto found = authors.find(commit_id);
+    if (found != authors.end())
+      return found->second;
+    const auto commit = lookup_commit(repo, commit_id.c_ptr());
+    git_signature *signature_c;
+    if (git_commit_author_with_mailmap(&signature_c, commit.get(),
+                                       mailmap.get()))
+      throw git_exception();
+    blame.signatures_.emplace_back(signature_c, git_signature_free);
+    return authors[commit_id] = signature_c;
+  };
+
+  for (size_t i = 0; i < paths.size(); ++i) {
+    auto &lines = blamed[i];
+    std::sort(lines.begin(), lines.end(),
+              [](const guilty_lines &lhs, const guilty_lines &rhs) -> bool {
+                return lhs.lines.line < rhs.lines.line;
+              });
+    auto file = blame.files_.insert(
+        std::make_pair(paths[i], std::vector<blame::hunk>()));
+    if (!file.second)
+      continue; // the same path twice
+    auto &unresolved = blame.unresolved_[paths[i]];
+    git_blame_hunk *last = nullptr;
+    bool last_resolved = true;
+    for (const auto &range : lines) {
+      if (!range.resolved) {
+        if (!unresolved.empty() &&
+            unresolved.back().first + unresolved.back().second ==
+                range.lines.line + 1)
+          unresolved.back().second += range.lines.count;
+        else
+          unresolved.emplace_back(range.lines.line + 1, range.lines.count);
+      }
+      if (last && last_resolved == range.resolved &&
+          oid(&last->final_commit_id) == range.commit_id &&
+          last->orig_path == range.path &&
+          last->final_start_line_number + last->lines_in_hunk ==
+              range.lines.line + 1 &&
+          last->orig_start_line_number + last->lines_in_hunk ==
+              range.lines.orig_line + 1) {
+        last->lines_in_hunk += range.lines.count;
+        continue;
+      }
+      blame.hunks_.emplace_back();
+      last = &blame.hunks_.back();
+      std::memset(last, 0, sizeof(*last));
+      last->lines_in_hunk = range.lines.count;
+      git_oid_cpy(&last->final_commit_id, range.commit_id.c_ptr());
+      last->final_start_line_number = range.lines.line + 1;
+      last->final_signature = author(range.commit_id);
+      git_oid_cpy(&last->orig_commit_id, range.commit_id.c_ptr());
+      last->orig_path = blame.orig_paths_.insert(range.path).first->c_str();
+      last->orig_start_line_number = range.lines.orig_line + 1;
+      last->orig_signature = last->final_signature;
+      last->boundary = range.boundary ? 1 : 0;
+      last_resolved = range.resolved;
+      file.first->second.emplace_back(last);
+    }
+  }
+  return blame;
+}
+
+} // namespace cppgit2
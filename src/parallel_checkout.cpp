@@ -0,0 +1,542 @@
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <condition_variable>
+#include <cppgit2/parallel_checkout.hpp>
+#include <cppgit2/repository.hpp>
+#include <cstring>
+#include <exception>
+#include <mutex>
+#include <set>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "worker_pool.hpp"
+
+namespace cppgit2 {
+
+namespace {
+
+#ifndef _WIN32
+
+// Bytes of blob content held by the workers
+class memory_budget {
+public:
+  explicit memory_budget(size_t limit) : limit_(limit), used_(0) {}
+
+  // Waits until `bytes` fit in the budget, or nothing else is held
+  void acquire(size_t bytes) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    released_.wait(lock, [&]() -> bool {
+      return used_ == 0 || used_ + bytes <= limit_;
+    });
+    used_ += bytes;
+  }
+
+  void release(size_t bytes) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      used_ -= bytes;
+    }
+    released_.notify_all();
+  }
+
+  // Counts `bytes` that are already held, without waiting
+  void add(size_t bytes) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    used_ += bytes;
+  }
+
+private:
+  size_t limit_;
+  size_t used_;
+  std::mutex mutex_;
+  std::condition_variable released_;
+};
+
+class budget_guard {
+public:
+  budget_guard(memory_budget &budget, size_t bytes)
+      : budget_(budget), bytes_(bytes) {
+    budget_.acquire(bytes_);
+  }
+  ~budget_guard() { budget_.release(bytes_); }
+
+  // Memory allocated, or freed, while the guard is held
+  void grow(size_t bytes) {
+    budget_.add(bytes);
+    bytes_ += bytes;
+  }
+  void shrink(size_t bytes) {
+    budget_.release(bytes);
+    bytes_ -= bytes;
+  }
+
+private:
+  memory_budget &budget_;
+  size_t bytes_;
+};
+
+struct target_file {
+  std::string path;
+  git_oid id;
+  uint32_t mode;
+};
+
+struct written_file {
+  const target_file *file;
+  struct stat st;
+};
+
+void write_all(int fd, const char *data, size_t size) {
+  while (size > 0) {
+    const auto written = write(fd, data, size);
+    if (written < 0) {
+      if (errno == EINTR)
+        continue;
+      throw git_exception("failed to write file");
+    }
+    data += written;
+    size -= static_cast<size_t>(written);
+  }
+}
+
+// Errors meaning that something is already in the way of the new file
+bool is_blocked(int error) {
+  return error == EEXIST || error == ENOTDIR || error == EISDIR ||
+         error == ENOENT;
+}
+
+#endif
+
+} // namespace
+
+parallel_checkout::parallel_checkout(const repository &repo,
+                                     size_t thread_count)
+    : path_(repo.path()),
+      handles_(detail::open_worker_handles(path_, thread_count)),
+      memory_limit_(64 * 1024 * 1024) {}
+
+parallel_checkout::~parallel_checkout() {}
+
+size_t parallel_checkout::thread_count() const { return handles_.size(); }
+
+size_t parallel_checkout::memory_limit() const { return memory_limit_; }
+
+void parallel_checkout::set_memory_limit(size_t bytes) {
+  memory_limit_ = bytes;
+}
+
+void parallel_checkout::checkout_head(const checkout::options &options) {
+  git_object *head_tree;
+  if (git_revparse_single(&head_tree, handles_.front()->c_ptr_,
+                          "HEAD^{tree}"))
+    throw git_exception();
+  object tree_object(head_tree, ownership::user);
+  checkout_tree(tree_object, options);
+}
+
+void parallel_checkout::checkout_tree(const object &treeish,
+                                      const checkout::options &options) {
+  git_repository *repo = handles_.front()->c_ptr_;
+  const git_checkout_options *opts = options.c_ptr();
+  const unsigned int strategy = opts->checkout_strategy;
+  const unsigned int supported =
+      GIT_CHECKOUT_SAFE | GIT_CHECKOUT_FORCE | GIT_CHECKOUT_RECREATE_MISSING |
+      GIT_CHECKOUT_DONT_UPDATE_INDEX | GIT_CHECKOUT_DONT_WRITE_INDEX |
+      GIT_CHECKOUT_DISABLE_PATHSPEC_MATCH;
+
+#ifndef _WIN32
+  const bool parallel = !git_repository_is_bare(repo) &&
+                        (strategy & (GIT_CHECKOUT_SAFE | GIT_CHECKOUT_FORCE)) &&
+                        (strategy & ~supported) == 0 && !opts->baseline_index &&
+                        !opts->notify_cb;
+#else
+  const bool parallel = false;
+#endif
+  if (!parallel) {
+    if (git_checkout_tree(git_object_owner(treeish.c_ptr()), treeish.c_ptr(),
+                          opts))
+      throw git_exception();
+    return;
+  }
+
+#ifndef _WIN32
+  const bool force = (strategy & GIT_CHECKOUT_FORCE) != 0;
+  const std::string workdir =
+      opts->target_directory ? std::string(opts->target_directory) + "/"
+                             : std::string(git_repository_workdir(repo));
+
+  // The target is looked up again in our own handle, libgit2 refuses
+  // objects of other repositories
+  git_object *target_c;
+  {
+    git_object *peeled;
+    if (git_object_peel(&peeled, treeish.c_ptr(), GIT_OBJECT_TREE))
+      throw git_exception();
+    object peeled_owner(peeled, ownership::user);
+    if (git_object_lookup(&target_c, repo, git_object_id(peeled),
+                          GIT_OBJECT_TREE))
+      throw git_exception();
+  }
+  object target(target_c, ownership::user);
+
+  // Baseline to target: new files are written here, the rest (removals,
+  // updates of existing files) is left to libgit2
+  std::vector<target_file> files;
+  std::vector<std::string> remaining;
+  {
+    git_tree *baseline = opts->baseline;
+    git_object *head_tree = nullptr;
+    if (!baseline) {
+      const auto ret = git_revparse_single(&head_tree, repo, "HEAD^{tree}");
+      if (ret == GIT_ENOTFOUND || ret == GIT_EUNBORNBRANCH)
+        git_exception::clear();
+      else if (ret)
+        throw git_exception();
+      baseline = reinterpret_cast<git_tree *>(head_tree);
+    }
+    object baseline_owner(head_tree, ownership::user);
+
+    git_diff_options diff_options;
+    if (git_diff_init_options(&diff_options, GIT_DIFF_OPTIONS_VERSION))
+      throw git_exception();
+    diff_options.pathspec = opts->paths;
+    if (strategy & GIT_CHECKOUT_DISABLE_PATHSPEC_MATCH)
+      diff_options.flags |= GIT_DIFF_DISABLE_PATHSPEC_MATCH;
+
+    auto for_each_delta =
+        [&](git_tree *old_tree,
+            std::function<void(const git_diff_delta *)> visitor) {
+          git_diff *diff;
+          if (git_diff_tree_to_tree(&diff, repo, old_tree,
+                                    reinterpret_cast<git_tree *>(target_c),
+                                    &diff_options))
+            throw git_exception();
+          try {
+            for (size_t i = 0; i < git_diff_num_deltas(diff); ++i)
+              visitor(git_diff_get_delta(diff, i));
+          } catch (...) {
+            git_diff_free(diff);
+            throw;
+          }
+          git_diff_free(diff);
+        };
+
+    std::set<std::string> changed;
+    for_each_delta(baseline, [&](const git_diff_delta *delta) {
+      if (delta->status == GIT_DELTA_ADDED ||
+          (force && delta->status == GIT_DELTA_MODIFIED))
+        files.push_back(
+            {delta->new_file.path, delta->new_file.id, delta->new_file.mode});
+      else
+        remaining.push_back(delta->status == GIT_DELTA_DELETED
+                                ? delta->old_file.path
+                                : delta->new_file.path);
+      changed.insert(delta->new_file.path);
+    });
+
+    // Unchanged files are written too if they are missing
+    if (strategy & (GIT_CHECKOUT_FORCE | GIT_CHECKOUT_RECREATE_MISSING))
+      for_each_delta(nullptr, [&](const git_diff_delta *delta) {
+        if (!changed.count(delta->new_file.path))
+          files.push_back({delta->new_file.path, delta->new_file.id,
+                           delta->new_file.mode});
+      });
+  }
+
+  bool symlinks = true;
+  {
+    git_config *config_c;
+    if (git_repository_config_snapshot(&config_c, repo))
+      throw git_exception();
+    int value;
+    if (git_config_get_bool(&value, config_c, "core.symlinks") == 0)
+      symlinks = value != 0;
+    git_exception::clear();
+    git_config_free(config_c);
+  }
+
+  // Directories first, parents before their contents
+  const mode_t dir_mode = opts->dir_mode ? opts->dir_mode : 0755;
+  std::vector<std::string> created_directories;
+  {
+    std::set<std::string> directories;
+    for (const auto &file : files)
+      for (auto pos = file.path.find('/'); pos != std::string::npos;
+           pos = file.path.find('/', pos + 1))
+        directories.insert(file.path.substr(0, pos));
+    for (const auto &directory : directories)
+      if (mkdir((workdir + directory).c_str(), dir_mode) == 0)
+        created_directories.push_back(directory);
+  }
+
+  // Attributes decide the filters of the other files, they are written
+  // before anything else
+  auto is_attributes = [](const std::string &path) -> bool {
+    const auto slash = path.rfind('/');
+    return path.compare(slash == std::string::npos ? 0 : slash + 1,
+                        std::string::npos, ".gitattributes") == 0;
+  };
+  std::stable_partition(
+      files.begin(), files.end(),
+      [&](const target_file &file) { return is_attributes(file.path); });
+
+  const auto workers = thread_count();
+  std::vector<std::vector<written_file>> written(workers);
+  std::vector<std::vector<std::string>> blocked(workers);
+  memory_budget budget(memory_limit_);
+  std::mutex progress_mutex;
+  size_t completed = 0;
+
+  auto write_file = [&](size_t worker, const target_file &file) {
+    git_repository *worker_repo = handles_[worker]->c_ptr_;
+    const auto full_path = workdir + file.path;
+    written_file result{&file, {}};
+
+    if (file.mode == GIT_FILEMODE_COMMIT) {
+      // Submodules are left as empty directories, as libgit2 does
+      if (mkdir(full_path.c_str(), dir_mode) != 0) {
+        blocked[worker].push_back(file.path);
+        return;
+      }
+      written[worker].push_back(result);
+      return;
+    }
+
+    // Something in the way is found before the blob is read
+    const bool is_symlink = file.mode == GIT_FILEMODE_LINK && symlinks;
+    int fd = -1;
+    if (is_symlink) {
+      struct stat st;
+      if (lstat(full_path.c_str(), &st) == 0) {
+        blocked[worker].push_back(file.path);
+        return;
+      }
+    } else {
+      const mode_t file_mode =
+          opts->file_mode ? opts->file_mode
+                          : (file.mode == GIT_FILEMODE_BLOB_EXECUTABLE ? 0755
+                                                                       : 0644);
+      fd = open(full_path.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC,
+                file_mode);
+      if (fd < 0) {
+        if (!is_blocked(errno))
+          throw git_exception("failed to create file");
+        blocked[worker].push_back(file.path);
+        return;
+      }
+    }
+
+    try {
+      // The size comes from the object header, so that the budget is
+      // reserved before the blob is inflated
+      git_odb *odb_c;
+      if (git_repository_odb(&odb_c, worker_repo))
+        throw git_exception();
+      std::unique_ptr<git_odb, void (*)(git_odb *)> odb_owner(odb_c,
+                                                              git_odb_free);
+      size_t size;
+      git_object_t type;
+      if (git_odb_read_header(&size, &type, odb_c, &file.id))
+        throw git_exception();
+      budget_guard guard(budget, size);
+
+      git_blob *blob_c;
+      if (git_blob_lookup(&blob_c, worker_repo, &file.id))
+        throw git_exception();
+      std::unique_ptr<git_blob, void (*)(git_blob *)> blob_owner(
+          blob_c, git_blob_free);
+
+      if (is_symlink) {
+        const std::string link_target(
+            static_cast<const char *>(git_blob_rawcontent(blob_c)), size);
+        if (symlink(link_target.c_str(), full_path.c_str()) != 0) {
+          if (!is_blocked(errno))
+            throw git_exception("failed to create symlink");
+          blocked[worker].push_back(file.path);
+          return;
+        }
+        lstat(full_path.c_str(), &result.st);
+        written[worker].push_back(result);
+        return;
+      }
+
+      if (opts->disable_filters) {
+        write_all(fd, static_cast<const char *>(git_blob_rawcontent(blob_c)),
+                  size);
+      } else {
+        git_buf buffer = {nullptr, 0, 0};
+        git_blob_filter_options filter_options =
+            GIT_BLOB_FILTER_OPTIONS_INIT;
+        if (git_blob_filter(&buffer, blob_c, file.path.c_str(),
+                            &filter_options))
+          throw git_exception();
+
+        // The filtered copy is held while it is written, the blob is not
+        guard.grow(buffer.asize);
+        blob_owner.reset();
+        guard.shrink(size);
+        try {
+          write_all(fd, buffer.ptr, buffer.size);
+        } catch (...) {
+          git_buf_dispose(&buffer);
+          throw;
+        }
+        git_buf_dispose(&buffer);
+      }
+      if (fstat(fd, &result.st) != 0)
+        throw git_exception("failed to stat file");
+    } catch (...) {
+      if (fd >= 0) {
+        close(fd);
+        unlink(full_path.c_str());
+      }
+      throw;
+    }
+    if (close(fd) != 0)
+      throw git_exception("failed to write file");
+    written[worker].push_back(result);
+  };
+
+  auto report = [&](const target_file &file) {
+    if (!opts->progress_cb)
+      return;
+    std::lock_guard<std::mutex> lock(progress_mutex);
+    opts->progress_cb(file.path.c_str(), ++completed, files.size(),
+                      opts->progress_payload);
+  };
+
+  // Undoes the writes if something fails on the way, so that a refused
+  // checkout leaves the working directory as it was
+  auto rollback = [&]() {
+    for (const auto &thread_written : written)
+      for (const auto &item : thread_written) {
+        const auto full_path = workdir + item.file->path;
+        if (item.file->mode == GIT_FILEMODE_COMMIT)
+          rmdir(full_path.c_str());
+        else
+          unlink(full_path.c_str());
+      }
+    for (auto it = created_directories.rbegin();
+         it != created_directories.rend(); ++it)
+      rmdir((workdir + *it).c_str());
+  };
+
+  // Paths left to libgit2, restricted to `paths`
+  auto checkout_paths = [&](std::vector<std::string> &paths) {
+    if (paths.empty())
+      return;
+    std::vector<char *> strings;
+    for (auto &path : paths)
+      strings.push_back(&path[0]);
+    git_checkout_options paths_options = *opts;
+    paths_options.paths.strings = strings.data();
+    paths_options.paths.count = strings.size();
+    paths_options.checkout_strategy |= GIT_CHECKOUT_DISABLE_PATHSPEC_MATCH;
+    if (git_checkout_tree(repo, target_c, &paths_options)) {
+      rollback();
+      throw git_exception();
+    }
+  };
+
+  size_t first = 0;
+  try {
+    for (; first < files.size() && is_attributes(files[first].path);
+         ++first) {
+      write_file(0, files[first]);
+      report(files[first]);
+    }
+  } catch (...) {
+    rollback();
+    throw;
+  }
+
+  // Attributes that exist already, or are removed, are checked out by
+  // libgit2 before any other file is filtered
+  {
+    std::vector<std::string> attributes;
+    auto take_attributes = [&](std::vector<std::string> &paths) {
+      auto end = std::stable_partition(
+          paths.begin(), paths.end(),
+          [&](const std::string &path) { return !is_attributes(path); });
+      attributes.insert(attributes.end(), end, paths.end());
+      paths.erase(end, paths.end());
+    };
+    take_attributes(blocked[0]);
+    take_attributes(remaining);
+    checkout_paths(attributes);
+  }
+
+  try {
+    std::atomic<bool> stop(false);
+    std::atomic<size_t> next(first);
+    detail::run_workers(workers, stop, [&](size_t worker) {
+      while (!stop) {
+        const auto i = next.fetch_add(1);
+        if (i >= files.size())
+          break;
+        write_file(worker, files[i]);
+        report(files[i]);
+      }
+    });
+  } catch (...) {
+    rollback();
+    throw;
+  }
+
+  // Everything else goes through libgit2's checks, e.g., a conflict
+  // refuses the whole checkout
+  for (const auto &thread_blocked : blocked)
+    remaining.insert(remaining.end(), thread_blocked.begin(),
+                     thread_blocked.end());
+  checkout_paths(remaining);
+
+  // Index entries of the written files
+  if (!(strategy & GIT_CHECKOUT_DONT_UPDATE_INDEX)) {
+    git_index *index_c;
+    if (git_repository_index(&index_c, repo))
+      throw git_exception();
+    cppgit2::index current_index(index_c, ownership::user);
+    if (git_index_read(index_c, false))
+      throw git_exception();
+    for (const auto &thread_written : written) {
+      for (const auto &item : thread_written) {
+        git_index_entry entry;
+        std::memset(&entry, 0, sizeof(entry));
+        const auto &st = item.st;
+        entry.ctime.seconds = static_cast<int32_t>(st.st_ctime);
+        entry.mtime.seconds = static_cast<int32_t>(st.st_mtime);
+#if defined(__APPLE__)
+        entry.ctime.nanoseconds =
+            static_cast<uint32_t>(st.st_ctimespec.tv_nsec);
+        entry.mtime.nanoseconds =
+            static_cast<uint32_t>(st.st_mtimespec.tv_nsec);
+#else
+        entry.ctime.nanoseconds = static_cast<uint32_t>(st.st_ctim.tv_nsec);
+        entry.mtime.nanoseconds = static_cast<uint32_t>(st.st_mtim.tv_nsec);
+#endif
+        entry.dev = static_cast<uint32_t>(st.st_dev);
+        entry.ino = static_cast<uint32_t>(st.st_ino);
+        entry.uid = static_cast<uint32_t>(st.st_uid);
+        entry.gid = static_cast<uint32_t>(st.st_gid);
+        entry.file_size = static_cast<uint32_t>(st.st_size);
+        entry.mode = item.file->mode;
+        entry.id = item.file->id;
+        entry.path = item.file->path.c_str();
+        if (git_index_add(index_c, &entry))
+          throw git_exception();
+      }
+    }
+    if (!(strategy & GIT_CHECKOUT_DONT_WRITE_INDEX) &&
+        git_index_write(index_c))
+      throw git_exception();
+  }
+#endif
+}
+
+} // namespace cppgit2
@@ -0,0 +1,223 @@
+#include <algorithm>
+#include <atomic>
+#include <cppgit2/parallel_diff.hpp>
+#include <cppgit2/repository.hpp>
+#include <cstring>
+#include <mutex>
+
+#include "worker_pool.hpp"
+
+namespace cppgit2 {
+
+namespace {
+
+// Pair of subtrees to compare; a missing side is an empty tree
+struct tree_pair {
+  std::string prefix;
+  git_oid old_id;
+  git_oid new_id;
+  bool has_old;
+  bool has_new;
+};
+
+struct change {
+  std::string path;
+  git_diff_delta delta;
+};
+
+class tree_handle {
+public:
+  tree_handle(git_repository *repo, const git_oid *id) : c_ptr_(nullptr) {
+    if (id && git_tree_lookup(&c_ptr_, repo, id))
+      throw git_exception();
+  }
+  ~tree_handle() {
+    if (c_ptr_)
+      git_tree_free(c_ptr_);
+  }
+
+  size_t size() const { return c_ptr_ ? git_tree_entrycount(c_ptr_) : 0; }
+  const git_tree_entry *operator[](size_t i) const {
+    return git_tree_entry_byindex(c_ptr_, i);
+  }
+
+private:
+  git_tree *c_ptr_;
+};
+
+bool is_tree(const git_tree_entry *entry) {
+  return git_tree_entry_filemode(entry) == GIT_FILEMODE_TREE;
+}
+
+// Tree order: names compare as if trees had a trailing slash
+int compare_entries(const git_tree_entry *lhs, const git_tree_entry *rhs) {
+  const char *lhs_name = git_tree_entry_name(lhs);
+  const char *rhs_name = git_tree_entry_name(rhs);
+  const size_t lhs_size = std::strlen(lhs_name);
+  const size_t rhs_size = std::strlen(rhs_name);
+  const size_t common = std::min(lhs_size, rhs_size);
+  const int cmp = std::memcmp(lhs_name, rhs_name, common);
+  if (cmp)
+    return cmp;
+  const unsigned char lhs_next =
+      lhs_size > common ? lhs_name[common] : (is_tree(lhs) ? '/' : '\0');
+  const unsigned char rhs_next =
+      rhs_size > common ? rhs_name[common] : (is_tree(rhs) ? '/' : '\0');
+  return static_cast<int>(lhs_next) - static_cast<int>(rhs_next);
+}
+
+void set_file(git_diff_file &file, const git_tree_entry *entry) {
+  std::memset(&file, 0, sizeof(file));
+  file.id_abbrev = GIT_OID_HEXSZ;
+  if (!entry)
+    return;
+  file.id = *git_tree_entry_id(entry);
+  file.mode = static_cast<uint16_t>(git_tree_entry_filemode(entry));
+  file.flags = GIT_DIFF_FLAG_VALID_ID | GIT_DIFF_FLAG_EXISTS;
+}
+
+} // namespace
+
+parallel_diff::parallel_diff(const repository &repo, size_t thread_count)
+    : path_(repo.path()),
+      handles_(detail::open_worker_handles(path_, thread_count)) {}
+
+parallel_diff::~parallel_diff() {}
+
+size_t parallel_diff::thread_count() const { return handles_.size(); }
+
+void parallel_diff::for_each(const tree &old_tree, const tree &new_tree,
+                             std::function<bool(const diff::delta &)> visitor,
+                             bool sorted) {
+  tree_pair root;
+  root.has_old = old_tree.c_ptr() != nullptr;
+  root.has_new = new_tree.c_ptr() != nullptr;
+  if (root.has_old)
+    root.old_id = *git_tree_id(old_tree.c_ptr());
+  if (root.has_new)
+    root.new_id = *git_tree_id(new_tree.c_ptr());
+  if (root.has_old == root.has_new &&
+      (!root.has_old || git_oid_equal(&root.old_id, &root.new_id)))
+    return;
+
+  std::atomic<bool> stop(false);
+  std::mutex emit_mutex;
+  std::vector<change> results;
+  auto emit = [&](const std::string &path, git_delta_t status,
+                  const git_tree_entry *old_entry,
+                  const git_tree_entry *new_entry) {
+    change result;
+    result.path = path;
+    std::memset(&result.delta, 0, sizeof(result.delta));
+    result.delta.status = status;
+    result.delta.nfiles = 2;
+    set_file(result.delta.old_file, old_entry);
+    set_file(result.delta.new_file, new_entry);
+
+    std::lock_guard<std::mutex> lock(emit_mutex);
+    if (sorted) {
+      results.push_back(std::move(result));
+      return;
+    }
+    if (stop)
+      return;
+    result.delta.old_file.path = result.path.c_str();
+    result.delta.new_file.path = result.path.c_str();
+    if (!visitor(diff::delta(&result.delta)))
+      stop = true;
+  };
+
+  detail::work_queue<tree_pair> pairs(stop);
+  pairs.push(root);
+  detail::run_workers(thread_count(), stop, [&](size_t worker) {
+    git_repository *worker_repo = handles_[worker]->c_ptr_;
+    // One side of a file change; a subtree on one side only is queued
+    auto emit_side = [&](const std::string &prefix, const git_tree_entry *entry,
+                         bool is_old) {
+      const std::string path = prefix + git_tree_entry_name(entry);
+      if (is_tree(entry)) {
+        tree_pair pair;
+        pair.prefix = path + "/";
+        pair.has_old = is_old;
+        pair.has_new = !is_old;
+        (is_old ? pair.old_id : pair.new_id) = *git_tree_entry_id(entry);
+        pairs.push(std::move(pair));
+      } else if (is_old) {
+        emit(path, GIT_DELTA_DELETED, entry, nullptr);
+      } else {
+        emit(path, GIT_DELTA_ADDED, nullptr, entry);
+      }
+    };
+
+    pairs.drain([&](const tree_pair &pair) {
+      const tree_handle old_entries(worker_repo,
+                                    pair.has_old ? &pair.old_id : nullptr);
+      const tree_handle new_entries(worker_repo,
+                                    pair.has_new ? &pair.new_id : nullptr);
+      size_t i = 0, j = 0;
+      while (i < old_entries.size() || j < new_entries.size()) {
+        if (j == new_entries.size()) {
+          emit_side(pair.prefix, old_entries[i++], true);
+          continue;
+        }
+        if (i == old_entries.size()) {
+          emit_side(pair.prefix, new_entries[j++], false);
+          continue;
+        }
+        const auto old_entry = old_entries[i];
+        const auto new_entry = new_entries[j];
+        const int cmp = compare_entries(old_entry, new_entry);
+        if (cmp < 0) {
+          emit_side(pair.prefix, old_entry, true);
+          ++i;
+          continue;
+        }
+        if (cmp > 0) {
+          emit_side(pair.prefix, new_entry, false);
+          ++j;
+          continue;
+        }
+        ++i;
+        ++j;
+
+        // Same name, and both trees or both non-trees
+        const auto old_mode = git_tree_entry_filemode(old_entry);
+        const auto new_mode = git_tree_entry_filemode(new_entry);
+        if (old_mode == new_mode && git_oid_equal(git_tree_entry_id(old_entry),
+                                                  git_tree_entry_id(new_entry)))
+          continue;
+        if (is_tree(old_entry)) {
+          tree_pair subtrees;
+          subtrees.prefix = pair.prefix + git_tree_entry_name(old_entry) + "/";
+          subtrees.old_id = *git_tree_entry_id(old_entry);
+          subtrees.new_id = *git_tree_entry_id(new_entry);
+          subtrees.has_old = subtrees.has_new = true;
+          pairs.push(std::move(subtrees));
+        } else if ((old_mode & 0170000) == (new_mode & 0170000)) {
+          emit(pair.prefix + git_tree_entry_name(new_entry),
+               GIT_DELTA_MODIFIED, old_entry, new_entry);
+        } else {
+          // Blob to symlink and the like, without typechange records
+          emit_side(pair.prefix, old_entry, true);
+          emit_side(pair.prefix, new_entry, false);
+        }
+      }
+    });
+  });
+
+  if (sorted) {
+    // Stable, so that a deletion stays before an addition of the same path
+    std::stable_sort(results.begin(), results.end(),
+                     [](const change &lhs, const change &rhs) -> bool {
+                       return lhs.path < rhs.path;
+                     });
+    for (auto &result : results) {
+      result.delta.old_file.path = result.path.c_str();
+      result.delta.new_file.path = result.path.c_str();
+      if (!visitor(diff::delta(&result.delta)))
+        break;
+    }
+  }
+}
+
+} // namespace cppgit2
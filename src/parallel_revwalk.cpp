@@ -0,0 +1,166 @@
+#include <algorithm>
+#include <atomic>
+#include <cppgit2/parallel_revwalk.hpp>
+#include <cppgit2/repository.hpp>
+#include <mutex>
+#include <unordered_set>
+
+#include "worker_pool.hpp"
+
+namespace cppgit2 {
+
+namespace {
+
+// Set of visited commits, split into independently locked shards
+class concurrent_oid_set {
+public:
+  concurrent_oid_set() : shards_(shard_count) {}
+
+  // Returns true if `id` was not in the set yet
+  bool insert(const oid &id) {
+    auto &shard = shards_[std::hash<oid>()(id) % shard_count];
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    return shard.ids.insert(id).second;
+  }
+
+private:
+  static const size_t shard_count = 64;
+
+  struct shard {
+    std::mutex mutex;
+    std::unordered_set<oid> ids;
+  };
+  std::vector<shard> shards_;
+};
+
+struct timed_oid {
+  git_time_t time;
+  oid id;
+};
+
+} // namespace
+
+parallel_revwalk::parallel_revwalk(const repository &repo,
+                                   size_t thread_count)
+    : path_(repo.path()),
+      handles_(detail::open_worker_handles(path_, thread_count)) {}
+
+parallel_revwalk::~parallel_revwalk() {}
+
+void parallel_revwalk::push(const oid &id) { roots_.push_back(id); }
+
+void parallel_revwalk::push_glob(const std::string &glob) {
+  const auto &repo = *handles_.front();
+  repo.for_each_reference_glob(glob, [&](const std::string &name) {
+    git_object *target;
+    if (git_revparse_single(&target, repo.c_ptr_,
+                            (name + "^{commit}").c_str()) == 0) {
+      roots_.push_back(oid(git_object_id(target)));
+      git_object_free(target);
+    } else {
+      git_exception::clear();
+    }
+  });
+}
+
+void parallel_revwalk::push_head() {
+  git_oid id_c;
+  if (git_reference_name_to_id(&id_c, handles_.front()->c_ptr_, "HEAD"))
+    throw git_exception();
+  roots_.push_back(oid(&id_c));
+}
+
+void parallel_revwalk::reset() { roots_.clear(); }
+
+size_t parallel_revwalk::thread_count() const { return handles_.size(); }
+
+void parallel_revwalk::for_each(std::function<bool(const oid &)> visitor) {
+  // Workers already waiting for the lock when the visitor stops the walk
+  // must not call it again
+  std::mutex visitor_mutex;
+  bool stopped = false;
+  walk([&](size_t, const oid &id, git_time_t) -> bool {
+    std::lock_guard<std::mutex> lock(visitor_mutex);
+    if (stopped)
+      return false;
+    try {
+      stopped = !visitor(id);
+    } catch (...) {
+      stopped = true;
+      throw;
+    }
+    return !stopped;
+  });
+}
+
+void parallel_revwalk::for_each_by_time(
+    std::function<bool(const oid &)> visitor) {
+  // Each worker records its own commits...
+  std::vector<std::vector<timed_oid>> results(thread_count());
+  walk([&](size_t worker, const oid &id, git_time_t time) -> bool {
+    results[worker].push_back({time, id});
+    return true;
+  });
+
+  // ...which are sorted per worker, then merged newest first
+  auto newer = [](const timed_oid &lhs, const timed_oid &rhs) -> bool {
+    return lhs.time > rhs.time;
+  };
+  for (auto &result : results)
+    std::sort(result.begin(), result.end(), newer);
+
+  typedef std::pair<size_t, size_t> cursor; // worker, index
+  auto older_cursor = [&](const cursor &lhs, const cursor &rhs) -> bool {
+    return newer(results[rhs.first][rhs.second],
+                 results[lhs.first][lhs.second]);
+  };
+  std::vector<cursor> heap;
+  for (size_t worker = 0; worker < results.size(); ++worker)
+    if (!results[worker].empty())
+      heap.push_back({worker, 0});
+  std::make_heap(heap.begin(), heap.end(), older_cursor);
+
+  while (!heap.empty()) {
+    std::pop_heap(heap.begin(), heap.end(), older_cursor);
+    auto next = heap.back();
+    heap.pop_back();
+    if (!visitor(results[next.first][next.second].id))
+      return;
+    if (++next.second < results[next.first].size()) {
+      heap.push_back(next);
+      std::push_heap(heap.begin(), heap.end(), older_cursor);
+    }
+  }
+}
+
+void parallel_revwalk::walk(
+    std::function<bool(size_t worker, const oid &id, git_time_t time)> visit) {
+  concurrent_oid_set visited;
+  std::atomic<bool> stop(false);
+  detail::work_queue<oid> commits(stop);
+  for (const auto &root : roots_)
+    if (visited.insert(root))
+      commits.push(root);
+
+  detail::run_workers(thread_count(), stop, [&](size_t worker) {
+    git_repository *repo = handles_[worker]->c_ptr_;
+    commits.drain([&](const oid &id) {
+      git_commit *commit_c;
+      if (git_commit_lookup(&commit_c, repo, id.c_ptr()))
+        throw git_exception();
+      commit current(commit_c, ownership::user);
+
+      // Queue the parents before this commit is marked as done
+      const auto parent_count = git_commit_parentcount(commit_c);
+      for (unsigned int n = 0; n < parent_count; ++n) {
+        oid parent(git_commit_parent_id(commit_c, n));
+        if (visited.insert(parent))
+          commits.push(parent);
+      }
+      if (!visit(worker, id, git_commit_time(commit_c)))
+        stop = true;
+    });
+  });
+}
+
+} // namespace cppgit2
@@ -0,0 +1,437 @@
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cppgit2/parallel_status.hpp>
+#include <cppgit2/repository.hpp>
+#include <cstring>
+#include <ctime>
+#include <mutex>
+
+#ifndef _WIN32
+#include <dirent.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "ignore_rules.hpp"
+#include "worker_pool.hpp"
+
+namespace cppgit2 {
+
+namespace {
+
+struct change {
+  std::string path;
+  unsigned int flags;
+};
+
+bool path_less(const git_index_entry *lhs, const char *rhs) {
+  return std::strcmp(lhs->path, rhs) < 0;
+}
+
+#ifndef _WIN32
+
+long mtime_nanoseconds(const struct stat &st) {
+#if defined(__APPLE__)
+  return st.st_mtimespec.tv_nsec;
+#else
+  return st.st_mtim.tv_nsec;
+#endif
+}
+
+// Racy entries were written in the same second as the index, and may have
+// been modified afterwards without a change in their stat data
+bool is_racy(const git_index_entry *entry, const struct stat &index_stat) {
+  const auto seconds = static_cast<int64_t>(entry->mtime.seconds);
+  return seconds > static_cast<int64_t>(index_stat.st_mtime) ||
+         (seconds == static_cast<int64_t>(index_stat.st_mtime) &&
+          static_cast<long>(entry->mtime.nanoseconds) >=
+              mtime_nanoseconds(index_stat));
+}
+
+// Status of a tracked file in the working directory relative to its entry
+unsigned int workdir_status(git_repository *repo, const std::string &workdir,
+                            const git_index_entry *entry,
+                            const struct stat &index_stat, bool trust_mode) {
+  struct stat st;
+  if (lstat((workdir + entry->path).c_str(), &st) != 0)
+    return (errno == ENOENT || errno == ENOTDIR) ? GIT_STATUS_WT_DELETED
+                                                 : GIT_STATUS_WT_UNREADABLE;
+
+  const bool entry_is_link = (entry->mode & 0170000) == 0120000;
+  if (S_ISDIR(st.st_mode))
+    return GIT_STATUS_WT_DELETED; // Its contents are reported as untracked
+  if (S_ISLNK(st.st_mode) != entry_is_link)
+    return GIT_STATUS_WT_TYPECHANGE;
+  if (!entry_is_link && trust_mode &&
+      ((st.st_mode & S_IXUSR) != 0) != (entry->mode == 0100755))
+    return GIT_STATUS_WT_MODIFIED;
+  if (entry->file_size != static_cast<uint32_t>(st.st_size))
+    return GIT_STATUS_WT_MODIFIED;
+
+  // Nanoseconds are 0 in indexes written without them
+  const bool same_stat =
+      entry->mtime.seconds == static_cast<int32_t>(st.st_mtime) &&
+      (entry->mtime.nanoseconds == 0 ||
+       entry->mtime.nanoseconds ==
+           static_cast<uint32_t>(mtime_nanoseconds(st))) &&
+      entry->ctime.seconds == static_cast<int32_t>(st.st_ctime) &&
+      entry->ino == static_cast<uint32_t>(st.st_ino);
+  if (same_stat && !is_racy(entry, index_stat))
+    return 0;
+
+  // Stat data is inconclusive, compare the contents
+  git_oid id;
+  if (entry_is_link) {
+    std::vector<char> target(static_cast<size_t>(st.st_size) + 1);
+    const auto length =
+        readlink((workdir + entry->path).c_str(), target.data(), target.size());
+    if (length < 0)
+      return GIT_STATUS_WT_UNREADABLE;
+    if (git_odb_hash(&id, target.data(), static_cast<size_t>(length),
+                     GIT_OBJECT_BLOB))
+      throw git_exception();
+  } else if (git_repository_hashfile(&id, repo, entry->path, GIT_OBJECT_BLOB,
+                                     nullptr)) {
+    git_exception::clear();
+    return GIT_STATUS_WT_UNREADABLE;
+  }
+  return git_oid_equal(&id, &entry->id) ? 0 : GIT_STATUS_WT_MODIFIED;
+}
+
+bool is_directory(const std::string &path, const struct dirent *item) {
+#ifdef _DIRENT_HAVE_D_TYPE
+  if (item->d_type != DT_UNKNOWN)
+    return item->d_type == DT_DIR;
+#else
+  (void)item;
+#endif
+  struct stat st;
+  return lstat(path.c_str(), &st) == 0 && S_ISDIR(st.st_mode);
+}
+
+bool exists(const std::string &path) {
+  struct stat st;
+  return lstat(path.c_str(), &st) == 0;
+}
+
+#endif
+
+} // namespace
+
+parallel_status::parallel_status(const repository &repo, size_t thread_count)
+    : path_(repo.path()),
+      handles_(detail::open_worker_handles(path_, thread_count)) {}
+
+parallel_status::~parallel_status() {}
+
+size_t parallel_status::thread_count() const { return handles_.size(); }
+
+void parallel_status::for_each(
+    std::function<void(const std::string &, status::status_type)> visitor,
+    bool sorted) {
+  scan(visitor, sorted, nullptr);
+}
+
+void parallel_status::for_each(
+    std::function<void(const std::string &, status::status_type)> visitor,
+    untracked_cache &cache, bool sorted) {
+  scan(visitor, sorted, &cache);
+}
+
+void parallel_status::scan(
+    std::function<void(const std::string &, status::status_type)> visitor,
+    bool sorted, untracked_cache *cache) {
+  git_repository *repo = handles_.front()->c_ptr_;
+  if (git_repository_is_bare(repo))
+    throw git_exception("cannot get status of a bare repository");
+
+#ifdef _WIN32
+  // No parallel scan on Windows yet
+  (void)sorted;
+  (void)cache;
+  handles_.front()->for_each_status(visitor);
+#else
+  const std::string workdir(git_repository_workdir(repo));
+
+  git_index *index_c;
+  if (git_repository_index(&index_c, repo))
+    throw git_exception();
+  cppgit2::index current_index(index_c, ownership::user);
+  if (git_index_read(index_c, false))
+    throw git_exception();
+
+  struct stat index_stat;
+  std::memset(&index_stat, 0, sizeof(index_stat));
+  if (git_index_path(index_c))
+    stat(git_index_path(index_c), &index_stat);
+
+  bool trust_mode = true;
+  {
+    git_config *config_c;
+    if (git_repository_config_snapshot(&config_c, repo))
+      throw git_exception();
+    int value;
+    if (git_config_get_bool(&value, config_c, "core.filemode") == 0)
+      trust_mode = value != 0;
+    git_exception::clear();
+    git_config_free(config_c);
+  }
+
+  // Entries are shared read-only between the threads
+  std::vector<const git_index_entry *> entries(git_index_entrycount(index_c));
+  for (size_t i = 0; i < entries.size(); ++i)
+    entries[i] = git_index_get_byindex(index_c, i);
+
+  // HEAD to index, as one diff
+  std::vector<change> staged;
+  {
+    git_object *head_tree = nullptr;
+    const auto ret = git_revparse_single(&head_tree, repo, "HEAD^{tree}");
+    if (ret == GIT_ENOTFOUND || ret == GIT_EUNBORNBRANCH)
+      git_exception::clear();
+    else if (ret)
+      throw git_exception();
+
+    git_diff *diff;
+    const auto diff_ret = git_diff_tree_to_index(
+        &diff, repo, reinterpret_cast<git_tree *>(head_tree), index_c, nullptr);
+    if (head_tree)
+      git_object_free(head_tree);
+    if (diff_ret)
+      throw git_exception();
+
+    for (size_t i = 0; i < git_diff_num_deltas(diff); ++i) {
+      const auto delta = git_diff_get_delta(diff, i);
+      switch (delta->status) {
+      case GIT_DELTA_ADDED:
+        staged.push_back({delta->new_file.path, GIT_STATUS_INDEX_NEW});
+        break;
+      case GIT_DELTA_DELETED:
+        staged.push_back({delta->old_file.path, GIT_STATUS_INDEX_DELETED});
+        break;
+      case GIT_DELTA_MODIFIED:
+        staged.push_back({delta->new_file.path, GIT_STATUS_INDEX_MODIFIED});
+        break;
+      case GIT_DELTA_TYPECHANGE:
+        staged.push_back({delta->new_file.path, GIT_STATUS_INDEX_TYPECHANGE});
+        break;
+      default:
+        break;
+      }
+    }
+    git_diff_free(diff);
+    std::sort(staged.begin(), staged.end(),
+              [](const change &lhs, const change &rhs) -> bool {
+                return lhs.path < rhs.path;
+              });
+  }
+
+  // Each staged change is combined with the workdir status of its path
+  // once; the rest are reported at the end
+  std::unique_ptr<std::atomic<bool>[]> consumed(
+      new std::atomic<bool>[staged.size()]);
+  for (size_t i = 0; i < staged.size(); ++i)
+    consumed[i] = false;
+  auto take_staged = [&](const std::string &path) -> unsigned int {
+    auto found = std::lower_bound(
+        staged.begin(), staged.end(), path,
+        [](const change &lhs, const std::string &rhs) -> bool {
+          return lhs.path < rhs;
+        });
+    if (found == staged.end() || found->path != path ||
+        consumed[found - staged.begin()].exchange(true))
+      return 0;
+    return found->flags;
+  };
+
+  std::mutex emit_mutex;
+  std::vector<change> results;
+  auto emit = [&](const std::string &path, unsigned int flags) {
+    if (flags == 0)
+      return;
+    std::lock_guard<std::mutex> lock(emit_mutex);
+    if (sorted)
+      results.push_back({path, flags});
+    else
+      visitor(path, static_cast<status::status_type>(flags));
+  };
+
+  const auto workers = thread_count();
+  std::atomic<bool> stop(false);
+
+  // Index to workdir, in chunks of consecutive (sorted) entries
+  const size_t chunk_size =
+      std::max<size_t>(64, entries.size() / (workers * 8) + 1);
+  std::atomic<size_t> next_chunk(0);
+  detail::run_workers(workers, stop, [&](size_t worker) {
+    git_repository *worker_repo = handles_[worker]->c_ptr_;
+    while (!stop) {
+      const auto begin = next_chunk.fetch_add(chunk_size);
+      if (begin >= entries.size())
+        break;
+      const auto end = std::min(begin + chunk_size, entries.size());
+      for (auto i = begin; i < end && !stop; ++i) {
+        const auto entry = entries[i];
+        const std::string path(entry->path);
+        if (git_index_entry_stage(entry) > 0) {
+          // Report each conflicted path once
+          take_staged(path);
+          if (i == 0 || std::strcmp(entries[i - 1]->path, entry->path) != 0)
+            emit(path, GIT_STATUS_CONFLICTED);
+          continue;
+        }
+        auto flags = take_staged(path);
+        const bool is_gitlink = (entry->mode & 0170000) == 0160000;
+        const bool skip_worktree =
+            (entry->flags_extended & GIT_INDEX_ENTRY_SKIP_WORKTREE) != 0;
+        if (!is_gitlink && !skip_worktree)
+          flags |= workdir_status(worker_repo, workdir, entry, index_stat,
+                                  trust_mode);
+        emit(path, flags);
+      }
+    }
+  });
+
+  // Untracked and ignored files, walking directories in parallel
+  auto is_tracked = [&](const std::string &path) -> bool {
+    auto found = std::lower_bound(entries.begin(), entries.end(),
+                                  path.c_str(), path_less);
+    return found != entries.end() && path == (*found)->path;
+  };
+  auto has_tracked_below = [&](const std::string &directory) -> bool {
+    auto found = std::lower_bound(entries.begin(), entries.end(),
+                                  directory.c_str(), path_less);
+    return found != entries.end() &&
+           std::strncmp((*found)->path, directory.c_str(),
+                        directory.size()) == 0;
+  };
+
+  // With an untracked cache, unchanged directories are not read again.
+  // `trusted` is set when the .gitignore files of the parents are unchanged.
+  // Ignore rules are loaded once per directory, and passed down to its
+  // subdirectories; everything below an ignored directory is ignored.
+  struct queued_directory {
+    std::string path;
+    bool trusted;
+    std::shared_ptr<const detail::ignore_rules> parent_rules;
+    bool ignored;
+  };
+  const auto scan_start = static_cast<int64_t>(std::time(nullptr));
+  std::mutex cache_mutex;
+  std::atomic<bool> cache_modified(false);
+  if (cache)
+    cache->prepare(repo);
+
+  detail::work_queue<queued_directory> directories(stop);
+  directories.push({"", true, nullptr, false});
+  const auto root_rules = detail::ignore_rules::load(repo);
+  detail::run_workers(workers, stop, [&](size_t) {
+    std::vector<untracked_cache::entry> listing;
+    directories.drain([&](const queued_directory &directory) {
+      const auto rules =
+          directory.parent_rules
+              ? detail::ignore_rules::enter(directory.parent_rules,
+                                            directory.path)
+              : root_rules;
+
+      // Each directory record is only used by the thread walking it
+      untracked_cache::directory *record = nullptr;
+      bool trusted_below = false;
+      bool reuse = false;
+      if (cache) {
+        {
+          std::lock_guard<std::mutex> lock(cache_mutex);
+          record = &cache->directories_[directory.path];
+        }
+        reuse = cache->revalidate(*record, workdir + directory.path,
+                                  directory.trusted, scan_start,
+                                  trusted_below);
+        if (!reuse)
+          cache_modified = true;
+      }
+      auto &entries_here = record ? record->entries : listing;
+      if (!reuse) {
+        entries_here.clear();
+        if (auto dir = opendir((workdir + directory.path).c_str())) {
+          while (auto item = readdir(dir)) {
+            const std::string name(item->d_name);
+            if (name == "." || name == ".." || name == ".git")
+              continue;
+            entries_here.push_back(
+                {name,
+                 is_directory(workdir + directory.path + name, item), -1});
+          }
+          closedir(dir);
+        } else if (record) {
+          record->valid = false;
+        }
+      }
+
+      auto check_ignored = [&](untracked_cache::entry &item,
+                               const std::string &path) -> bool {
+        if (item.ignored < 0) {
+          item.ignored =
+              (directory.ignored || rules->is_ignored(path)) ? 1 : 0;
+          if (record)
+            cache_modified = true;
+        }
+        return item.ignored != 0;
+      };
+
+      for (auto &item : entries_here) {
+        const auto path = directory.path + item.name;
+        if (is_tracked(path))
+          continue; // Files are handled above, gitlinks are not examined
+
+        if (!item.is_directory) {
+          emit(path, take_staged(path) | (check_ignored(item, path)
+                                              ? GIT_STATUS_IGNORED
+                                              : GIT_STATUS_WT_NEW));
+          continue;
+        }
+
+        const auto subdirectory = path + "/";
+        bool ignored = directory.ignored;
+        if (!has_tracked_below(subdirectory)) {
+          // Untracked directory: ignored and nested repositories are
+          // reported as a whole, anything else is recursed into
+          if (check_ignored(item, subdirectory)) {
+            emit(subdirectory, GIT_STATUS_IGNORED);
+            continue;
+          }
+          if (exists(workdir + subdirectory + ".git")) {
+            emit(subdirectory, GIT_STATUS_WT_NEW);
+            continue;
+          }
+        } else if (!ignored) {
+          ignored = rules->is_ignored(subdirectory);
+        }
+        directories.push({subdirectory, trusted_below, rules, ignored});
+      }
+    });
+  });
+
+  if (cache) {
+    cache->prune();
+    if (cache_modified)
+      cache->modified_ = true;
+  }
+
+  // Staged changes whose path is gone from both index and workdir
+  for (size_t i = 0; i < staged.size(); ++i)
+    if (!consumed[i])
+      emit(staged[i].path, staged[i].flags);
+
+  if (sorted) {
+    std::sort(results.begin(), results.end(),
+              [](const change &lhs, const change &rhs) -> bool {
+                return lhs.path < rhs.path;
+              });
+    for (const auto &result : results)
+      visitor(result.path, static_cast<status::status_type>(result.flags));
+  }
+#endif
+}
+
+} // namespace cppgit2
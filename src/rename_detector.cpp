@@ -0,0 +1,330 @@
+#include <algorithm>
+#include <atomic>
+#include <cppgit2/rename_detector.hpp>
+#include <cppgit2/repository.hpp>
+#include <limits>
+
+#include "worker_pool.hpp"
+
+namespace cppgit2 {
+
+namespace {
+
+// Files of the diff that can be paired
+struct candidate_file {
+  const char *path;
+  oid id;
+  uint16_t mode;
+  bool deleted; // only for sources
+};
+
+struct scored_pair {
+  uint16_t score;
+  size_t source;
+  size_t target;
+};
+
+// Blobs and symlinks, except empty ones
+// Tree diffs leave `size` unset, so empty files are known by their id.
+bool is_pairable(const git_diff_file &file) {
+  constexpr oid empty_blob("e69de29bb2d1d6434b8b29ae775ad8c2e48c5391");
+  const auto type = file.mode & 0170000;
+  return (type == 0100000 || type == 0120000) &&
+         oid(&file.id) != empty_blob;
+}
+
+// `a` * `b`, or the largest size_t if the product does not fit
+size_t saturated_product(size_t a, size_t b) {
+  if (a != 0 && b > std::numeric_limits<size_t>::max() / a)
+    return std::numeric_limits<size_t>::max();
+  return a * b;
+}
+
+} // namespace
+
+rename_detector::rename_detector(const repository &repo, size_t thread_count)
+    : path_(repo.path()),
+      handles_(detail::open_worker_handles(path_, thread_count)),
+      threshold_(50), rename_limit_(1000), find_copies_(false),
+      cache_capacity_(100000), limit_exceeded_(false) {}
+
+rename_detector::~rename_detector() {}
+
+size_t rename_detector::thread_count() const { return handles_.size(); }
+
+uint16_t rename_detector::threshold() const { return threshold_; }
+
+void rename_detector::set_threshold(uint16_t percent) {
+  threshold_ = std::min<uint16_t>(percent, 100);
+}
+
+size_t rename_detector::rename_limit() const { return rename_limit_; }
+
+void rename_detector::set_rename_limit(size_t limit) { rename_limit_ = limit; }
+
+bool rename_detector::find_copies() const { return find_copies_; }
+
+void rename_detector::set_find_copies(bool enabled) { find_copies_ = enabled; }
+
+size_t rename_detector::cache_capacity() const { return cache_capacity_; }
+
+void rename_detector::set_cache_capacity(size_t capacity) {
+  cache_capacity_ = capacity;
+  while (cache_.size() > cache_capacity_) {
+    cache_index_.erase(cache_.back().first);
+    cache_.pop_back();
+  }
+}
+
+size_t rename_detector::cache_size() const {
+  return cache_.size();
+}
+
+void rename_detector::clear_cache() {
+  cache_.clear();
+  cache_index_.clear();
+}
+
+bool rename_detector::limit_exceeded() const { return limit_exceeded_; }
+
+std::vector<std::shared_ptr<const rename_detector::signature>>
+rename_detector::signatures(const std::vector<oid> &ids) {
+  std::vector<std::shared_ptr<const signature>> result(ids.size());
+  std::vector<size_t> missing;
+  {
+      for (size_t i = 0; i < ids.size(); ++i) {
+      auto found = cache_index_.find(ids[i]);
+      if (found != cache_index_.end()) {
+        cache_.splice(cache_.begin(), cache_, found->second);
+        result[i] = found->second->second;
+      } else {
+        missing.push_back(i);
+      }
+    }
+  }
+
+  std::atomic<bool> stop(false);
+  std::atomic<size_t> next(0);
+  const auto workers =
+      std::min(thread_count(), std::max<size_t>(1, missing.size()));
+  detail::run_workers(workers, stop, [&](size_t worker) {
+    git_repository *worker_repo = handles_[worker]->c_ptr_;
+    while (!stop) {
+      const auto i = next.fetch_add(1);
+      if (i >= missing.size())
+        break;
+      const auto &id = ids[missing[i]];
+      git_blob *blob_c;
+      if (git_blob_lookup(&blob_c, worker_repo, id.c_ptr()))
+        throw git_exception();
+      const auto data = static_cast<const unsigned char *>(
+          git_blob_rawcontent(blob_c));
+      const auto size = static_cast<size_t>(git_blob_rawsize(blob_c));
+
+      // Chunks end at newlines, or after 64 bytes; hashed with FNV-1a
+      std::unique_ptr<signature> summary(new signature);
+      summary->size = size;
+      std::vector<std::pair<uint32_t, uint32_t>> chunks;
+      size_t start = 0;
+      while (start < size) {
+        uint32_t hash = 2166136261u;
+        size_t end = start;
+        while (end < size && end - start < 64) {
+          hash = (hash ^ data[end]) * 16777619u;
+          if (data[end++] == '\n')
+            break;
+        }
+        chunks.emplace_back(hash, static_cast<uint32_t>(end - start));
+        start = end;
+      }
+      git_blob_free(blob_c);
+
+      std::sort(chunks.begin(), chunks.end());
+      for (const auto &chunk : chunks) {
+        if (!summary->chunks.empty() &&
+            summary->chunks.back().first == chunk.first)
+          summary->chunks.back().second += chunk.second;
+        else
+          summary->chunks.push_back(chunk);
+      }
+      result[missing[i]] = std::move(summary);
+    }
+  });
+
+  for (auto i : missing) {
+    if (cache_capacity_ == 0)
+      break;
+    // The same blob can be missing twice in `ids`
+    auto found = cache_index_.find(ids[i]);
+    if (found != cache_index_.end()) {
+      cache_.splice(cache_.begin(), cache_, found->second);
+      continue;
+    }
+    if (cache_.size() >= cache_capacity_) {
+      cache_index_.erase(cache_.back().first);
+      cache_.pop_back();
+    }
+    cache_.emplace_front(ids[i], result[i]);
+    cache_index_[ids[i]] = cache_.begin();
+  }
+  return result;
+}
+
+std::vector<rename_detector::match>
+rename_detector::find(const diff &changes) {
+  limit_exceeded_ = false;
+  const git_diff *diff_c = changes.c_ptr();
+
+  std::vector<candidate_file> sources, targets;
+  for (size_t i = 0; i < git_diff_num_deltas(diff_c); ++i) {
+    const auto delta = git_diff_get_delta(diff_c, i);
+    if (delta->status == GIT_DELTA_ADDED && is_pairable(delta->new_file))
+      targets.push_back({delta->new_file.path, oid(&delta->new_file.id),
+                         delta->new_file.mode, false});
+    else if (delta->status == GIT_DELTA_DELETED &&
+             is_pairable(delta->old_file))
+      sources.push_back({delta->old_file.path, oid(&delta->old_file.id),
+                         delta->old_file.mode, true});
+    else if (find_copies_ && delta->status == GIT_DELTA_MODIFIED &&
+             is_pairable(delta->old_file))
+      sources.push_back({delta->old_file.path, oid(&delta->old_file.id),
+                         delta->old_file.mode, false});
+  }
+
+  std::vector<match> result;
+  if (sources.empty() || targets.empty())
+    return result;
+
+  std::vector<bool> renamed(sources.size(), false);
+  std::vector<bool> paired(targets.size(), false);
+  auto pair = [&](size_t source, size_t target, uint16_t score) -> bool {
+    const auto &from = sources[source];
+    const bool is_copy = !from.deleted || renamed[source];
+    if (paired[target] || (is_copy && !find_copies_))
+      return false;
+    if (!is_copy)
+      renamed[source] = true;
+    paired[target] = true;
+    result.push_back({from.path, targets[target].path, from.id,
+                      targets[target].id, score, is_copy});
+    return true;
+  };
+
+  // Identical files first; deleted sources are preferred for renames
+  {
+    std::unordered_map<oid, std::vector<size_t>> by_id;
+    for (size_t i = 0; i < sources.size(); ++i)
+      by_id[sources[i].id].push_back(i);
+    for (auto &item : by_id)
+      std::stable_partition(item.second.begin(), item.second.end(),
+                            [&](size_t i) { return sources[i].deleted; });
+    for (size_t j = 0; j < targets.size(); ++j) {
+      auto found = by_id.find(targets[j].id);
+      if (found == by_id.end())
+        continue;
+      for (auto i : found->second)
+        if ((sources[i].mode & 0170000) == (targets[j].mode & 0170000) &&
+            pair(i, j, 100))
+          break;
+    }
+  }
+
+  // Then by similarity, for what is left
+  std::vector<size_t> open_sources, open_targets;
+  for (size_t i = 0; i < sources.size(); ++i)
+    if (find_copies_ || !renamed[i])
+      open_sources.push_back(i);
+  for (size_t j = 0; j < targets.size(); ++j)
+    if (!paired[j])
+      open_targets.push_back(j);
+
+  if (!open_sources.empty() && !open_targets.empty() && threshold_ < 100) {
+    if (saturated_product(open_sources.size(), open_targets.size()) >
+        saturated_product(rename_limit_, rename_limit_)) {
+      limit_exceeded_ = true;
+    } else {
+      std::vector<oid> ids;
+      for (auto i : open_sources)
+        ids.push_back(sources[i].id);
+      for (auto j : open_targets)
+        ids.push_back(targets[j].id);
+      const auto summaries = signatures(ids);
+      const auto source_summary = [&](size_t k) -> const signature & {
+        return *summaries[k];
+      };
+      const auto target_summary = [&](size_t k) -> const signature & {
+        return *summaries[open_sources.size() + k];
+      };
+
+      // Sources by chunk hash: {position in open_sources, chunk size}
+      std::unordered_map<uint32_t, std::vector<std::pair<uint32_t, uint32_t>>>
+          index;
+      for (size_t k = 0; k < open_sources.size(); ++k)
+        for (const auto &chunk : source_summary(k).chunks)
+          index[chunk.first].emplace_back(static_cast<uint32_t>(k),
+                                          chunk.second);
+
+      std::vector<std::vector<scored_pair>> scored(thread_count());
+      std::atomic<bool> stop(false);
+      std::atomic<size_t> next(0);
+      const auto workers = std::min(thread_count(), open_targets.size());
+      detail::run_workers(workers, stop, [&](size_t worker) {
+        std::vector<uint64_t> common(open_sources.size(), 0);
+        std::vector<uint32_t> touched;
+        while (!stop) {
+          const auto k = next.fetch_add(1);
+          if (k >= open_targets.size())
+            break;
+          const auto &target = target_summary(k);
+          const auto target_type = targets[open_targets[k]].mode & 0170000;
+          for (const auto &chunk : target.chunks) {
+            auto found = index.find(chunk.first);
+            if (found == index.end())
+              continue;
+            for (const auto &posting : found->second) {
+              if (common[posting.first] == 0)
+                touched.push_back(posting.first);
+              common[posting.first] += std::min(chunk.second, posting.second);
+            }
+          }
+          for (auto s : touched) {
+            const auto &source = source_summary(s);
+            const auto larger = std::max(source.size, target.size);
+            const auto score =
+                static_cast<uint16_t>(common[s] * 100 / larger);
+            common[s] = 0;
+            if (score < threshold_ ||
+                (sources[open_sources[s]].mode & 0170000) != target_type)
+              continue;
+            scored[worker].push_back(
+                {score, open_sources[s], open_targets[k]});
+          }
+          touched.clear();
+        }
+      });
+
+      // Best scores first; ties keep path order
+      std::vector<scored_pair> pairs;
+      for (const auto &worker_pairs : scored)
+        pairs.insert(pairs.end(), worker_pairs.begin(), worker_pairs.end());
+      std::sort(pairs.begin(), pairs.end(),
+                [](const scored_pair &lhs, const scored_pair &rhs) -> bool {
+                  if (lhs.score != rhs.score)
+                    return lhs.score > rhs.score;
+                  if (lhs.target != rhs.target)
+                    return lhs.target < rhs.target;
+                  return lhs.source < rhs.source;
+                });
+      for (const auto &candidate : pairs)
+        pair(candidate.source, candidate.target, candidate.score);
+    }
+  }
+
+  std::sort(result.begin(), result.end(),
+            [](const match &lhs, const match &rhs) -> bool {
+              return lhs.new_path < rhs.new_path;
+            });
+  return result;
+}
+
+} // namespace cppgit2
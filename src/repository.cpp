@@ -1,6 +1,8 @@
 #include <cppgit2/repository.hpp>
 #include <functional>
 
+#include "foreach_payload.hpp"
+
 namespace cppgit2 {
 
 repository::repository(git_repository *c_ptr) : c_ptr_(c_ptr) {}
@@ -137,43 +139,42 @@ void repository::for_each_fetch_head(
     std::function<void(const std::string &, const std::string &, const oid &,
                        bool)>
         visitor) const {
-  struct visitor_wrapper {
+  for_each_fetch_head(visitor, cancellation_token());
+}
+
+void repository::for_each_fetch_head(
     std::function<void(const std::string &, const std::string &, const oid &,
                        bool)>
-        fn;
-  };
-
-  visitor_wrapper wrapper;
-  wrapper.fn = visitor;
+        visitor,
+    const cancellation_token &token) const {
+  typedef detail::foreach_payload<decltype(visitor)> payload;
+  payload wrapper(visitor, token);
 
   auto callback_c = [](const char *ref_name, const char *remote_url,
                        const git_oid *oid_c, unsigned int is_merge,
-                       void *payload) {
-    auto wrapper = reinterpret_cast<visitor_wrapper *>(payload);
-    wrapper->fn(ref_name, remote_url, oid(oid_c), is_merge);
-    return 0;
+                       void *data) -> int {
+    return payload::from(data)(ref_name, remote_url, oid(oid_c), is_merge);
   };
 
-  if (git_repository_fetchhead_foreach(c_ptr_, callback_c, (void *)(&wrapper)))
-    throw git_exception();
+  wrapper.finish(
+      git_repository_fetchhead_foreach(c_ptr_, callback_c, wrapper.c_ptr()));
 }
 
 void repository::for_each_merge_head(std::function<void(const oid &)> visitor) const {
-  struct visitor_wrapper {
-    std::function<void(const oid &)> fn;
-  };
+  for_each_merge_head(visitor, cancellation_token());
+}
 
-  visitor_wrapper wrapper;
-  wrapper.fn = visitor;
+void repository::for_each_merge_head(std::function<void(const oid &)> visitor,
+                                     const cancellation_token &token) const {
+  typedef detail::foreach_payload<decltype(visitor)> payload;
+  payload wrapper(visitor, token);
 
-  auto callback_c = [](const git_oid *oid_c, void *payload) {
-    auto wrapper = reinterpret_cast<visitor_wrapper *>(payload);
-    wrapper->fn(oid(oid_c));
-    return 0;
+  auto callback_c = [](const git_oid *oid_c, void *data) -> int {
+    return payload::from(data)(oid(oid_c));
   };
 
-  if (git_repository_mergehead_foreach(c_ptr_, callback_c, (void *)(&wrapper)))
-    throw git_exception();
+  wrapper.finish(
+      git_repository_mergehead_foreach(c_ptr_, callback_c, wrapper.c_ptr()));
 }
 
 std::string repository::namespace_() const {
@@ -444,23 +445,23 @@ void repository::flush_attributes_cache() const {
 void repository::for_each_attribute(
     attribute::flag flags, const std::string &path,
     std::function<void(const std::string &, const std::string &)> visitor) const {
+  for_each_attribute(flags, path, visitor, cancellation_token());
+}
 
-  struct visitor_wrapper {
-    std::function<void(const std::string &, const std::string &)> fn;
-  };
-
-  visitor_wrapper wrapper;
-  wrapper.fn = visitor;
-
-  auto callback_c = [](const char *name, const char *value, void *payload) {
-    auto wrapper = reinterpret_cast<visitor_wrapper *>(payload);
-    wrapper->fn(name, value);
-    return 0;
+void repository::for_each_attribute(
+    attribute::flag flags, const std::string &path,
+    std::function<void(const std::string &, const std::string &)> visitor,
+    const cancellation_token &token) const {
+  typedef detail::foreach_payload<decltype(visitor)> payload;
+  payload wrapper(visitor, token);
+
+  auto callback_c = [](const char *name, const char *value,
+                       void *data) -> int {
+    return payload::from(data)(name, value);
   };
 
-  if (git_attr_foreach(c_ptr_, static_cast<uint32_t>(flags), path.c_str(),
-                       callback_c, (void *)(&wrapper)))
-    throw git_exception();
+  wrapper.finish(git_attr_foreach(c_ptr_, static_cast<uint32_t>(flags),
+                                  path.c_str(), callback_c, wrapper.c_ptr()));
 }
 
 std::string repository::lookup_attribute(attribute::flag flags,
@@ -838,45 +839,98 @@ commit repository::lookup_commit(const oid &id, size_t length) const {
   return result;
 }
 
-void repository::for_each_commit(std::function<void(const commit &id)> visitor,
-                                 revision::sort sort_ordering) const {
+namespace {
+
+// Walk commits reachable from `start_from` (HEAD if null)
+// Stops as soon as the visitor returns false
+template <typename Visitor>
+void walk_commits(git_repository *repo, const git_oid *start_from,
+                  revision::sort sort_ordering, Visitor &&visitor) {
   git_revwalk *iter;
-  auto ret = git_revwalk_new(&iter, c_ptr_);
-  git_revwalk_push_head(iter);
+  if (git_revwalk_new(&iter, repo))
+    throw git_exception();
+  revwalk walker(iter, ownership::user);
 
-  if (ret != 0) {
-    git_revwalk_free(iter);
+  auto ret = start_from ? git_revwalk_push(iter, start_from)
+                        : git_revwalk_push_head(iter);
+  if (ret == GIT_EUNBORNBRANCH || ret == GIT_ENOTFOUND)
+    return; // Nothing to walk, e.g., in an empty repository
+  else if (ret != 0)
     throw git_exception();
-  }
 
   git_revwalk_sorting(iter, static_cast<unsigned int>(sort_ordering));
   git_oid id_c;
   while ((ret = git_revwalk_next(&id_c, iter)) == 0) {
-    oid id(&id_c);
-    visitor(lookup_commit(id));
+    if (!visitor(oid(&id_c)))
+      break;
   }
-  git_revwalk_free(iter);
+  if (ret != 0 && ret != GIT_ITEROVER)
+    throw git_exception();
+}
+
+} // namespace
+
+void repository::for_each_commit(std::function<void(const commit &id)> visitor,
+                                 revision::sort sort_ordering) const {
+  for_each_commit(visitor, cancellation_token(), sort_ordering);
 }
 
 void repository::for_each_commit(std::function<void(const commit &id)> visitor,
                                  const commit &start_from,
                                  revision::sort sort_ordering) const {
-  git_revwalk *iter;
-  auto ret = git_revwalk_new(&iter, c_ptr_);
-  git_revwalk_push(iter, start_from.id().c_ptr());
+  for_each_commit(visitor, start_from, cancellation_token(), sort_ordering);
+}
 
-  if (ret != 0) {
-    git_revwalk_free(iter);
-    throw git_exception();
-  }
+void repository::for_each_commit(std::function<void(const commit &id)> visitor,
+                                 const cancellation_token &token,
+                                 revision::sort sort_ordering) const {
+  walk_commits(c_ptr_, nullptr, sort_ordering, [&](const oid &id) -> bool {
+    if (token.is_cancelled())
+      return false;
+    visitor(lookup_commit(id));
+    return true;
+  });
+}
 
-  git_revwalk_sorting(iter, static_cast<unsigned int>(sort_ordering));
-  git_oid id_c;
-  while ((ret = git_revwalk_next(&id_c, iter)) == 0) {
-    oid payload(&id_c);
-    visitor(lookup_commit(payload));
-  }
-  git_revwalk_free(iter);
+void repository::for_each_commit(std::function<void(const commit &id)> visitor,
+                                 const commit &start_from,
+                                 const cancellation_token &token,
+                                 revision::sort sort_ordering) const {
+  auto start_id = start_from.id();
+  walk_commits(c_ptr_, start_id.c_ptr(), sort_ordering,
+               [&](const oid &id) -> bool {
+                 if (token.is_cancelled())
+                   return false;
+                 visitor(lookup_commit(id));
+                 return true;
+               });
+}
+
+void repository::for_each_commit_id(std::function<bool(const oid &)> visitor,
+                                    revision::sort sort_ordering) const {
+  walk_commits(c_ptr_, nullptr, sort_ordering, visitor);
+}
+
+void repository::for_each_commit_id(std::function<bool(const oid &)> visitor,
+                                    const oid &start_from,
+                                    revision::sort sort_ordering) const {
+  walk_commits(c_ptr_, start_from.c_ptr(), sort_ordering, visitor);
+}
+
+void repository::for_each_commit_view(
+    std::function<bool(const commit_view &)> visitor,
+    revision::sort sort_ordering) const {
+  walk_commits(c_ptr_, nullptr, sort_ordering, [&](const oid &id) {
+    return visitor(commit_view(c_ptr_, id));
+  });
+}
+
+void repository::for_each_commit_view(
+    std::function<bool(const commit_view &)> visitor, const oid &start_from,
+    revision::sort sort_ordering) const {
+  walk_commits(c_ptr_, start_from.c_ptr(), sort_ordering, [&](const oid &id) {
+    return visitor(commit_view(c_ptr_, id));
+  });
 }
 
 void repository::add_ondisk_config_file(const cppgit2::config &cfg,
@@ -1214,23 +1268,23 @@ data_buffer repository::detault_notes_reference() const {
 void repository::for_each_note(
     const std::string &notes_ref,
     std::function<void(const oid &, const oid &)> visitor) const {
-  struct visitor_wrapper {
-    std::function<void(const oid &, const oid &)> fn;
-  };
+  for_each_note(notes_ref, visitor, cancellation_token());
+}
 
-  visitor_wrapper wrapper;
-  wrapper.fn = visitor;
+void repository::for_each_note(
+    const std::string &notes_ref,
+    std::function<void(const oid &, const oid &)> visitor,
+    const cancellation_token &token) const {
+  typedef detail::foreach_payload<decltype(visitor)> payload;
+  payload wrapper(visitor, token);
 
   auto callback_c = [](const git_oid *blob_id,
-                       const git_oid *annotated_object_id, void *payload) {
-    auto wrapper = reinterpret_cast<visitor_wrapper *>(payload);
-    wrapper->fn(oid(blob_id), oid(annotated_object_id));
-    return 0;
+                       const git_oid *annotated_object_id, void *data) -> int {
+    return payload::from(data)(oid(blob_id), oid(annotated_object_id));
   };
 
-  if (git_note_foreach(c_ptr_, notes_ref.c_str(), callback_c,
-                       (void *)(&wrapper)))
-    throw git_exception();
+  wrapper.finish(git_note_foreach(c_ptr_, notes_ref.c_str(), callback_c,
+                                  wrapper.c_ptr()));
 }
 
 object repository::lookup_object(const oid &id,
@@ -1260,6 +1314,12 @@ object repository::lookup_object(const object &treeish, const std::string &path,
   return result;
 }
 
+std::vector<object>
+repository::lookup_objects(const std::vector<oid> &ids,
+                           object::object_type type) const {
+  return object_loader(*this).lookup(ids, type);
+}
+
 pack_builder repository::initialize_pack_builder() const {
   pack_builder result(nullptr, ownership::user);
   if (git_packbuilder_new(&result.c_ptr_, c_ptr_))
@@ -1387,11 +1447,18 @@ reference repository::create_symbolic_reference(
 
 void repository::for_each_reference(
     std::function<void(const reference &)> visitor) const {
+  for_each_reference(visitor, cancellation_token());
+}
+
+void repository::for_each_reference(
+    std::function<void(const reference &)> visitor,
+    const cancellation_token &token) const {
   git_reference_iterator *iter;
   git_reference_iterator_new(&iter, c_ptr_);
   git_reference *ref_c;
   int ret;
-  while ((ret = git_reference_next(&ref_c, iter)) == 0) {
+  while (!token.is_cancelled() &&
+         (ret = git_reference_next(&ref_c, iter)) == 0) {
     reference payload(ref_c);
     visitor(payload);
   }
@@ -1623,22 +1690,21 @@ void repository::drop_stash(size_t index) const {
 void repository::for_each_stash(
     std::function<void(size_t, const std::string &, const oid &)> visitor)
     const {
-  struct visitor_wrapper {
-    std::function<void(size_t, const std::string &, const oid &)> fn;
-  };
+  for_each_stash(visitor, cancellation_token());
+}
 
-  visitor_wrapper wrapper;
-  wrapper.fn = visitor;
+void repository::for_each_stash(
+    std::function<void(size_t, const std::string &, const oid &)> visitor,
+    const cancellation_token &token) const {
+  typedef detail::foreach_payload<decltype(visitor)> payload;
+  payload wrapper(visitor, token);
 
   auto callback_c = [](size_t index, const char *message,
-                       const git_oid *stash_id, void *payload) {
-    auto wrapper = reinterpret_cast<visitor_wrapper *>(payload);
-    wrapper->fn(index, message, oid(stash_id));
-    return 0;
+                       const git_oid *stash_id, void *data) -> int {
+    return payload::from(data)(index, message, oid(stash_id));
   };
 
-  if (git_stash_foreach(c_ptr_, callback_c, (void *)(&wrapper)))
-    throw git_exception();
+  wrapper.finish(git_stash_foreach(c_ptr_, callback_c, wrapper.c_ptr()));
 }
 
 void repository::pop_stash(size_t index, const stash::apply::options &options) const {
@@ -1664,44 +1730,45 @@ status::status_type repository::status_file(const std::string &path) const {
 
 void repository::for_each_status(
     std::function<void(const std::string &, status::status_type)> visitor) const {
-  struct visitor_wrapper {
-    std::function<void(const std::string &, status::status_type)> fn;
-  };
+  for_each_status(visitor, cancellation_token());
+}
 
-  visitor_wrapper wrapper;
-  wrapper.fn = visitor;
+void repository::for_each_status(
+    const status::options &options,
+    std::function<void(const std::string &, status::status_type)> visitor) const {
+  for_each_status(options, visitor, cancellation_token());
+}
+
+void repository::for_each_status(
+    std::function<void(const std::string &, status::status_type)> visitor,
+    const cancellation_token &token) const {
+  typedef detail::foreach_payload<decltype(visitor)> payload;
+  payload wrapper(visitor, token);
 
   auto callback_c = [](const char *path, unsigned int status_flags,
-                       void *payload) {
-    auto wrapper = reinterpret_cast<visitor_wrapper *>(payload);
-    wrapper->fn(path, static_cast<status::status_type>(status_flags));
-    return 0;
+                       void *data) -> int {
+    return payload::from(data)(
+        path, static_cast<status::status_type>(status_flags));
   };
 
-  if (git_status_foreach(c_ptr_, callback_c, (void *)(&wrapper)))
-    throw git_exception();
+  wrapper.finish(git_status_foreach(c_ptr_, callback_c, wrapper.c_ptr()));
 }
 
 void repository::for_each_status(
     const status::options &options,
-    std::function<void(const std::string &, status::status_type)> visitor) const {
-  struct visitor_wrapper {
-    std::function<void(const std::string &, status::status_type)> fn;
-  };
-
-  visitor_wrapper wrapper;
-  wrapper.fn = visitor;
+    std::function<void(const std::string &, status::status_type)> visitor,
+    const cancellation_token &token) const {
+  typedef detail::foreach_payload<decltype(visitor)> payload;
+  payload wrapper(visitor, token);
 
   auto callback_c = [](const char *path, unsigned int status_flags,
-                       void *payload) {
-    auto wrapper = reinterpret_cast<visitor_wrapper *>(payload);
-    wrapper->fn(path, static_cast<status::status_type>(status_flags));
-    return 0;
+                       void *data) -> int {
+    return payload::from(data)(
+        path, static_cast<status::status_type>(status_flags));
   };
 
-  if (git_status_foreach_ext(c_ptr_, options.c_ptr(), callback_c,
-                             (void *)(&wrapper)))
-    throw git_exception();
+  wrapper.finish(git_status_foreach_ext(c_ptr_, options.c_ptr(), callback_c,
+                                        wrapper.c_ptr()));
 }
 
 status::list repository::status_list(const status::options &options) const {
@@ -1730,28 +1797,28 @@ submodule repository::setup_submodule(const std::string &url,
 
 void repository::for_each_submodule(
     std::function<void(const submodule &, const std::string &)> visitor) const {
-  // Wrap user-provided visitor funciton in a struct
-  struct visitor_wrapper {
-    std::function<void(const submodule &, const std::string &)> fn;
-  };
+  for_each_submodule(visitor, cancellation_token());
+}
 
-  visitor_wrapper wrapper;
-  wrapper.fn = visitor;
+void repository::for_each_submodule(
+    std::function<void(const submodule &, const std::string &)> visitor,
+    const cancellation_token &token) const {
+  // Wrap user-provided visitor funciton in a struct
+  typedef detail::foreach_payload<decltype(visitor)> payload;
+  payload wrapper(visitor, token);
 
   // Pass wrapper visitor as the payload variable to the c callback
 
-  auto visitor_c = [](git_submodule *sm, const char *name, void *payload) {
-    auto wrapped = reinterpret_cast<visitor_wrapper *>(payload);
-
+  auto visitor_c = [](git_submodule *sm, const char *name,
+                      void *data) -> int {
     submodule submodule_arg = submodule(sm);
     std::string name_arg = std::string(name);
 
-    wrapped->fn(submodule_arg, name_arg); // call the wrapper visitor function
-    return 0;
+    // call the wrapper visitor function
+    return payload::from(data)(submodule_arg, name_arg);
   };
 
-  if (git_submodule_foreach(c_ptr_, visitor_c, (void *)(&wrapper)))
-    throw git_exception();
+  wrapper.finish(git_submodule_foreach(c_ptr_, visitor_c, wrapper.c_ptr()));
 }
 
 submodule repository::lookup_submodule(const std::string &name) const {
@@ -1859,21 +1926,20 @@ void repository::delete_tag(const std::string &tag_name) const {
 
 void repository::for_each_tag(
     std::function<void(const std::string &, const oid &)> visitor) const {
-  struct visitor_wrapper {
-    std::function<void(const std::string &, const oid &)> fn;
-  };
+  for_each_tag(visitor, cancellation_token());
+}
 
-  visitor_wrapper wrapper;
-  wrapper.fn = visitor;
+void repository::for_each_tag(
+    std::function<void(const std::string &, const oid &)> visitor,
+    const cancellation_token &token) const {
+  typedef detail::foreach_payload<decltype(visitor)> payload;
+  payload wrapper(visitor, token);
 
-  auto callback_c = [](const char *name, git_oid *oid_c, void *payload) {
-    auto wrapper = reinterpret_cast<visitor_wrapper *>(payload);
-    wrapper->fn(name, oid(oid_c));
-    return 0;
+  auto callback_c = [](const char *name, git_oid *oid_c, void *data) -> int {
+    return payload::from(data)(name, oid(oid_c));
   };
 
-  if (git_tag_foreach(c_ptr_, callback_c, (void *)(&wrapper)))
-    throw git_exception();
+  wrapper.finish(git_tag_foreach(c_ptr_, callback_c, wrapper.c_ptr()));
 }
 
 strarray repository::tags() const {
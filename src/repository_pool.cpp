@@ -0,0 +1,212 @@
+#include <algorithm>
+#include <cppgit2/repository.hpp>
+#include <cppgit2/repository_pool.hpp>
+#include <thread>
+
+// Object databases can be shared by threads since libgit2 1.2
+#if LIBGIT2_VER_MAJOR > 1 ||                                                   \
+    (LIBGIT2_VER_MAJOR == 1 && LIBGIT2_VER_MINOR >= 2)
+#define CPPGIT2_SHARE_ODB 1
+#else
+#define CPPGIT2_SHARE_ODB 0
+#endif
+
+namespace cppgit2 {
+
+repository_pool::handle::handle(repository_pool *pool,
+                                std::unique_ptr<repository> repo)
+    : pool_(pool), repo_(std::move(repo)) {}
+
+repository_pool::handle::handle(handle &&other)
+    : pool_(other.pool_), repo_(std::move(other.repo_)) {}
+
+repository_pool::handle &repository_pool::handle::operator=(handle &&other) {
+  if (this != &other) {
+    reset();
+    pool_ = other.pool_;
+    repo_ = std::move(other.repo_);
+  }
+  return *this;
+}
+
+repository_pool::handle::~handle() { reset(); }
+
+repository_pool::handle::operator bool() const { return repo_ != nullptr; }
+
+repository &repository_pool::handle::operator*() const { return *repo_; }
+
+repository *repository_pool::handle::operator->() const { return repo_.get(); }
+
+void repository_pool::handle::reset() {
+  if (repo_)
+    pool_->give_back(std::move(repo_));
+}
+
+repository_pool::repository_pool(const repository &repo, size_t max_size)
+    : path_(repo.path()), odb_(nullptr, git_odb_free) {
+  open(max_size);
+}
+
+repository_pool::repository_pool(const std::string &path, size_t max_size)
+    : path_(path), odb_(nullptr, git_odb_free) {
+  open(max_size);
+}
+
+repository_pool::~repository_pool() {}
+
+void repository_pool::open(size_t max_size) {
+  if (max_size == 0)
+    max_size = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+  max_size_ = max_size;
+  opened_ = 0;
+  in_use_ = 0;
+  reset_metrics();
+
+  // The first handle provides the object database, if shared
+  git_repository *repo_c;
+  if (git_repository_open(&repo_c, path_.c_str()))
+    throw git_exception();
+  std::unique_ptr<repository> first(new repository(repo_c));
+  if (CPPGIT2_SHARE_ODB) {
+    git_odb *odb_c;
+    if (git_repository_odb(&odb_c, repo_c))
+      throw git_exception();
+    odb_.reset(odb_c);
+  }
+  idle_.push_back(std::move(first));
+  opened_ = 1;
+}
+
+std::unique_ptr<repository>
+repository_pool::take(std::unique_lock<std::mutex> &lock) {
+  std::unique_ptr<repository> result;
+  if (!idle_.empty()) {
+    result = std::move(idle_.back());
+    idle_.pop_back();
+    return result;
+  }
+  if (opened_ >= max_size_)
+    return result;
+
+  // Open outside the lock; the slot is taken meanwhile
+  ++opened_;
+  lock.unlock();
+  git_repository *repo_c;
+  int ret = git_repository_open(&repo_c, path_.c_str());
+  if (ret == 0) {
+    result.reset(new repository(repo_c));
+    if (odb_)
+      ret = git_repository_set_odb(repo_c, odb_.get());
+  }
+  if (ret) {
+    // Build the exception before the error is overwritten
+    const git_exception error;
+    result.reset();
+    lock.lock();
+    --opened_;
+    returned_.notify_one();
+    throw error;
+  }
+  lock.lock();
+  return result;
+}
+
+repository_pool::handle
+repository_pool::wait(bool bounded,
+                      std::chrono::steady_clock::time_point deadline) {
+  const auto start = std::chrono::steady_clock::now();
+  std::unique_lock<std::mutex> lock(mutex_);
+  bool waited = false;
+  std::unique_ptr<repository> repo;
+  while (!(repo = take(lock))) {
+    waited = true;
+    if (!bounded)
+      returned_.wait(lock);
+    else if (returned_.wait_until(lock, deadline) == std::cv_status::timeout) {
+      repo = take(lock);
+      break;
+    }
+  }
+
+  if (waited) {
+    const auto wait_time = std::chrono::steady_clock::now() - start;
+    ++waits_;
+    total_wait_ += wait_time;
+    max_wait_ = std::max(max_wait_, wait_time);
+  }
+  if (repo) {
+    ++checkouts_;
+    ++in_use_;
+  }
+  return handle(this, std::move(repo));
+}
+
+repository_pool::handle repository_pool::checkout() {
+  return wait(false, std::chrono::steady_clock::time_point());
+}
+
+repository_pool::handle
+repository_pool::checkout(std::chrono::steady_clock::duration timeout) {
+  return wait(true, std::chrono::steady_clock::now() + timeout);
+}
+
+repository_pool::handle repository_pool::try_checkout() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  auto repo = take(lock);
+  if (repo) {
+    ++checkouts_;
+    ++in_use_;
+  }
+  return handle(this, std::move(repo));
+}
+
+void repository_pool::give_back(std::unique_ptr<repository> repo) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    --in_use_;
+    idle_.push_back(std::move(repo));
+  }
+  returned_.notify_one();
+}
+
+size_t repository_pool::max_size() const { return max_size_; }
+
+size_t repository_pool::size() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return opened_;
+}
+
+size_t repository_pool::in_use() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return in_use_;
+}
+
+size_t repository_pool::checkouts() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return checkouts_;
+}
+
+size_t repository_pool::waits() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return waits_;
+}
+
+std::chrono::steady_clock::duration repository_pool::total_wait_time() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return total_wait_;
+}
+
+std::chrono::steady_clock::duration repository_pool::max_wait_time() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return max_wait_;
+}
+
+void repository_pool::reset_metrics() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  checkouts_ = 0;
+  waits_ = 0;
+  total_wait_ = std::chrono::steady_clock::duration::zero();
+  max_wait_ = std::chrono::steady_clock::duration::zero();
+}
+
+} // namespace cppgit2
@@ -0,0 +1,62 @@
+#include <cppgit2/settings.hpp>
+
+namespace cppgit2 {
+
+void settings::enable_caching(bool enabled) {
+  initialize();
+  if (git_libgit2_opts(GIT_OPT_ENABLE_CACHING, enabled ? 1 : 0))
+    throw git_exception();
+}
+
+void settings::set_cache_max_size(size_t bytes) {
+  initialize();
+  if (git_libgit2_opts(GIT_OPT_SET_CACHE_MAX_SIZE,
+                       static_cast<ssize_t>(bytes)))
+    throw git_exception();
+}
+
+void settings::set_cache_object_limit(object::object_type type, size_t bytes) {
+  initialize();
+  if (git_libgit2_opts(GIT_OPT_SET_CACHE_OBJECT_LIMIT,
+                       static_cast<git_object_t>(type), bytes))
+    throw git_exception();
+}
+
+settings::cache_statistics settings::cache_stats() {
+  initialize();
+  ssize_t current, allowed;
+  if (git_libgit2_opts(GIT_OPT_GET_CACHED_MEMORY, &current, &allowed))
+    throw git_exception();
+  return cache_statistics{static_cast<size_t>(current),
+                          static_cast<size_t>(allowed)};
+}
+
+size_t settings::mwindow_size() {
+  initialize();
+  size_t result;
+  if (git_libgit2_opts(GIT_OPT_GET_MWINDOW_SIZE, &result))
+    throw git_exception();
+  return result;
+}
+
+void settings::set_mwindow_size(size_t bytes) {
+  initialize();
+  if (git_libgit2_opts(GIT_OPT_SET_MWINDOW_SIZE, bytes))
+    throw git_exception();
+}
+
+size_t settings::mwindow_mapped_limit() {
+  initialize();
+  size_t result;
+  if (git_libgit2_opts(GIT_OPT_GET_MWINDOW_MAPPED_LIMIT, &result))
+    throw git_exception();
+  return result;
+}
+
+void settings::set_mwindow_mapped_limit(size_t bytes) {
+  initialize();
+  if (git_libgit2_opts(GIT_OPT_SET_MWINDOW_MAPPED_LIMIT, bytes))
+    throw git_exception();
+}
+
+} // namespace cppgit2
@@ -0,0 +1,331 @@
+#include <cerrno>
+#include <cppgit2/repository.hpp>
+#include <cppgit2/sparse_checkout.hpp>
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <sys/stat.h>
+
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace cppgit2 {
+
+namespace {
+
+// Cone patterns escape the characters that are special in gitignore syntax
+std::string escape(const std::string &directory) {
+  std::string result;
+  for (auto c : directory) {
+    if (c == '*' || c == '?' || c == '[' || c == '\\')
+      result += '\\';
+    result += c;
+  }
+  return result;
+}
+
+std::string unescape(const std::string &pattern) {
+  std::string result;
+  for (size_t i = 0; i < pattern.size(); ++i) {
+    if (pattern[i] == '\\' && i + 1 < pattern.size())
+      ++i;
+    result += pattern[i];
+  }
+  return result;
+}
+
+bool ends_with(const std::string &value, const std::string &suffix) {
+  return value.size() >= suffix.size() &&
+         value.compare(value.size() - suffix.size(), suffix.size(), suffix) ==
+             0;
+}
+
+// Whether the working directory file of `entry` can be removed without
+// losing changes (a missing file can)
+bool is_unmodified(git_repository *repo, const std::string &workdir,
+                   const git_index_entry *entry) {
+  const auto path = workdir + entry->path;
+  struct stat st;
+#ifdef _WIN32
+  if (stat(path.c_str(), &st) != 0)
+    return errno == ENOENT;
+#else
+  if (lstat(path.c_str(), &st) != 0)
+    return errno == ENOENT || errno == ENOTDIR;
+  if (S_ISLNK(st.st_mode)) {
+    if ((entry->mode & 0170000) != 0120000)
+      return false;
+    std::vector<char> target(static_cast<size_t>(st.st_size) + 1);
+    const auto length = readlink(path.c_str(), target.data(), target.size());
+    git_oid id;
+    if (length < 0 || git_odb_hash(&id, target.data(),
+                                   static_cast<size_t>(length), GIT_OBJECT_BLOB))
+      return false;
+    return git_oid_equal(&id, &entry->id) != 0;
+  }
+#endif
+  if ((st.st_mode & S_IFMT) != S_IFREG ||
+      entry->file_size != static_cast<uint32_t>(st.st_size))
+    return false;
+
+  git_oid id;
+  if (git_repository_hashfile(&id, repo, entry->path, GIT_OBJECT_BLOB,
+                              nullptr)) {
+    git_exception::clear();
+    return false;
+  }
+  return git_oid_equal(&id, &entry->id) != 0;
+}
+
+} // namespace
+
+sparse_checkout::sparse_checkout() : parents_{""} {}
+
+sparse_checkout::sparse_checkout(const std::vector<std::string> &directories)
+    : parents_{""} {
+  for (const auto &directory : directories)
+    add(directory);
+}
+
+sparse_checkout::sparse_checkout(const repository &repo) : parents_{""} {
+  std::ifstream in(repo.path() + "info/sparse-checkout");
+  if (!in)
+    throw git_exception("no sparse-checkout patterns");
+
+  std::vector<std::string> included;
+  std::set<std::string> excluded_below;
+  std::string line;
+  while (std::getline(in, line)) {
+    if (!line.empty() && line.back() == '\r')
+      line.pop_back();
+    if (line.empty() || line[0] == '#' || line == "/*" || line == "!/*/")
+      continue;
+    if (line.size() > 5 && line.compare(0, 2, "!/") == 0 &&
+        ends_with(line, "/*/"))
+      excluded_below.insert(unescape(line.substr(2, line.size() - 4)));
+    else if (line.size() > 2 && line[0] == '/' && line.back() == '/')
+      included.push_back(unescape(line.substr(1)));
+    else
+      throw git_exception("sparse-checkout patterns are not in cone mode");
+  }
+
+  for (const auto &directory : included) {
+    if (excluded_below.count(directory)) {
+      // Parent directory: only its files
+      for (auto pos = directory.find('/'); pos != std::string::npos;
+           pos = directory.find('/', pos + 1))
+        parents_.insert(directory.substr(0, pos + 1));
+    } else {
+      add(directory);
+    }
+  }
+}
+
+void sparse_checkout::add(const std::string &directory) {
+  auto begin = directory.find_first_not_of('/');
+  auto end = directory.find_last_not_of('/');
+  if (begin == std::string::npos)
+    return; // The root is always included
+  const auto normalized = directory.substr(begin, end - begin + 1) + "/";
+
+  recursive_.insert(normalized);
+  for (auto pos = normalized.find('/'); pos + 1 < normalized.size();
+       pos = normalized.find('/', pos + 1))
+    parents_.insert(normalized.substr(0, pos + 1));
+}
+
+std::vector<std::string> sparse_checkout::directories() const {
+  std::vector<std::string> result;
+  for (const auto &directory : recursive_)
+    if (!is_covered(directory))
+      result.push_back(directory.substr(0, directory.size() - 1));
+  return result;
+}
+
+bool sparse_checkout::contains(const std::string &path) const {
+  return excluded_directory(path).empty();
+}
+
+bool sparse_checkout::is_covered(const std::string &directory) const {
+  for (auto pos = directory.find('/'); pos + 1 < directory.size();
+       pos = directory.find('/', pos + 1))
+    if (recursive_.count(directory.substr(0, pos + 1)))
+      return true;
+  return false;
+}
+
+std::string sparse_checkout::excluded_directory(const std::string &path) const {
+  for (auto pos = path.find('/'); pos != std::string::npos;
+       pos = path.find('/', pos + 1)) {
+    const auto directory = path.substr(0, pos + 1);
+    if (recursive_.count(directory))
+      return "";
+    if (!parents_.count(directory))
+      return directory;
+  }
+  return "";
+}
+
+std::vector<std::string> sparse_checkout::patterns() const {
+  std::vector<std::string> result{"/*", "!/*/"};
+  std::set<std::string> listed(parents_.begin(), parents_.end());
+  listed.insert(recursive_.begin(), recursive_.end());
+  for (const auto &directory : listed) {
+    if (directory.empty() || is_covered(directory))
+      continue;
+    result.push_back("/" + escape(directory));
+    if (!recursive_.count(directory))
+      result.push_back("!/" + escape(directory) + "*/");
+  }
+  return result;
+}
+
+std::vector<std::string> sparse_checkout::paths(const tree &target) const {
+  std::vector<std::string> result;
+  git_repository *repo = git_tree_owner(target.c_ptr());
+
+  // Only the root and the parent directories are listed
+  std::function<void(const git_tree *, const std::string &)> visit =
+      [&](const git_tree *current, const std::string &prefix) {
+        for (size_t i = 0; i < git_tree_entrycount(current); ++i) {
+          const auto entry = git_tree_entry_byindex(current, i);
+          const auto path = prefix + git_tree_entry_name(entry);
+          if (git_tree_entry_type(entry) != GIT_OBJECT_TREE) {
+            result.push_back(path);
+            continue;
+          }
+          const auto directory = path + "/";
+          if (recursive_.count(directory)) {
+            result.push_back(path);
+          } else if (parents_.count(directory)) {
+            git_tree *subtree;
+            if (git_tree_lookup(&subtree, repo, git_tree_entry_id(entry)))
+              throw git_exception();
+            try {
+              visit(subtree, directory);
+            } catch (...) {
+              git_tree_free(subtree);
+              throw;
+            }
+            git_tree_free(subtree);
+          }
+        }
+      };
+  visit(target.c_ptr(), "");
+  return result;
+}
+
+void sparse_checkout::save(const repository &repo) const {
+  const auto info = repo.path() + "info";
+#ifdef _WIN32
+  _mkdir(info.c_str());
+#else
+  mkdir(info.c_str(), 0777);
+#endif
+  {
+    std::ofstream out(info + "/sparse-checkout", std::ios::trunc);
+    for (const auto &pattern : patterns())
+      out << pattern << "\n";
+    if (!out.flush())
+      throw git_exception("failed to write sparse-checkout patterns");
+  }
+
+  git_config *config_c;
+  if (git_repository_config(&config_c, repo.c_ptr_))
+    throw git_exception();
+  const auto ret = git_config_set_bool(config_c, "core.sparseCheckout", 1) ||
+                   git_config_set_bool(config_c, "core.sparseCheckoutCone", 1);
+  git_config_free(config_c);
+  if (ret)
+    throw git_exception();
+}
+
+void sparse_checkout::apply(const repository &repo) const {
+  git_repository *handle = repo.c_ptr_;
+  if (git_repository_is_bare(handle))
+    throw git_exception("cannot apply a sparse checkout to a bare repository");
+  const std::string workdir(git_repository_workdir(handle));
+
+  git_index *index_c;
+  if (git_repository_index(&index_c, handle))
+    throw git_exception();
+  cppgit2::index current_index(index_c, ownership::user);
+  if (git_index_read(index_c, false))
+    throw git_exception();
+
+  // Changes are collected first: adding entries invalidates the others
+  std::vector<git_index_entry> updates;
+  std::vector<std::string> update_paths;
+  std::vector<std::string> restored;
+  std::vector<std::string> removed;
+  std::set<std::string> emptied;
+  for (size_t i = 0; i < git_index_entrycount(index_c); ++i) {
+    const auto entry = git_index_get_byindex(index_c, i);
+    if (git_index_entry_stage(entry) > 0)
+      continue;
+    const bool skipped =
+        (entry->flags_extended & GIT_INDEX_ENTRY_SKIP_WORKTREE) != 0;
+    const bool inside = contains(entry->path);
+    if (inside == !skipped)
+      continue;
+    if (!inside && !is_unmodified(handle, workdir, entry))
+      continue;
+
+    updates.push_back(*entry);
+    update_paths.push_back(entry->path);
+    if (inside) {
+      updates.back().flags_extended &= ~GIT_INDEX_ENTRY_SKIP_WORKTREE;
+      restored.push_back(entry->path);
+    } else {
+      updates.back().flags_extended |= GIT_INDEX_ENTRY_SKIP_WORKTREE;
+      removed.push_back(entry->path);
+      const std::string path(entry->path);
+      for (auto pos = path.rfind('/'); pos != std::string::npos && pos > 0;
+           pos = path.rfind('/', pos - 1))
+        emptied.insert(path.substr(0, pos));
+    }
+  }
+
+  for (size_t i = 0; i < updates.size(); ++i) {
+    updates[i].path = update_paths[i].c_str();
+    if (git_index_add(index_c, &updates[i]))
+      throw git_exception();
+  }
+  if (git_index_write(index_c))
+    throw git_exception();
+
+  // Files leave the working directory only once the index marks them as
+  // skipped, so a failed update loses nothing
+  for (const auto &path : removed)
+    std::remove((workdir + path).c_str());
+
+  // Children sort after their parents, so they are removed first
+  for (auto it = emptied.rbegin(); it != emptied.rend(); ++it) {
+#ifdef _WIN32
+    _rmdir((workdir + *it).c_str());
+#else
+    rmdir((workdir + *it).c_str());
+#endif
+  }
+
+  if (!restored.empty()) {
+    std::vector<char *> strings;
+    for (auto &path : restored)
+      strings.push_back(&path[0]);
+    git_checkout_options options;
+    if (git_checkout_init_options(&options, GIT_CHECKOUT_OPTIONS_VERSION))
+      throw git_exception();
+    options.checkout_strategy = GIT_CHECKOUT_SAFE |
+                                GIT_CHECKOUT_RECREATE_MISSING |
+                                GIT_CHECKOUT_DISABLE_PATHSPEC_MATCH;
+    options.paths.strings = strings.data();
+    options.paths.count = strings.size();
+    if (git_checkout_index(handle, index_c, &options))
+      throw git_exception();
+  }
+}
+
+} // namespace cppgit2
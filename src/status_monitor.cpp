@@ -0,0 +1,388 @@
+#include <cppgit2/repository.hpp>
+#include <cppgit2/status_monitor.hpp>
+#include <cstring>
+#include <vector>
+
+#ifdef __linux__
+#include <cerrno>
+#include <dirent.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define CPPGIT2_HAS_INOTIFY
+#endif
+
+namespace cppgit2 {
+
+namespace {
+
+bool starts_with(const std::string &value, const std::string &prefix) {
+  return value.compare(0, prefix.size(), prefix) == 0;
+}
+
+bool ends_with(const std::string &value, const std::string &suffix) {
+  return value.size() >= suffix.size() &&
+         value.compare(value.size() - suffix.size(), suffix.size(), suffix) ==
+             0;
+}
+
+// Index entries whose path starts with `prefix`
+std::vector<std::string> tracked_below(git_repository *repo,
+                                       const std::string &prefix) {
+  git_index *index_c;
+  if (git_repository_index(&index_c, repo))
+    throw git_exception();
+  cppgit2::index current_index(index_c, ownership::user);
+
+  std::vector<std::string> result;
+  size_t position;
+  if (git_index_find_prefix(&position, index_c, prefix.c_str()) == 0) {
+    for (; position < git_index_entrycount(index_c); ++position) {
+      const auto entry = git_index_get_byindex(index_c, position);
+      if (!starts_with(entry->path, prefix))
+        break;
+      result.push_back(entry->path);
+    }
+  } else {
+    git_exception::clear();
+  }
+  return result;
+}
+
+#ifdef CPPGIT2_HAS_INOTIFY
+
+const uint32_t tree_events = IN_CREATE | IN_DELETE | IN_MODIFY |
+                             IN_CLOSE_WRITE | IN_MOVED_FROM | IN_MOVED_TO |
+                             IN_ATTRIB | IN_ONLYDIR;
+
+const uint32_t git_dir_events =
+    IN_CREATE | IN_DELETE | IN_CLOSE_WRITE | IN_MOVED_FROM | IN_MOVED_TO |
+    IN_ONLYDIR;
+
+bool is_directory(const std::string &path, const struct dirent *item) {
+#ifdef _DIRENT_HAVE_D_TYPE
+  if (item->d_type != DT_UNKNOWN)
+    return item->d_type == DT_DIR;
+#else
+  (void)item;
+#endif
+  struct stat st;
+  return lstat(path.c_str(), &st) == 0 && S_ISDIR(st.st_mode);
+}
+
+bool exists(const std::string &path) {
+  struct stat st;
+  return lstat(path.c_str(), &st) == 0;
+}
+
+#endif
+
+// Check if `path` is a directory; only needed along with inotify
+bool is_directory(const std::string &path) {
+#ifdef CPPGIT2_HAS_INOTIFY
+  struct stat st;
+  return lstat(path.c_str(), &st) == 0 && S_ISDIR(st.st_mode);
+#else
+  (void)path;
+  return false;
+#endif
+}
+
+} // namespace
+
+status_monitor::status_monitor(const repository &repo, size_t thread_count)
+    : scanner_(repo, thread_count), valid_(false), watching_(false),
+      full_scans_(0), fd_(-1) {
+  git_repository *handle;
+  if (git_repository_open(&handle, repo.path().c_str()))
+    throw git_exception();
+  repo_.reset(new repository(handle));
+  if (git_repository_is_bare(handle))
+    throw git_exception("cannot get status of a bare repository");
+  workdir_ = git_repository_workdir(handle);
+  git_dir_ = git_repository_path(handle);
+}
+
+status_monitor::~status_monitor() { close_watches(); }
+
+bool status_monitor::is_watching() const { return watching_; }
+
+void status_monitor::invalidate() { valid_ = false; }
+
+size_t status_monitor::full_scans() const { return full_scans_; }
+
+void status_monitor::for_each(
+    std::function<void(const std::string &, status::status_type)> visitor) {
+  // Events already read are lost if something fails, the next call scans
+  // everything again
+  bool updated = false;
+  if (valid_ && watching_) {
+    try {
+      if (read_events()) {
+        for (const auto &path : dirty_)
+          update(path);
+        dirty_.clear();
+        updated = true;
+      }
+    } catch (...) {
+      valid_ = false;
+      throw;
+    }
+  }
+  if (!updated)
+    full_scan();
+
+  for (const auto &entry : statuses_)
+    visitor(entry.first, static_cast<status::status_type>(entry.second));
+}
+
+void status_monitor::full_scan() {
+  close_watches();
+  dirty_.clear();
+  valid_ = false;
+
+#ifdef CPPGIT2_HAS_INOTIFY
+  // Watch before scanning, so that changes made during the scan are seen
+  fd_ = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  if (fd_ >= 0) {
+    watching_ = watch_git_dir(git_dir_) && watch_git_dir(git_dir_ + "refs/") &&
+                watch_tree("", false);
+    if (!watching_)
+      close_watches();
+  }
+#endif
+
+  std::map<std::string, unsigned int> statuses;
+  scanner_.for_each(
+      [&statuses](const std::string &path, status::status_type flags) {
+        statuses[path] = static_cast<unsigned int>(flags);
+      },
+      false);
+  statuses_.swap(statuses);
+  dirty_.clear();
+  ++full_scans_;
+  valid_ = true;
+}
+
+void status_monitor::close_watches() {
+#ifdef CPPGIT2_HAS_INOTIFY
+  if (fd_ >= 0)
+    close(fd_);
+#endif
+  fd_ = -1;
+  watches_.clear();
+  git_dir_watches_.clear();
+  watching_ = false;
+}
+
+bool status_monitor::read_events() {
+#ifdef CPPGIT2_HAS_INOTIFY
+  alignas(struct inotify_event) char buffer[16384];
+  while (true) {
+    const auto length = read(fd_, buffer, sizeof(buffer));
+    if (length < 0) {
+      if (errno == EINTR)
+        continue;
+      return errno == EAGAIN || errno == EWOULDBLOCK;
+    }
+    if (length == 0)
+      return true;
+
+    for (auto p = buffer; p < buffer + length;) {
+      const auto event = reinterpret_cast<const struct inotify_event *>(p);
+      p += sizeof(struct inotify_event) + event->len;
+      if (event->mask & IN_Q_OVERFLOW)
+        return false;
+
+      // HEAD, the index or a ref changed, staged statuses are stale
+      if (git_dir_watches_.count(event->wd)) {
+        if (event->len && !ends_with(event->name, ".lock"))
+          return false;
+        continue;
+      }
+
+      auto found = watches_.find(event->wd);
+      if (found == watches_.end())
+        continue;
+      if (event->mask & IN_IGNORED) {
+        watches_.erase(found);
+        continue;
+      }
+      if (!event->len)
+        continue;
+
+      const std::string name(event->name);
+      if (name == ".git" || name == ".gitignore")
+        return false; // Nested repository or new ignore rules
+      const auto path = found->second + name;
+      if (event->mask & IN_ISDIR) {
+        if (event->mask & (IN_DELETE | IN_MOVED_FROM | IN_CREATE | IN_MOVED_TO))
+          forget_tree(path + "/");
+        if ((event->mask & (IN_CREATE | IN_MOVED_TO)) &&
+            !watch_tree(path + "/", true))
+          return false;
+        continue;
+      }
+      dirty_.insert(path);
+    }
+  }
+#else
+  return false;
+#endif
+}
+
+bool status_monitor::watch_git_dir(const std::string &directory) {
+#ifdef CPPGIT2_HAS_INOTIFY
+  const auto wd = inotify_add_watch(fd_, directory.c_str(), git_dir_events);
+  if (wd < 0)
+    return errno == ENOENT;
+  git_dir_watches_.insert(wd);
+
+  // Refs are nested, e.g., refs/heads/feature/name
+  if (directory == git_dir_)
+    return true;
+  if (auto dir = opendir(directory.c_str())) {
+    bool result = true;
+    while (auto item = readdir(dir)) {
+      const std::string name(item->d_name);
+      if (name != "." && name != ".." &&
+          is_directory(directory + name, item) &&
+          !watch_git_dir(directory + name + "/"))
+        result = false;
+    }
+    closedir(dir);
+    return result;
+  }
+  return true;
+#else
+  (void)directory;
+  return false;
+#endif
+}
+
+bool status_monitor::watch_tree(const std::string &directory,
+                                bool mark_dirty) {
+#ifdef CPPGIT2_HAS_INOTIFY
+  std::vector<std::string> pending{directory};
+  while (!pending.empty()) {
+    const auto current = pending.back();
+    pending.pop_back();
+
+    // Directories reported as a whole are not watched
+    if (!current.empty()) {
+      if (exists(workdir_ + current + ".git")) {
+        if (mark_dirty)
+          return false; // Nested repository
+        continue;
+      }
+      int ignored;
+      if (git_ignore_path_is_ignored(&ignored, repo_->c_ptr_, current.c_str()))
+        throw git_exception();
+      if (ignored && tracked_below(repo_->c_ptr_, current).empty()) {
+        if (mark_dirty)
+          statuses_[current] = GIT_STATUS_IGNORED;
+        continue;
+      }
+    }
+
+    const auto wd =
+        inotify_add_watch(fd_, (workdir_ + current).c_str(), tree_events);
+    if (wd < 0) {
+      if (errno == ENOENT || errno == ENOTDIR)
+        continue; // Removed in the meantime
+      return false; // Most likely out of watches
+    }
+    watches_[wd] = current;
+
+    auto dir = opendir((workdir_ + current).c_str());
+    if (!dir)
+      continue;
+    while (auto item = readdir(dir)) {
+      const std::string name(item->d_name);
+      if (name == "." || name == ".." || name == ".git")
+        continue;
+      const auto path = current + name;
+      if (is_directory(workdir_ + path, item))
+        pending.push_back(path + "/");
+      else if (mark_dirty)
+        dirty_.insert(path);
+    }
+    closedir(dir);
+  }
+  return true;
+#else
+  (void)directory;
+  (void)mark_dirty;
+  return false;
+#endif
+}
+
+void status_monitor::forget_tree(const std::string &directory) {
+#ifdef CPPGIT2_HAS_INOTIFY
+  for (auto it = watches_.begin(); it != watches_.end();) {
+    if (starts_with(it->second, directory)) {
+      inotify_rm_watch(fd_, it->first);
+      it = watches_.erase(it);
+    } else {
+      ++it;
+    }
+  }
+#endif
+  statuses_.erase(statuses_.lower_bound(directory),
+                  statuses_.lower_bound(directory + '\xff'));
+
+  // Tracked files under the directory are re-examined
+  for (const auto &path : tracked_below(repo_->c_ptr_, directory))
+    dirty_.insert(path);
+}
+
+void status_monitor::update(const std::string &path) {
+  unsigned int flags;
+  const auto ret = git_status_file(&flags, repo_->c_ptr_, path.c_str());
+
+  // A directory (e.g., one that replaced a file) has a status per file
+  if (ret == GIT_EAMBIGUOUS ||
+      (ret == GIT_ENOTFOUND && is_directory(workdir_ + path))) {
+    git_exception::clear();
+    rescan_tree(path);
+    return;
+  }
+  if (ret == GIT_ENOTFOUND) {
+    git_exception::clear();
+    statuses_.erase(path);
+    return;
+  }
+  if (ret)
+    throw git_exception();
+  if (flags)
+    statuses_[path] = flags;
+  else
+    statuses_.erase(path);
+}
+
+void status_monitor::rescan_tree(const std::string &path) {
+  statuses_.erase(path);
+  statuses_.erase(statuses_.lower_bound(path + "/"),
+                  statuses_.lower_bound(path + "/\xff"));
+
+  git_status_options options;
+  if (git_status_init_options(&options, GIT_STATUS_OPTIONS_VERSION))
+    throw git_exception();
+  options.flags =
+      GIT_STATUS_OPT_DEFAULTS | GIT_STATUS_OPT_DISABLE_PATHSPEC_MATCH;
+  char *pathspec = const_cast<char *>(path.c_str());
+  options.pathspec = {&pathspec, 1};
+
+  auto callback_c = [](const char *status_path, unsigned int flags,
+                       void *payload) -> int {
+    auto statuses =
+        static_cast<std::map<std::string, unsigned int> *>(payload);
+    (*statuses)[status_path] = flags;
+    return 0;
+  };
+  if (git_status_foreach_ext(repo_->c_ptr_, &options, callback_c,
+                             &statuses_))
+    throw git_exception();
+}
+
+} // namespace cppgit2
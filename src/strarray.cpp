@@ -17,7 +17,7 @@ strarray::strarray(const std::vector<std::string> &strings) {
     auto length = strings[i].size() + 1;
     c_struct_.strings[i] = (char *)malloc(length * sizeof(char));
     strncpy(c_struct_.strings[i], strings[i].c_str(), length);
-    c_struct_.strings[i][length] = '\0';
+    c_struct_.strings[i][length - 1] = '\0';
   }
 }
 
@@ -28,7 +28,7 @@ strarray::strarray(const git_strarray *c_ptr) {
     auto length = strlen(c_ptr->strings[i]) + 1;
     c_struct_.strings[i] = (char *)malloc(length * sizeof(char));
     strncpy(c_struct_.strings[i], c_ptr->strings[i], length);
-    c_struct_.strings[i][length] = '\0';
+    c_struct_.strings[i][length - 1] = '\0';
   }
 }
 
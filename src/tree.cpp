@@ -1,6 +1,8 @@
 #include <cppgit2/repository.hpp>
 #include <functional>
 
+#include "foreach_payload.hpp"
+
 namespace cppgit2 {
 
 tree::tree() : c_ptr_(nullptr), owner_(ownership::libgit2) {}
@@ -51,23 +53,42 @@ repository tree::owner() const { return repository(git_tree_owner(c_ptr_)); }
 void tree::walk(traversal_mode mode,
                 std::function<void(const std::string &, const tree::entry &)>
                     visitor) const {
-  struct visitor_wrapper {
-    std::function<void(const std::string &, const tree::entry &)> fn;
-  };
+  walk(mode,
+       [&visitor](const std::string &root,
+                  const tree::entry &entry) -> walk_action {
+         visitor(root, entry);
+         return walk_action::proceed;
+       },
+       cancellation_token());
+}
 
-  visitor_wrapper wrapper;
-  wrapper.fn = visitor;
+void tree::walk(
+    traversal_mode mode,
+    std::function<walk_action(const std::string &, const tree::entry &)>
+        visitor,
+    const cancellation_token &token) const {
+  typedef detail::foreach_payload<decltype(visitor)> payload;
+  payload wrapper(visitor, token);
 
+  // Positive values skip the entry, negative values end the walk
   auto callback_c = [](const char *root, const git_tree_entry *entry,
-                       void *payload) {
-    auto wrapper = reinterpret_cast<visitor_wrapper *>(payload);
-    wrapper->fn(root ? std::string(root) : "", tree::entry(entry));
-    return 0;
+                       void *data) -> int {
+    auto &wrapper = payload::from(data);
+    if (wrapper.cancelled())
+      return GIT_EUSER;
+    const std::string root_arg = root ? root : "";
+    switch (wrapper.visitor(root_arg, tree::entry(entry))) {
+    case walk_action::skip_subtree:
+      return 1;
+    case walk_action::stop:
+      return wrapper.stop();
+    default:
+      return 0;
+    }
   };
 
-  if (git_tree_walk(c_ptr_, static_cast<git_treewalk_mode>(mode), callback_c,
-                    (void *)(&wrapper)))
-    throw git_exception();
+  wrapper.finish(git_tree_walk(c_ptr_, static_cast<git_treewalk_mode>(mode),
+                               callback_c, wrapper.c_ptr()));
 }
 
 git_tree *tree::c_ptr() { return c_ptr_; }
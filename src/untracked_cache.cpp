@@ -0,0 +1,256 @@
+#include <cppgit2/data_buffer.hpp>
+#include <cppgit2/repository.hpp>
+#include <cppgit2/untracked_cache.hpp>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+
+#ifndef _WIN32
+#include <sys/stat.h>
+#endif
+
+namespace cppgit2 {
+
+namespace {
+
+const char magic[] = {'C', 'G', 'U', 'C'};
+const uint32_t format_version = 1;
+
+template <typename T> void write_value(std::ostream &out, const T &value) {
+  out.write(reinterpret_cast<const char *>(&value), sizeof(T));
+}
+
+void write_string(std::ostream &out, const std::string &value) {
+  write_value(out, static_cast<uint32_t>(value.size()));
+  out.write(value.data(), value.size());
+}
+
+template <typename T> bool read_value(std::istream &in, T &value) {
+  return static_cast<bool>(
+      in.read(reinterpret_cast<char *>(&value), sizeof(T)));
+}
+
+bool read_string(std::istream &in, std::string &value) {
+  uint32_t size;
+  if (!read_value(in, size) || size > (1u << 20))
+    return false;
+  value.resize(size);
+  return size == 0 || static_cast<bool>(in.read(&value[0], size));
+}
+
+} // namespace
+
+bool untracked_cache::stamp::operator==(const stamp &rhs) const {
+  return seconds == rhs.seconds && nanoseconds == rhs.nanoseconds &&
+         size == rhs.size && inode == rhs.inode;
+}
+
+untracked_cache::untracked_cache(const repository &repo) : modified_(false) {
+  git_index *index_c;
+  if (git_repository_index(&index_c, repo.c_ptr_))
+    throw git_exception();
+  cppgit2::index current_index(index_c, ownership::user);
+  if (!git_index_path(index_c))
+    throw git_exception("index has no backing file");
+  path_ = std::string(git_index_path(index_c)) + ".untracked";
+  fingerprint_ = fingerprint(repo.c_ptr_);
+
+  // A missing, unreadable or outdated file is an empty cache
+  std::ifstream in(path_, std::ios::binary);
+  char header[sizeof(magic)];
+  uint32_t version;
+  std::string stored_fingerprint;
+  uint64_t count;
+  if (!in.read(header, sizeof(header)) ||
+      std::memcmp(header, magic, sizeof(magic)) != 0 ||
+      !read_value(in, version) || version != format_version ||
+      !read_string(in, stored_fingerprint) || !read_value(in, count))
+    return;
+  if (stored_fingerprint != fingerprint_) {
+    modified_ = true;
+    return;
+  }
+
+  for (uint64_t i = 0; i < count; ++i) {
+    std::string name;
+    directory record;
+    uint64_t entry_count;
+    if (!read_string(in, name) || !read_value(in, record.directory_stamp) ||
+        !read_value(in, record.ignore_stamp) || !read_value(in, entry_count)) {
+      clear();
+      return;
+    }
+    record.valid = true;
+    record.visited = false;
+    for (uint64_t j = 0; j < entry_count; ++j) {
+      entry item;
+      uint8_t flags;
+      if (!read_string(in, item.name) || !read_value(in, flags)) {
+        clear();
+        return;
+      }
+      item.is_directory = (flags & 1) != 0;
+      item.ignored = (flags & 2) ? ((flags & 4) ? 1 : 0) : -1;
+      record.entries.push_back(std::move(item));
+    }
+    directories_.emplace(std::move(name), std::move(record));
+  }
+}
+
+std::string untracked_cache::path() const { return path_; }
+
+size_t untracked_cache::size() const { return directories_.size(); }
+
+bool untracked_cache::is_modified() const { return modified_; }
+
+void untracked_cache::clear() {
+  if (!directories_.empty())
+    modified_ = true;
+  directories_.clear();
+}
+
+void untracked_cache::save() {
+  if (!modified_)
+    return;
+
+  // Written next to the cache and renamed, so that readers never see a
+  // partial file
+  const auto temporary = path_ + ".lock";
+  {
+    std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+    if (!out)
+      throw git_exception("failed to write untracked cache");
+    out.write(magic, sizeof(magic));
+    write_value(out, format_version);
+    write_string(out, fingerprint_);
+
+    uint64_t count = 0;
+    for (const auto &record : directories_)
+      if (record.second.valid)
+        ++count;
+    write_value(out, count);
+    for (const auto &record : directories_) {
+      if (!record.second.valid)
+        continue;
+      write_string(out, record.first);
+      write_value(out, record.second.directory_stamp);
+      write_value(out, record.second.ignore_stamp);
+      write_value(out, static_cast<uint64_t>(record.second.entries.size()));
+      for (const auto &item : record.second.entries) {
+        write_string(out, item.name);
+        uint8_t flags = item.is_directory ? 1 : 0;
+        if (item.ignored >= 0)
+          flags |= 2 | (item.ignored ? 4 : 0);
+        write_value(out, flags);
+      }
+    }
+    if (!out.flush()) {
+      out.close();
+      std::remove(temporary.c_str());
+      throw git_exception("failed to write untracked cache");
+    }
+  }
+#ifdef _WIN32
+  std::remove(path_.c_str());
+#endif
+  if (std::rename(temporary.c_str(), path_.c_str()) != 0) {
+    std::remove(temporary.c_str());
+    throw git_exception("failed to write untracked cache");
+  }
+  modified_ = false;
+}
+
+void untracked_cache::prepare(git_repository *repo) {
+  const auto current = fingerprint(repo);
+  if (current != fingerprint_) {
+    clear();
+    fingerprint_ = current;
+    modified_ = true;
+  }
+  for (auto &record : directories_)
+    record.second.visited = false;
+}
+
+bool untracked_cache::revalidate(directory &record,
+                                 const std::string &absolute_path,
+                                 bool trusted, int64_t scan_start,
+                                 bool &trusted_below) {
+  record.visited = true;
+  const auto directory_stamp = stamp_of(absolute_path);
+  const auto ignore_stamp = stamp_of(absolute_path + ".gitignore");
+  trusted_below = trusted && record.valid && record.ignore_stamp == ignore_stamp;
+  if (trusted_below && record.directory_stamp == directory_stamp)
+    return true;
+
+  record.directory_stamp = directory_stamp;
+  record.ignore_stamp = ignore_stamp;
+  record.valid = directory_stamp.seconds < scan_start &&
+                 ignore_stamp.seconds < scan_start;
+  record.entries.clear();
+  return false;
+}
+
+void untracked_cache::prune() {
+  for (auto it = directories_.begin(); it != directories_.end();) {
+    if (it->second.visited) {
+      ++it;
+    } else {
+      it = directories_.erase(it);
+      modified_ = true;
+    }
+  }
+}
+
+untracked_cache::stamp untracked_cache::stamp_of(const std::string &path) {
+  stamp result{0, 0, 0, 0};
+#ifndef _WIN32
+  struct stat st;
+  if (lstat(path.c_str(), &st) != 0)
+    return result;
+  result.seconds = static_cast<int64_t>(st.st_mtime);
+#if defined(__APPLE__)
+  result.nanoseconds = static_cast<int64_t>(st.st_mtimespec.tv_nsec);
+#else
+  result.nanoseconds = static_cast<int64_t>(st.st_mtim.tv_nsec);
+#endif
+  result.size = static_cast<uint64_t>(st.st_size);
+  result.inode = static_cast<uint64_t>(st.st_ino);
+#else
+  (void)path;
+#endif
+  return result;
+}
+
+std::string untracked_cache::fingerprint(git_repository *repo) {
+  std::vector<std::string> files{std::string(git_repository_path(repo)) +
+                                 "info/exclude"};
+
+  git_config *config_c;
+  if (git_repository_config_snapshot(&config_c, repo))
+    throw git_exception();
+  data_buffer excludes_file(nullptr);
+  if (git_config_get_path(excludes_file.c_ptr(), config_c,
+                          "core.excludesfile") == 0) {
+    files.push_back(excludes_file.to_string());
+  } else {
+    git_exception::clear();
+    if (const auto xdg = std::getenv("XDG_CONFIG_HOME"))
+      files.push_back(std::string(xdg) + "/git/ignore");
+    else if (const auto home = std::getenv("HOME"))
+      files.push_back(std::string(home) + "/.config/git/ignore");
+  }
+  git_config_free(config_c);
+
+  std::string result;
+  for (const auto &file : files) {
+    const auto file_stamp = stamp_of(file);
+    result += file + '\n' + std::to_string(file_stamp.seconds) + '.' +
+              std::to_string(file_stamp.nanoseconds) + ' ' +
+              std::to_string(file_stamp.size) + ' ' +
+              std::to_string(file_stamp.inode) + '\n';
+  }
+  return result;
+}
+
+} // namespace cppgit2
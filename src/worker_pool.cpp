@@ -0,0 +1,123 @@
+#include "worker_pool.hpp"
+#include <algorithm>
+#include <exception>
+#include <thread>
+
+namespace cppgit2 {
+
+namespace detail {
+
+std::vector<std::unique_ptr<repository>>
+open_worker_handles(const std::string &path, size_t thread_count) {
+  if (thread_count == 0)
+    thread_count = std::max<size_t>(1, std::thread::hardware_concurrency());
+  std::vector<std::unique_ptr<repository>> handles;
+  for (size_t i = 0; i < thread_count; ++i) {
+    git_repository *handle;
+    if (git_repository_open(&handle, path.c_str()))
+      throw git_exception();
+    handles.emplace_back(new repository(handle));
+  }
+  return handles;
+}
+
+void run_workers(size_t workers, std::atomic<bool> &stop,
+                 std::function<void(size_t worker)> task) {
+  std::exception_ptr error;
+  std::mutex error_mutex;
+  auto guarded = [&](size_t worker) {
+    try {
+      task(worker);
+    } catch (...) {
+      std::lock_guard<std::mutex> lock(error_mutex);
+      if (!error)
+        error = std::current_exception();
+      stop = true;
+    }
+  };
+
+  std::vector<std::thread> threads;
+  for (size_t i = 1; i < workers; ++i)
+    threads.emplace_back(guarded, i);
+  guarded(0);
+  for (auto &thread : threads)
+    thread.join();
+
+  if (error)
+    std::rethrow_exception(error);
+}
+
+task_pool::task_pool(size_t workers)
+    : generation_(0), count_(0), next_(0), busy_(0), failed_(false),
+      stop_(false) {
+  for (size_t i = 1; i < workers; ++i)
+    threads_.emplace_back([this, i] { work(i); });
+}
+
+task_pool::~task_pool() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  start_.notify_all();
+  for (auto &thread : threads_)
+    thread.join();
+}
+
+void task_pool::run(size_t count,
+                    std::function<void(size_t worker, size_t i)> task) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    task_ = std::move(task);
+    count_ = count;
+    next_ = 0;
+    failed_ = false;
+    error_ = nullptr;
+    busy_ = threads_.size();
+    ++generation_;
+  }
+  start_.notify_all();
+  drain(0);
+
+  std::unique_lock<std::mutex> lock(mutex_);
+  done_.wait(lock, [this] { return busy_ == 0; });
+  if (error_)
+    std::rethrow_exception(error_);
+}
+
+void task_pool::work(size_t worker) {
+  size_t seen = 0;
+  for (;;) {
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      start_.wait(lock, [&] { return stop_ || generation_ != seen; });
+      if (stop_)
+        return;
+      seen = generation_;
+    }
+    drain(worker);
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (--busy_ == 0)
+      done_.notify_one();
+  }
+}
+
+void task_pool::drain(size_t worker) {
+  while (!failed_) {
+    const size_t i = next_.fetch_add(1);
+    if (i >= count_)
+      break;
+    try {
+      task_(worker, i);
+    } catch (...) {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (!error_)
+        error_ = std::current_exception();
+      failed_ = true;
+    }
+  }
+}
+
+} // namespace detail
+
+} // namespace cppgit2
@@ -0,0 +1,135 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cppgit2/repository.hpp>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Threads and repository handles shared by the parallel_* classes
+// Internal: not installed with the public headers.
+
+namespace cppgit2 {
+
+namespace detail {
+
+// One handle on the repository at `path` for each of `thread_count` threads
+// (0 for one per hardware thread)
+//
+// A libgit2 repository must not be used by two threads at once, so every
+// worker gets its own handle. Throws git_exception if one cannot be opened.
+std::vector<std::unique_ptr<repository>>
+open_worker_handles(const std::string &path, size_t thread_count);
+
+// Runs `task(worker)` on `workers` threads, the calling thread being
+// worker 0, and rethrows the first exception. A failing task sets `stop`.
+void run_workers(size_t workers, std::atomic<bool> &stop,
+                 std::function<void(size_t worker)> task);
+
+// Worker threads kept across many batches of tasks (e.g., one batch per
+// commit of a history walk), where run_workers would start new threads for
+// every batch
+//
+// The calling thread takes part in every batch, as worker 0.
+class task_pool {
+public:
+  explicit task_pool(size_t workers);
+
+  // Waits for the batch in progress, if any, and stops the threads
+  ~task_pool();
+
+  task_pool(const task_pool &) = delete;
+  task_pool &operator=(const task_pool &) = delete;
+
+  // Runs `task(worker, i)` for every i < `count`, and rethrows the first
+  // exception; the other tasks of the batch are then skipped
+  void run(size_t count, std::function<void(size_t worker, size_t i)> task);
+
+private:
+  void work(size_t worker);
+  void drain(size_t worker);
+
+  std::vector<std::thread> threads_;
+  std::mutex mutex_;
+  std::condition_variable start_;
+  std::condition_variable done_;
+  size_t generation_; // bumped for every batch
+  std::function<void(size_t, size_t)> task_;
+  size_t count_;
+  std::atomic<size_t> next_;
+  size_t busy_; // threads still in the batch, besides the caller
+  std::atomic<bool> failed_;
+  std::exception_ptr error_;
+  bool stop_;
+};
+
+// Items shared by the tasks of run_workers, where handling an item may queue
+// more (e.g., the subdirectories of a directory walk)
+//
+// Items are taken last in, first out. A worker with nothing to take sleeps
+// until an item is queued, every item has been handled, or `stop` is set.
+template <typename T> class work_queue {
+public:
+  explicit work_queue(std::atomic<bool> &stop) : stop_(stop), pending_(0) {}
+
+  void push(T item) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      items_.push_back(std::move(item));
+      ++pending_;
+    }
+    wake_.notify_one();
+  }
+
+  // Handle items with `handler(item)` until all are handled or `stop` is set
+  // An exception thrown by the handler sets `stop` and is rethrown.
+  template <typename Handler> void drain(Handler handler) {
+    for (;;) {
+      T item;
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        wake_.wait(lock, [&]() -> bool {
+          return !items_.empty() || pending_ == 0 || stop_;
+        });
+        if (stop_ || items_.empty())
+          return;
+        item = std::move(items_.back());
+        items_.pop_back();
+      }
+      try {
+        handler(item);
+      } catch (...) {
+        stop_ = true;
+        finish();
+        throw;
+      }
+      finish();
+    }
+  }
+
+private:
+  // Sleeping workers are woken when the last item is handled, and on stop
+  void finish() {
+    bool idle;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      idle = --pending_ == 0;
+    }
+    if (idle || stop_)
+      wake_.notify_all();
+  }
+
+  std::atomic<bool> &stop_;
+  std::mutex mutex_;
+  std::condition_variable wake_;
+  std::vector<T> items_;
+  size_t pending_; // Queued, or taken and not yet handled
+};
+
+} // namespace detail
+
+} // namespace cppgit2
@@ -0,0 +1,108 @@
+#include <algorithm>
+#include <cppgit2/repository.hpp>
+#include <doctest.hpp>
+using doctest::test_suite;
+using namespace cppgit2;
+
+namespace {
+
+// Commit of a tree with `contents` as "file", or of an empty tree when
+// `contents` is null
+oid commit_file(repository &repo, const std::vector<oid> &parents,
+                const std::string *contents) {
+  tree_builder builder(repo);
+  if (contents)
+    builder.insert("file", repo.create_blob_from_buffer(*contents),
+                   file_mode::blob);
+  std::vector<commit> parent_commits;
+  for (const auto &parent : parents)
+    parent_commits.push_back(repo.lookup_commit(parent));
+  const signature author("Author", "author@example.com");
+  return repo.create_commit("", author, author, "", "message",
+                            repo.lookup_tree(builder.write()),
+                            parent_commits);
+}
+
+oid commit_file(repository &repo, const std::vector<oid> &parents,
+                const std::string &contents) {
+  return commit_file(repo, parents, &contents);
+}
+
+// Origins as "commit line" pairs, with `commits` naming the commit ids
+std::vector<std::pair<size_t, size_t>>
+origins(const blame_cache::result &result, const std::vector<oid> &commits) {
+  std::vector<std::pair<size_t, size_t>> named;
+  for (const auto &line : *result) {
+    REQUIRE(line.path == "file");
+    named.emplace_back(std::find(commits.begin(), commits.end(),
+                                 line.commit_id) -
+                           commits.begin(),
+                       line.line_number);
+  }
+  return named;
+}
+
+} // namespace
+
+TEST_CASE("Blame cache carries results forward along a linear history" *
+          test_suite("blame_cache")) {
+  auto repo = repository::init("test_blame_cache.git", true);
+
+  // 0: a b c
+  // 1: line 2 changed
+  // 2: same blob
+  // 3: line inserted at the top, last line replaced
+  std::vector<oid> commits{commit_file(repo, {}, "a\nb\nc\n")};
+  commits.push_back(commit_file(repo, {commits.back()}, "a\nB\nc\n"));
+  commits.push_back(commit_file(repo, {commits.back()}, "a\nB\nc\n"));
+  commits.push_back(commit_file(repo, {commits.back()}, "x\na\nB\nd\n"));
+  const std::vector<std::pair<size_t, size_t>> expected{
+      {3, 1}, {0, 1}, {1, 2}, {3, 4}};
+
+  blame_cache cache(repo);
+  cache.blame_file("file", commits[0]);
+  REQUIRE(cache.full() == 1);
+  REQUIRE(origins(cache.blame_file("file", commits[3]), commits) ==
+          expected);
+  REQUIRE(cache.incremental() == 1);
+  REQUIRE(cache.full() == 1);
+
+  // Same origins as a blame from scratch
+  blame_cache fresh(repo);
+  REQUIRE(origins(fresh.blame_file("file", commits[3]), commits) ==
+          expected);
+  REQUIRE(fresh.full() == 1);
+
+  REQUIRE(origins(cache.blame_file("file", commits[2]), commits) ==
+          std::vector<std::pair<size_t, size_t>>{{0, 1}, {1, 2}, {0, 3}});
+  REQUIRE(cache.incremental() == 2);
+  cache.blame_file("file", commits[3]);
+  REQUIRE(cache.hits() == 1);
+  REQUIRE(cache.size() == 3);
+
+  // Ancestors are looked up at most max_distance() commits back
+  blame_cache near(repo);
+  near.set_max_distance(2);
+  near.blame_file("file", commits[0]);
+  near.blame_file("file", commits[3]);
+  REQUIRE(near.full() == 2);
+  near.blame_file("file", commits[2]);
+  REQUIRE(near.incremental() == 1);
+}
+
+TEST_CASE("Blame cache blames from scratch when the file is missing" *
+          test_suite("blame_cache")) {
+  auto repo = repository::init("test_blame_cache_gap.git", true);
+
+  // The file is removed by 1, and added back by 2
+  std::vector<oid> commits{commit_file(repo, {}, "a\nb\n")};
+  commits.push_back(commit_file(repo, {commits.back()}, nullptr));
+  commits.push_back(commit_file(repo, {commits.back()}, "a\nb\n"));
+
+  blame_cache cache(repo);
+  cache.blame_file("file", commits[0]);
+  REQUIRE(origins(cache.blame_file("file", commits[2]), commits) ==
+          std::vector<std::pair<size_t, size_t>>{{2, 1}, {2, 2}});
+  REQUIRE(cache.incremental() == 0);
+  REQUIRE(cache.full() == 2);
+}
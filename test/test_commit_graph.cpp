@@ -0,0 +1,223 @@
+#include <cppgit2/commit_graph.hpp>
+#include <cppgit2/repository.hpp>
+#include <doctest.hpp>
+#include <fstream>
+#include <sys/stat.h>
+#ifdef _WIN32
+#include <direct.h>
+#endif
+using doctest::test_suite;
+using namespace cppgit2;
+
+namespace {
+
+// Fixture history, one commit per line (position: parents)
+//
+//   0 A
+//   1 B: A
+//   2 C: A
+//   3 D: B C   (merge)
+//   4 E: B
+//   5 F: C B   (criss-cross with D)
+//   6 O: D E F (octopus, parents 2 and 3 in the EDGE chunk)
+struct fixture_commit {
+  std::vector<uint32_t> parents;
+  uint32_t generation;
+};
+
+const std::vector<fixture_commit> fixture = {
+    {{}, 1},     {{0}, 2},    {{0}, 2},       {{1, 2}, 3},
+    {{1}, 3},    {{2, 1}, 3}, {{3, 4, 5}, 4},
+};
+
+oid fixture_id(size_t position) {
+  return oid(std::string(40, "1234567"[position]));
+}
+
+void put_be32(std::string &out, uint32_t value) {
+  for (int shift = 24; shift >= 0; shift -= 8)
+    out += static_cast<char>((value >> shift) & 0xff);
+}
+
+void put_be64(std::string &out, uint64_t value) {
+  put_be32(out, static_cast<uint32_t>(value >> 32));
+  put_be32(out, static_cast<uint32_t>(value));
+}
+
+void put_oid(std::string &out, const oid &id) {
+  out.append(reinterpret_cast<const char *>(id.c_ptr()->id), GIT_OID_RAWSZ);
+}
+
+// commit-graph file for the fixture commits [first, last)
+// Commit times are 1000 * (position + 1).
+std::string graph_file(size_t first, size_t last, uint8_t base_count = 0) {
+  std::string fanout, lookup, data, edges;
+  for (size_t byte = 0; byte < 256; ++byte) {
+    uint32_t count = 0;
+    for (size_t i = first; i < last; ++i)
+      if (fixture_id(i).c_ptr()->id[0] <= byte)
+        ++count;
+    put_be32(fanout, count);
+  }
+  for (size_t i = first; i < last; ++i) {
+    const auto &parents = fixture[i].parents;
+    put_oid(lookup, fixture_id(i));
+    put_oid(data, oid(std::string(40, 'f')));
+    put_be32(data, parents.size() > 0 ? parents[0] : 0x70000000);
+    if (parents.size() > 2) {
+      put_be32(data, 0x80000000 | static_cast<uint32_t>(edges.size() / 4));
+      for (size_t p = 1; p < parents.size(); ++p) {
+        const uint32_t last = p + 1 == parents.size() ? 0x80000000 : 0;
+        put_be32(edges, parents[p] | last);
+      }
+    } else {
+      put_be32(data, parents.size() > 1 ? parents[1] : 0x70000000);
+    }
+    put_be32(data, fixture[i].generation << 2);
+    put_be32(data, static_cast<uint32_t>(1000 * (i + 1)));
+  }
+
+  std::vector<std::pair<std::string, std::string>> chunks = {
+      {"OIDF", fanout}, {"OIDL", lookup}, {"CDAT", data}};
+  if (!edges.empty())
+    chunks.push_back({"EDGE", edges});
+
+  std::string out = "CGPH";
+  out += '\1'; // version
+  out += '\1'; // SHA-1
+  out += static_cast<char>(chunks.size());
+  out += static_cast<char>(base_count);
+  uint64_t offset = 8 + (chunks.size() + 1) * 12;
+  for (const auto &chunk : chunks) {
+    out += chunk.first;
+    put_be64(out, offset);
+    offset += chunk.second.size();
+  }
+  put_be32(out, 0);
+  put_be64(out, offset);
+  for (const auto &chunk : chunks)
+    out += chunk.second;
+  return out;
+}
+
+void write_file(const std::string &path, const std::string &contents) {
+  std::ofstream out(path, std::ios::binary | std::ios::trunc);
+  out << contents;
+}
+
+void make_directory(const std::string &path) {
+#ifdef _WIN32
+  _mkdir(path.c_str());
+#else
+  mkdir(path.c_str(), 0777);
+#endif
+}
+
+// Create a bare repository whose objects/info/commit-graph is `contents`
+// The commits themselves are not in the object database, so every query
+// must be answered from the file.
+void write_graph_repository(const std::string &path,
+                            const std::string &contents) {
+  write_file(repository::init(path, true).path() +
+                 "objects/info/commit-graph",
+             contents);
+}
+
+} // namespace
+
+TEST_CASE("Commit graph reads parents, generations and times" *
+          test_suite("commit_graph")) {
+  write_graph_repository("test_commit_graph_single.git",
+                         graph_file(0, fixture.size()));
+  auto repo = repository::open("test_commit_graph_single.git");
+  commit_graph graph(repo);
+  REQUIRE(graph.size() == fixture.size());
+  REQUIRE(graph.size_on_disk() == fixture.size());
+  REQUIRE(graph.contains(fixture_id(3)));
+  REQUIRE(!graph.contains(oid(std::string(40, '9'))));
+
+  REQUIRE(graph.parent_ids(fixture_id(0)).empty());
+  REQUIRE(graph.parent_ids(fixture_id(3)) ==
+          std::vector<oid>{fixture_id(1), fixture_id(2)});
+  REQUIRE(graph.parent_ids(fixture_id(6)) ==
+          std::vector<oid>{fixture_id(3), fixture_id(4), fixture_id(5)});
+  REQUIRE(graph.generation(fixture_id(6)) == 4);
+  REQUIRE(graph.time(fixture_id(4)) == 5000);
+  REQUIRE(graph.tree_id(fixture_id(4)) == oid(std::string(40, 'f')));
+}
+
+TEST_CASE("Commit graph layers of a split chain share positions" *
+          test_suite("commit_graph")) {
+  auto repo = repository::init("test_commit_graph_chain.git", true);
+  const auto chain_dir = repo.path() + "objects/info/commit-graphs/";
+  make_directory(chain_dir);
+  write_file(chain_dir + "graph-" + std::string(40, 'a') + ".graph",
+             graph_file(0, 3));
+  write_file(chain_dir + "graph-" + std::string(40, 'b') + ".graph",
+             graph_file(3, fixture.size(), 1));
+  write_file(chain_dir + "commit-graph-chain",
+             std::string(40, 'a') + "\n" + std::string(40, 'b') + "\n");
+
+  commit_graph graph(repo);
+  REQUIRE(graph.size_on_disk() == fixture.size());
+  REQUIRE(graph.parent_ids(fixture_id(5)) ==
+          std::vector<oid>{fixture_id(2), fixture_id(1)});
+  REQUIRE(graph.is_ancestor(fixture_id(0), fixture_id(6)));
+}
+
+TEST_CASE("Commit graph rejects chunks outside the file" *
+          test_suite("commit_graph")) {
+  const std::string path = "test_commit_graph_bounds.git";
+  auto contents = graph_file(0, fixture.size());
+  auto loads = [&](const std::string &file) {
+    write_graph_repository(path, file);
+    auto repo = repository::open(path);
+    commit_graph graph(repo);
+  };
+  REQUIRE_NOTHROW(loads(contents));
+
+  // Last chunk ends past the end of the file
+  REQUIRE_THROWS_AS(loads(contents.substr(0, contents.size() - 1)),
+                    git_exception);
+
+  // Table of contents cut short
+  REQUIRE_THROWS_AS(loads(contents.substr(0, 8 + 12)), git_exception);
+
+  // Base graphs are only valid in a chain
+  REQUIRE_THROWS_AS(loads(graph_file(0, 3, 1)), git_exception);
+}
+
+TEST_CASE("Commit graph answers ancestry queries" *
+          test_suite("commit_graph")) {
+  write_graph_repository("test_commit_graph_single.git",
+                         graph_file(0, fixture.size()));
+  auto repo = repository::open("test_commit_graph_single.git");
+  commit_graph graph(repo);
+
+  REQUIRE(graph.is_ancestor(fixture_id(0), fixture_id(3)));
+  REQUIRE(graph.is_ancestor(fixture_id(5), fixture_id(6)));
+  REQUIRE(graph.is_ancestor(fixture_id(4), fixture_id(4)));
+  REQUIRE(!graph.is_ancestor(fixture_id(2), fixture_id(4)));
+  REQUIRE(!graph.is_ancestor(fixture_id(4), fixture_id(3)));
+  REQUIRE(!graph.is_ancestor(fixture_id(6), fixture_id(0)));
+
+  REQUIRE(graph.find_merge_base(fixture_id(1), fixture_id(2)) ==
+          fixture_id(0));
+  REQUIRE(graph.find_merge_base(fixture_id(3), fixture_id(4)) ==
+          fixture_id(1));
+  REQUIRE(graph.find_merge_base(fixture_id(6), fixture_id(2)) ==
+          fixture_id(2));
+
+  // Criss-cross merges have two bases, the newest first
+  REQUIRE(graph.find_merge_bases(fixture_id(3), fixture_id(5)) ==
+          std::vector<oid>{fixture_id(2), fixture_id(1)});
+  REQUIRE(graph.find_merge_bases(fixture_id(4), fixture_id(5)) ==
+          std::vector<oid>{fixture_id(1)});
+
+  REQUIRE(graph.ahead_behind(fixture_id(4), fixture_id(3)) ==
+          std::make_pair<size_t, size_t>(1, 2));
+  REQUIRE(graph.ahead_behind(fixture_id(6), fixture_id(4)) ==
+          std::make_pair<size_t, size_t>(4, 0));
+  REQUIRE(graph.ahead_behind(fixture_id(2), fixture_id(2)) ==
+          std::make_pair<size_t, size_t>(0, 0));
+}
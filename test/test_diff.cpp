@@ -0,0 +1,96 @@
+#include <cppgit2/repository.hpp>
+#include <doctest.hpp>
+#include <map>
+using doctest::test_suite;
+using namespace cppgit2;
+
+namespace {
+
+// Tree of files (path, contents) at the top level
+tree make_tree(repository &repo,
+               const std::map<std::string, std::string> &files) {
+  tree_builder builder(repo);
+  for (const auto &file : files)
+    builder.insert(file.first, repo.create_blob_from_buffer(file.second),
+                   file_mode::blob);
+  return repo.lookup_tree(builder.write());
+}
+
+// "added" is added, "changed" has its second line changed, "deleted" is
+// deleted and "same" is unchanged
+diff fixture_diff(repository &repo) {
+  return repo.create_diff_tree_to_tree(
+      make_tree(repo, {{"changed", "a\nb\nc\n"},
+                       {"deleted", "gone\n"},
+                       {"same", "x\n"}}),
+      make_tree(repo, {{"added", "new\n"},
+                       {"changed", "a\nB\nc\n"},
+                       {"same", "x\n"}}));
+}
+
+// Counts the calls it gets, to check that visit does not copy it
+struct line_counter {
+  size_t lines = 0;
+  void operator()(const diff::delta_view &, const diff::hunk_view &,
+                  const diff::line_view &) {
+    ++lines;
+  }
+};
+
+} // namespace
+
+TEST_CASE("Diff visit calls lambdas with views" * test_suite("diff")) {
+  auto repo = repository::init("test_diff.git", true);
+  const auto changes = fixture_diff(repo);
+
+  std::vector<std::string> files;
+  changes.visit([&](const diff::delta_view &delta, float) {
+    files.push_back(std::to_string(static_cast<int>(delta.status())) + " " +
+                    delta.old_file().path() + " " + delta.new_file().path());
+  });
+  REQUIRE(files == std::vector<std::string>{"1 added added",
+                                            "3 changed changed",
+                                            "2 deleted deleted"});
+
+  std::vector<std::string> hunks, lines;
+  changes.visit(
+      [](const diff::delta_view &, float) {}, nullptr,
+      [&](const diff::delta_view &delta, const diff::hunk_view &hunk) {
+        hunks.push_back(std::string(delta.new_file().path()) + " " +
+                        std::to_string(hunk.old_start()) + "," +
+                        std::to_string(hunk.old_lines()) + " " +
+                        std::to_string(hunk.new_start()) + "," +
+                        std::to_string(hunk.new_lines()));
+      },
+      [&](const diff::delta_view &, const diff::hunk_view &,
+          const diff::line_view &line) {
+        lines.push_back(std::string(1, line.origin()) +
+                        std::string(line.content(), line.content_length()));
+      });
+  REQUIRE(hunks == std::vector<std::string>{"added 0,0 1,1",
+                                            "changed 1,3 1,3",
+                                            "deleted 1,1 0,0"});
+  REQUIRE(lines == std::vector<std::string>{"+new\n", " a\n", "-b\n",
+                                            "+B\n", " c\n", "-gone\n"});
+}
+
+TEST_CASE("Diff visit skips null callbacks" * test_suite("diff")) {
+  auto repo = repository::init("test_diff.git", true);
+  const auto changes = fixture_diff(repo);
+
+  // Only a line callback, passed by reference
+  line_counter counter;
+  changes.visit(nullptr, nullptr, nullptr, counter);
+  REQUIRE(counter.lines == 6);
+
+  // Only a hunk callback
+  size_t hunks = 0;
+  changes.visit(nullptr, nullptr,
+                [&](const diff::delta_view &, const diff::hunk_view &) {
+                  ++hunks;
+                });
+  REQUIRE(hunks == 3);
+
+  // Nothing to call
+  REQUIRE_NOTHROW(changes.visit(nullptr));
+}
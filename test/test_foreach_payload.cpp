@@ -0,0 +1,86 @@
+#include "../src/foreach_payload.hpp"
+#include <doctest.hpp>
+#include <functional>
+#include <vector>
+using doctest::test_suite;
+using namespace cppgit2;
+
+namespace {
+
+typedef detail::foreach_payload<std::function<void(int)>> payload;
+
+// Visits 0, 1, ..., count - 1 as libgit2's foreach functions do: a non-zero
+// callback result ends the iteration and is returned
+int fake_foreach(int count, int (*callback)(int, void *), void *data) {
+  for (int i = 0; i < count; ++i)
+    if (const int ret = callback(i, data))
+      return ret;
+  return 0;
+}
+
+int visit(int value, void *data) { return payload::from(data)(value); }
+
+} // namespace
+
+TEST_CASE("Foreach payload visits every item" * test_suite("foreach")) {
+  std::vector<int> visited;
+  cancellation_token token;
+  payload wrapper([&](int value) { visited.push_back(value); }, token);
+  REQUIRE_NOTHROW(wrapper.finish(fake_foreach(3, visit, wrapper.c_ptr())));
+  REQUIRE(visited == std::vector<int>{0, 1, 2});
+
+  // Empty visitors are skipped
+  payload empty(nullptr, token);
+  REQUIRE_NOTHROW(empty.finish(fake_foreach(3, visit, empty.c_ptr())));
+}
+
+TEST_CASE("Cancelling a foreach stops before the next visit" *
+          test_suite("foreach")) {
+  std::vector<int> visited;
+  cancellation_token token;
+  payload wrapper(
+      [&](int value) {
+        visited.push_back(value);
+        if (value == 1)
+          token.cancel();
+      },
+      token);
+  REQUIRE_NOTHROW(wrapper.finish(fake_foreach(5, visit, wrapper.c_ptr())));
+  REQUIRE(visited == std::vector<int>{0, 1});
+
+  // A token that is already cancelled stops before the first visit
+  visited.clear();
+  payload cancelled([&](int value) { visited.push_back(value); }, token);
+  REQUIRE_NOTHROW(
+      cancelled.finish(fake_foreach(5, visit, cancelled.c_ptr())));
+  REQUIRE(visited.empty());
+}
+
+TEST_CASE("Stopping a foreach from a callback is not an error" *
+          test_suite("foreach")) {
+  std::vector<int> visited;
+  cancellation_token token;
+  payload wrapper([&](int value) { visited.push_back(value); }, token);
+  auto stop_at_two = [](int value, void *data) -> int {
+    auto &wrapper = payload::from(data);
+    if (value == 2)
+      return wrapper.stop();
+    return wrapper(value);
+  };
+  REQUIRE_NOTHROW(
+      wrapper.finish(fake_foreach(5, stop_at_two, wrapper.c_ptr())));
+  REQUIRE(visited == std::vector<int>{0, 1});
+  REQUIRE(!token.is_cancelled());
+}
+
+TEST_CASE("Foreach errors are thrown" * test_suite("foreach")) {
+  cancellation_token token;
+  payload wrapper([](int) {}, token);
+  REQUIRE_THROWS_AS(wrapper.finish(GIT_ERROR), git_exception);
+
+  // GIT_EUSER is only expected after a cancellation
+  REQUIRE_THROWS_AS(wrapper.finish(GIT_EUSER), git_exception);
+  token.cancel();
+  REQUIRE_NOTHROW(wrapper.finish(GIT_EUSER));
+  REQUIRE_THROWS_AS(wrapper.finish(GIT_ENOTFOUND), git_exception);
+}
@@ -1,5 +1,7 @@
+#include <algorithm>
 #include <cppgit2/oid.hpp>
 #include <doctest.hpp>
+#include <unordered_set>
 using doctest::test_suite;
 using namespace cppgit2;
 
@@ -97,4 +99,47 @@ TEST_CASE("Interoperatbility with libgit2" * test_suite("oid")) {
 
   // Results are the same
   REQUIRE(oid1.to_hex_string(8) == std::string(oid1_formatted)); // f9de917
-}
\ No newline at end of file
+}
+
+TEST_CASE("Order oids" * test_suite("oid")) {
+  oid oid1("f9de917ac729414151fdce077d4098cfec9a45a5");
+  oid oid2("698b74a011ce48d2cae918129e8392c8987e0777");
+  oid oid3("698b74a011ce48d2cae918129e8392c8987e0778");
+  REQUIRE(oid2 < oid1);
+  REQUIRE(oid2 < oid3);
+  REQUIRE(oid3 > oid2);
+  REQUIRE(oid1 >= oid1);
+  REQUIRE(oid1 != oid2);
+
+  std::vector<oid> ids{oid1, oid3, oid2};
+  std::sort(ids.begin(), ids.end());
+  REQUIRE(ids[0] == oid2);
+  REQUIRE(ids[1] == oid3);
+  REQUIRE(ids[2] == oid1);
+}
+
+TEST_CASE("Use oid as a key in hashed containers" * test_suite("oid")) {
+  std::unordered_set<oid> ids;
+  ids.insert(oid("f9de917ac729414151fdce077d4098cfec9a45a5"));
+  ids.insert(oid("698b74a011ce48d2cae918129e8392c8987e0777"));
+  ids.insert(oid("f9de917ac729414151fdce077d4098cfec9a45a5"));
+  REQUIRE(ids.size() == 2);
+  REQUIRE(ids.count(oid("698b74a011ce48d2cae918129e8392c8987e0777")) == 1);
+}
+
+TEST_CASE("Construct oid in a constant expression" * test_suite("oid")) {
+  constexpr oid id("F9DE917AC729414151FDCE077D4098CFEC9A45A5");
+  REQUIRE(id.to_hex_string() == "f9de917ac729414151fdce077d4098cfec9a45a5");
+  REQUIRE(id == oid(std::string("f9de917ac729414151fdce077d4098cfec9a45a5")));
+}
+
+TEST_CASE("Format many oids at once" * test_suite("oid")) {
+  std::vector<oid> ids{oid("f9de917ac729414151fdce077d4098cfec9a45a5"),
+                       oid("698b74a011ce48d2cae918129e8392c8987e0777")};
+  auto strings = oid::to_hex_string(ids);
+  REQUIRE(strings.size() == 2);
+  REQUIRE(strings[1] == "698b74a011ce48d2cae918129e8392c8987e0777");
+  REQUIRE(oid::to_hex_string(ids, '\n') ==
+          "f9de917ac729414151fdce077d4098cfec9a45a5\n"
+          "698b74a011ce48d2cae918129e8392c8987e0777\n");
+}
@@ -0,0 +1,214 @@
+#include <cppgit2/pack_bitmap.hpp>
+#include <cppgit2/repository.hpp>
+#include <cstdio>
+#include <doctest.hpp>
+#include <fstream>
+using doctest::test_suite;
+using namespace cppgit2;
+
+namespace {
+
+// Pack of 130 objects, stored in the reverse of their index (id) order
+// fixture_id(n) is the n-th object of the index.
+const size_t object_count = 130;
+
+oid fixture_id(size_t n) {
+  char hex[GIT_OID_HEXSZ + 1];
+  std::snprintf(hex, sizeof(hex), "%040zx", n + 1);
+  return oid(std::string(hex));
+}
+
+void put_be32(std::string &out, uint32_t value) {
+  for (int shift = 24; shift >= 0; shift -= 8)
+    out += static_cast<char>((value >> shift) & 0xff);
+}
+
+void put_be64(std::string &out, uint64_t value) {
+  put_be32(out, static_cast<uint32_t>(value >> 32));
+  put_be32(out, static_cast<uint32_t>(value));
+}
+
+// EWAH marker word: running bit, run length, number of literal words
+uint64_t marker(bool running_bit, uint64_t run_length, uint64_t literals) {
+  return (running_bit ? 1 : 0) | (run_length << 1) | (literals << 33);
+}
+
+// EWAH bitmap of `bit_size` bits from its compressed words
+std::string ewah(uint32_t bit_size, const std::vector<uint64_t> &words) {
+  std::string out;
+  put_be32(out, bit_size);
+  put_be32(out, static_cast<uint32_t>(words.size()));
+  for (auto word : words)
+    put_be64(out, word);
+  put_be32(out, 0); // position of the last marker, unused when reading
+  return out;
+}
+
+// Commit bitmap entry: index position of the commit, XOR offset, flags
+std::string entry(uint32_t index_position, uint8_t xor_offset,
+                  const std::string &bitmap) {
+  std::string out;
+  put_be32(out, index_position);
+  out += static_cast<char>(xor_offset);
+  out += '\0';
+  return out + bitmap;
+}
+
+const std::string pack_checksum(GIT_OID_RAWSZ, '\x42');
+
+std::string index_file() {
+  std::string out = "\377tOc";
+  put_be32(out, 2);
+  for (size_t byte = 0; byte < 256; ++byte)
+    put_be32(out, object_count);
+  for (size_t n = 0; n < object_count; ++n)
+    out.append(reinterpret_cast<const char *>(fixture_id(n).c_ptr()->id),
+               GIT_OID_RAWSZ);
+  for (size_t n = 0; n < object_count; ++n)
+    put_be32(out, 0); // CRC32
+  for (size_t n = 0; n < object_count; ++n)
+    put_be32(out, static_cast<uint32_t>(12 + (object_count - n) * 16));
+  out += pack_checksum;
+  return out + std::string(GIT_OID_RAWSZ, '\0');
+}
+
+std::string bitmap_file(const std::string &body, uint32_t entry_count) {
+  std::string out = "BITM";
+  out += '\0';
+  out += '\1'; // version
+  out += '\0';
+  out += '\0'; // options
+  put_be32(out, entry_count);
+  return out + pack_checksum + body;
+}
+
+// Type bitmaps of the fixture (commits, trees, blobs, tags)
+std::string type_bitmaps() {
+  // One run of ones, then a literal word
+  return ewah(130, {marker(true, 1, 1), 0x5}) +
+         // Two runs of zeros, then a literal word cut to the bitmap size
+         ewah(130, {marker(false, 2, 1), 0xf}) +
+         // A literal word, then a run of ones in a second marker
+         ewah(130, {marker(false, 0, 1), 1ull << 63, marker(true, 2, 0)}) +
+         // Empty
+         ewah(130, {});
+}
+
+// Stored bitmaps of four commits; entries 1-3 are XOR-ed with earlier ones
+//   0: {0, 1, 2}
+//   1: {2, 70} ^ entry 0        = {0, 1, 70}
+//   2: {0, 129} ^ entry 1       = {1, 70, 129}
+//   3: {} ^ entry 0 (3 back)    = {0, 1, 2}
+std::string commit_entries() {
+  return entry(0, 0, ewah(130, {marker(false, 0, 1), 0x7})) +
+         entry(1, 1, ewah(130, {marker(false, 0, 2), 0x4, 1ull << 6})) +
+         entry(2, 1,
+               ewah(130, {marker(false, 0, 1), 0x1, marker(false, 1, 1),
+                          0x2})) +
+         entry(3, 3, ewah(130, {}));
+}
+
+void write_file(const std::string &path, const std::string &contents) {
+  std::ofstream out(path, std::ios::binary | std::ios::trunc);
+  out << contents;
+}
+
+// Bare repository with the fixture pack index and the given bitmap file
+void write_bitmap_repository(const std::string &path,
+                             const std::string &bitmap) {
+  const auto pack = repository::init(path, true).path() + "objects/pack/" +
+                    "pack-" + std::string(40, '4') + ".";
+  write_file(pack + "idx", index_file());
+  write_file(pack + "bitmap", bitmap);
+}
+
+std::vector<size_t> positions(const pack_bitmap::bitset &bits) {
+  std::vector<size_t> result;
+  bits.for_each([&](size_t position) { result.push_back(position); });
+  return result;
+}
+
+} // namespace
+
+TEST_CASE("Pack bitmap decodes EWAH run and literal words" *
+          test_suite("pack_bitmap")) {
+  write_bitmap_repository(
+      "test_pack_bitmap.git",
+      bitmap_file(type_bitmaps() + commit_entries(), 4));
+  auto repo = repository::open("test_pack_bitmap.git");
+  pack_bitmap bitmap(repo);
+  REQUIRE(bitmap.object_count() == object_count);
+  REQUIRE(bitmap.commit_count() == 4);
+
+  REQUIRE(bitmap.commits().size() == 130);
+  REQUIRE(bitmap.commits().count() == 66);
+  REQUIRE(bitmap.commits().test(63));
+  REQUIRE(bitmap.commits().test(64));
+  REQUIRE(!bitmap.commits().test(65));
+  REQUIRE(bitmap.commits().test(66));
+  REQUIRE(!bitmap.commits().test(128));
+
+  REQUIRE(positions(bitmap.trees()) == std::vector<size_t>{128, 129});
+
+  REQUIRE(bitmap.blobs().count() == 67);
+  REQUIRE(!bitmap.blobs().test(62));
+  REQUIRE(bitmap.blobs().test(63));
+  REQUIRE(bitmap.blobs().test(129));
+
+  REQUIRE(bitmap.tags().count() == 0);
+}
+
+TEST_CASE("Pack bitmap resolves XOR-ed commit bitmaps" *
+          test_suite("pack_bitmap")) {
+  write_bitmap_repository(
+      "test_pack_bitmap.git",
+      bitmap_file(type_bitmaps() + commit_entries(), 4));
+  auto repo = repository::open("test_pack_bitmap.git");
+  pack_bitmap bitmap(repo);
+
+  REQUIRE(bitmap.has_bitmap(fixture_id(0)));
+  REQUIRE(!bitmap.has_bitmap(fixture_id(4)));
+  REQUIRE(positions(bitmap.bitmap(fixture_id(0))) ==
+          std::vector<size_t>{0, 1, 2});
+  REQUIRE(positions(bitmap.bitmap(fixture_id(1))) ==
+          std::vector<size_t>{0, 1, 70});
+  REQUIRE(positions(bitmap.bitmap(fixture_id(2))) ==
+          std::vector<size_t>{1, 70, 129});
+  REQUIRE(positions(bitmap.bitmap(fixture_id(3))) ==
+          std::vector<size_t>{0, 1, 2});
+  REQUIRE_THROWS_AS(bitmap.bitmap(fixture_id(4)), git_exception);
+
+  REQUIRE(positions(bitmap.reachable({fixture_id(1), fixture_id(3)})) ==
+          std::vector<size_t>{0, 1, 2, 70});
+  REQUIRE(positions(bitmap.reachable({fixture_id(2)}, {fixture_id(0)})) ==
+          std::vector<size_t>{70, 129});
+
+  // Pack order is the reverse of the index order
+  REQUIRE(bitmap.position(fixture_id(0)) == object_count - 1);
+  REQUIRE(bitmap.object_id(0) == fixture_id(object_count - 1));
+}
+
+TEST_CASE("Pack bitmap rejects EWAH words outside the bitmap" *
+          test_suite("pack_bitmap")) {
+  const std::string path = "test_pack_bitmap_invalid.git";
+  const auto empty = ewah(130, {});
+  auto opens = [&](const std::string &tags) {
+    write_bitmap_repository(path,
+                            bitmap_file(empty + empty + empty + tags, 0));
+    auto repo = repository::open(path);
+    pack_bitmap bitmap(repo);
+  };
+  REQUIRE_NOTHROW(opens(ewah(130, {marker(true, 2, 1), 0x3})));
+
+  // Run past the end of the bitmap
+  REQUIRE_THROWS_AS(opens(ewah(130, {marker(true, 4, 0)})), git_exception);
+
+  // More literal words than stored
+  REQUIRE_THROWS_AS(opens(ewah(130, {marker(false, 0, 2), 0x1})),
+                    git_exception);
+
+  // Word count past the end of the file
+  auto truncated = ewah(130, {marker(false, 0, 1), 0x1});
+  REQUIRE_THROWS_AS(opens(truncated.substr(0, truncated.size() - 8)),
+                    git_exception);
+}
@@ -0,0 +1,95 @@
+#include <cppgit2/repository.hpp>
+#include <doctest.hpp>
+#include <map>
+using doctest::test_suite;
+using namespace cppgit2;
+
+namespace {
+
+// Tree of files (path, contents) at the top level
+tree make_tree(repository &repo,
+               const std::map<std::string, std::string> &files) {
+  tree_builder builder(repo);
+  for (const auto &file : files)
+    builder.insert(file.first, repo.create_blob_from_buffer(file.second),
+                   file_mode::blob);
+  return repo.lookup_tree(builder.write());
+}
+
+// Lines "line 0\n" to "line <count - 1>\n", 7 bytes each below 10
+std::string lines(size_t count, const std::string &prefix = "line ") {
+  std::string result;
+  for (size_t i = 0; i < count; ++i)
+    result += prefix + std::to_string(i) + "\n";
+  return result;
+}
+
+// Matches as "R old new similarity" (or "C ..." for copies)
+std::vector<std::string> find(rename_detector &detector, repository &repo,
+                              const std::map<std::string, std::string> &before,
+                              const std::map<std::string, std::string> &after) {
+  const auto old_tree = make_tree(repo, before);
+  const auto new_tree = make_tree(repo, after);
+  std::vector<std::string> result;
+  for (const auto &match :
+       detector.find(repo.create_diff_tree_to_tree(old_tree, new_tree)))
+    result.push_back(std::string(match.is_copy ? "C " : "R ") +
+                     match.old_path + " " + match.new_path + " " +
+                     std::to_string(match.similarity));
+  return result;
+}
+
+} // namespace
+
+TEST_CASE("Rename detector scores shared chunks against the larger file" *
+          test_suite("rename_detector")) {
+  auto repo = repository::init("test_rename_detector.git", true);
+  rename_detector detector(repo, 2);
+
+  // 8 of 10 lines kept: 56 of 70 bytes
+  auto changed = lines(8) + "LINE 8\nLINE 9\n";
+  REQUIRE(find(detector, repo, {{"old", lines(10)}}, {{"new", changed}}) ==
+          std::vector<std::string>{"R old new 80"});
+
+  // Appending doubles the larger size: 70 of 140 bytes
+  REQUIRE(find(detector, repo, {{"old", lines(10)}},
+               {{"new", lines(10) + lines(10, "next ")}}) ==
+          std::vector<std::string>{"R old new 50"});
+
+  // Below the threshold, the files stay a deletion and an addition
+  detector.set_threshold(81);
+  REQUIRE(find(detector, repo, {{"old", lines(10)}}, {{"new", changed}})
+              .empty());
+  REQUIRE(!detector.limit_exceeded());
+}
+
+TEST_CASE("Rename detector pairs identical files before similar ones" *
+          test_suite("rename_detector")) {
+  auto repo = repository::init("test_rename_detector.git", true);
+  rename_detector detector(repo, 2);
+  const auto changed = lines(8) + "LINE 8\nLINE 9\n";
+
+  // "similar" scores 80 against "old", but "same" is identical
+  REQUIRE(find(detector, repo, {{"old", lines(10)}},
+               {{"same", lines(10)}, {"similar", changed}}) ==
+          std::vector<std::string>{"R old same 100"});
+
+  // With copies, the similar file is a copy of the renamed one
+  detector.set_find_copies(true);
+  REQUIRE(find(detector, repo, {{"old", lines(10)}},
+               {{"same", lines(10)}, {"similar", changed}}) ==
+          std::vector<std::string>{"R old same 100", "C old similar 80"});
+
+  // The best score wins when two sources are similar to one target
+  detector.set_find_copies(false);
+  REQUIRE(find(detector, repo, {{"a", changed}, {"b", lines(9)}},
+               {{"new", lines(10)}}) ==
+          std::vector<std::string>{"R b new 90"});
+
+  // Over the rename limit, only identical files are paired
+  detector.set_rename_limit(0);
+  REQUIRE(find(detector, repo, {{"a", lines(10)}, {"b", lines(9)}},
+               {{"same", lines(10)}, {"similar", changed}}) ==
+          std::vector<std::string>{"R a same 100"});
+  REQUIRE(detector.limit_exceeded());
+}
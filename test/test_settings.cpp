@@ -0,0 +1,21 @@
+#include <cppgit2/settings.hpp>
+#include <doctest.hpp>
+using doctest::test_suite;
+using namespace cppgit2;
+
+TEST_CASE("Set the maximum object cache size" * test_suite("settings")) {
+  settings::set_cache_max_size(128 * 1024 * 1024);
+  auto stats = settings::cache_stats();
+  REQUIRE(stats.max_bytes == 128 * 1024 * 1024);
+  REQUIRE(stats.current_bytes <= stats.max_bytes);
+  settings::set_cache_max_size(256 * 1024 * 1024);
+  REQUIRE(settings::cache_stats().max_bytes == 256 * 1024 * 1024);
+}
+
+TEST_CASE("Get and set the mmap window size" * test_suite("settings")) {
+  auto original = settings::mwindow_size();
+  settings::set_mwindow_size(1024 * 1024);
+  REQUIRE(settings::mwindow_size() == 1024 * 1024);
+  settings::set_mwindow_size(original);
+  REQUIRE(settings::mwindow_size() == original);
+}
@@ -0,0 +1,36 @@
+#include <cppgit2/sparse_checkout.hpp>
+#include <doctest.hpp>
+using doctest::test_suite;
+using namespace cppgit2;
+
+TEST_CASE("Default sparse checkout only contains root files" *
+          test_suite("sparse_checkout")) {
+  sparse_checkout cone;
+  REQUIRE(cone.contains("README.md"));
+  REQUIRE(!cone.contains("src/main.cpp"));
+  REQUIRE(cone.excluded_directory("src/lib/a.cpp") == "src/");
+  REQUIRE(cone.directories().empty());
+}
+
+TEST_CASE("Sparse checkout cone contains parent directory files" *
+          test_suite("sparse_checkout")) {
+  sparse_checkout cone({"/a/b/c/", "g"});
+  REQUIRE(cone.contains("a/x"));
+  REQUIRE(cone.contains("a/b/top"));
+  REQUIRE(cone.contains("a/b/c/d/e/file"));
+  REQUIRE(cone.contains("g/h/file"));
+  REQUIRE(!cone.contains("a/e/file"));
+  REQUIRE(cone.excluded_directory("a/b/d/file") == "a/b/d/");
+  REQUIRE(cone.directories() == std::vector<std::string>{"a/b/c", "g"});
+  REQUIRE(cone.patterns() ==
+          std::vector<std::string>{"/*", "!/*/", "/a/", "!/a/*/", "/a/b/",
+                                   "!/a/b/*/", "/a/b/c/", "/g/"});
+}
+
+TEST_CASE("Nested sparse checkout directories are redundant" *
+          test_suite("sparse_checkout")) {
+  sparse_checkout cone({"a/b", "a"});
+  REQUIRE(cone.contains("a/e/file"));
+  REQUIRE(cone.directories() == std::vector<std::string>{"a"});
+  REQUIRE(cone.patterns() == std::vector<std::string>{"/*", "!/*/", "/a/"});
+}
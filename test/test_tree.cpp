@@ -0,0 +1,88 @@
+#include <cppgit2/repository.hpp>
+#include <doctest.hpp>
+using doctest::test_suite;
+using namespace cppgit2;
+
+namespace {
+
+// Tree with the entries dir/a, dir/b, dir/sub/c, x and z
+tree fixture_tree(repository &repo) {
+  const auto blob = repo.create_blob_from_buffer("contents\n");
+
+  tree_builder sub(repo);
+  sub.insert("c", blob, file_mode::blob);
+  const auto sub_id = sub.write();
+
+  tree_builder dir(repo);
+  dir.insert("a", blob, file_mode::blob);
+  dir.insert("b", blob, file_mode::blob);
+  dir.insert("sub", sub_id, file_mode::tree);
+  const auto dir_id = dir.write();
+
+  tree_builder root(repo);
+  root.insert("dir", dir_id, file_mode::tree);
+  root.insert("x", blob, file_mode::blob);
+  root.insert("z", blob, file_mode::blob);
+  return repo.lookup_tree(root.write());
+}
+
+// Paths visited by a preorder walk, ending the visit with `action` at the
+// entry `at`
+std::vector<std::string> walk(const tree &root, const std::string &at,
+                              tree::walk_action action,
+                              const cancellation_token &token =
+                                  cancellation_token()) {
+  std::vector<std::string> result;
+  root.walk(tree::traversal_mode::preorder,
+            [&](const std::string &parent,
+                const tree::entry &entry) -> tree::walk_action {
+              result.push_back(parent + entry.filename());
+              return result.back() == at ? action
+                                         : tree::walk_action::proceed;
+            },
+            token);
+  return result;
+}
+
+} // namespace
+
+TEST_CASE("Tree walk skips subtrees and stops" * test_suite("tree")) {
+  auto repo = repository::init("test_tree_walk.git", true);
+  const auto root = fixture_tree(repo);
+
+  REQUIRE(walk(root, "", tree::walk_action::proceed) ==
+          std::vector<std::string>{"dir", "dir/a", "dir/b", "dir/sub",
+                                   "dir/sub/c", "x", "z"});
+  REQUIRE(walk(root, "dir/sub", tree::walk_action::skip_subtree) ==
+          std::vector<std::string>{"dir", "dir/a", "dir/b", "dir/sub", "x",
+                                   "z"});
+  REQUIRE(walk(root, "dir", tree::walk_action::skip_subtree) ==
+          std::vector<std::string>{"dir", "x", "z"});
+
+  // Stopping is not an error, and later entries are not visited
+  REQUIRE(walk(root, "dir/b", tree::walk_action::stop) ==
+          std::vector<std::string>{"dir", "dir/a", "dir/b"});
+}
+
+TEST_CASE("Tree walk ends once its token is cancelled" * test_suite("tree")) {
+  auto repo = repository::init("test_tree_walk.git", true);
+  const auto root = fixture_tree(repo);
+
+  cancellation_token token;
+  std::vector<std::string> visited;
+  root.walk(tree::traversal_mode::preorder,
+            [&](const std::string &parent,
+                const tree::entry &entry) -> tree::walk_action {
+              visited.push_back(parent + entry.filename());
+              if (visited.size() == 2)
+                token.cancel();
+              return tree::walk_action::proceed;
+            },
+            token);
+  REQUIRE(visited == std::vector<std::string>{"dir", "dir/a"});
+
+  // The token stays cancelled until it is reset
+  REQUIRE(walk(root, "", tree::walk_action::proceed, token).empty());
+  token.reset();
+  REQUIRE(walk(root, "", tree::walk_action::proceed, token).size() == 7);
+}